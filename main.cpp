@@ -3,16 +3,50 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include "alloc/alloc.h"
+#include "arena/arena.h"
+#include "benchmark/benchmark.h"
 #include "camera/camera.h"
+#include "capture/capture.h"
+#include "clock/clock.h"
+#include "cluster/cluster.h"
+#include "culling/culling.h"
+#include "deferred/deferred.h"
+#include "device/device.h"
+#include "ecs/ecs.h"
+#include "framebuffer/framebuffer.h"
 #include "grid/grid.h"
+#include "headless/headless.h"
+#include "job/job.h"
+#include "light/light.h"
+#include "material/material.h"
 #include "misc/misc.h"
+#include "occlusion/occlusion.h"
+#include "poster/poster.h"
+#include "profiler/profiler.h"
+#include "query/query.h"
+#include "queue/queue.h"
+#include "ring/ring.h"
+#include "server/server.h"
 #include "shader/shader.h"
 #include "skybox/skybox.h"
+#include "snapshot/snapshot.h"
+#include "software/software.h"
 #include "texture/texture.h"
+#include "transform/transform.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include <unistd.h>
+
 #define N_GLFW_KEYS 348
 
 /* ----- Define macros ----- */
@@ -23,30 +57,151 @@
 const GLchar TITLE[] = "OpenGL Template";
 const GLint SCR_WIDTH = 800;
 const GLint SCR_HEIGHT = 600;
+const GLfloat NEAR = 0.01f;
 const GLfloat FAR = 100.0f;
+const GLuint N_FORWARD_POINT_LIGHTS = 1;  /* N_POINT_LIGHTS in texture.fs */
+const glm::vec3 AMBIENT_K = glm::vec3(0.1f);
+const GLfloat LIGHT_VOLUME_SCALE = 2.2f;  /* The sphere mesh has a radius of 0.5, plus 10% for its flat faces */
+
+/* Texture units of the light buffers (0 to 2 are used by Material) */
+const GLuint LIGHT_DATA_SLOT = 3;
+const GLuint CLUSTER_GRID_SLOT = 4;
+const GLuint LIGHT_INDEX_SLOT = 5;
 /* ---------------------------- */
 
-enum Object {
-    /* ----- Add objects ----- */
-    IRON_MAN,
-    SPHERE,
-    /* ----------------------- */
-    OBJECT_COUNT,
+/* Loaded meshes and materials, shared by the entities that reference them */
+struct MeshAsset {
+    GLuint arenaMeshID;
+    Bounds bounds;
+    OccluderMesh occluder;  /* CPU copy of the positions for software occlusion culling */
 };
+std::vector<MeshAsset> meshAssets;
+std::vector<Material> materialAssets;
+GLuint ironManMesh, sphereMesh;
+GLuint ironManMaterial, sphereMaterial;
+
+/* Every object and light of the scene is an entity with packed components */
+Registry registry;
 
-struct ObjectInfo {
-    GLuint vaoID;
-    GLsizei vertexCount;
-    Texture texDiffuse, texSpecular, texNormal;
+/* All meshes share the buffers of the arena and are drawn from per-frame indirect commands */
+GeometryArena geometryArena;
+GLboolean multiDrawIndirect = GL_TRUE;  /* Use glMultiDrawElementsIndirect when supported (--no-mdi) */
+std::vector<InstanceData> frameInstances;
+StreamRing streamRing;  /* Instances, indirect commands and light lists of the frames in flight */
+GLboolean persistentMapping = GL_TRUE;  /* Map the stream ring once with glBufferStorage when supported (--no-persistent-map) */
+std::vector<DrawElementsIndirectCommand> frameCommands;  /* Depth pre-pass commands, then color pass commands, one per object */
+GLuint depthCommandCount = 0;
+
+/* Instances sharing a mesh and a material, drawn by one command per pass */
+struct DrawBatch {
+    GLuint meshID, materialID;
 };
-ObjectInfo* objectInfo;
+std::vector<DrawBatch> drawBatches;
+std::vector<GLuint> batchLookup;  /* Batch of every (mesh, material) pair, or NO_BATCH */
+std::vector<GLuint> batchOrder;   /* Batches in submission order, the i-th drawn by command depthCommandCount + i */
+const GLuint NO_BATCH = ~0u;
+
+/* Per-frame CPU work runs as parallel jobs (--threads) */
+JobSystem jobSystem;
+GLuint jobThreadCount = 0;  /* 0: one per core */
+
+/*
+Each job lists the instances of its share of the draw items, per batch; the
+lists are merged in job order, so the result does not depend on the threads.
+*/
+struct CommandList {
+    std::vector<std::vector<InstanceData>> instances;  /* Per batch */
+    std::vector<GLuint> firstItem;  /* Per batch: first draw item listed, or NO_ITEM */
+};
+std::vector<CommandList> commandLists;
+std::vector<GLuint> batchFirstItem;
+std::vector<GLuint> commandListOffsets;  /* Where each list's instances of each batch go in frameInstances */
+const GLuint NO_ITEM = ~0u;
+
+/* An entity drawn in the current frame */
+struct DrawItem {
+    Entity entity;
+    GLuint meshID, materialID, batchID;
+    glm::mat4 modelMatrix;
+    glm::vec3 emissionK;
+    GLboolean occluder;  /* Rasterized into the occlusion depth buffer */
+};
+std::vector<DrawItem> drawItems;
+
+/* Draw items are sorted by pipeline state, then front to back (--no-sort keeps the scene order) */
+RenderQueue renderQueue;
+std::vector<DrawItem> sortedDrawItems;
+GLboolean sortDrawItems = GL_TRUE;
+GLuint unsortedStateChanges = 0, stateChanges = 0;
+
+/* Draw items outside the view frustum are dropped before submission */
+FrustumCuller frustumCuller;
+GLuint drawnObjectCount = 0, culledObjectCount = 0;
+GLuint cullBenchmarkObjects = 0;  /* Run the culling microbenchmark instead of rendering (--cull-bench) */
+
+/* Draw items hidden behind the occluders are dropped too (toggle with O) */
+OcclusionCuller occlusionCuller;
+std::vector<unsigned char> occlusionVisibility;  /* Per draw item, from the parallel occlusion tests */
+GLboolean occlusionCulling = GL_FALSE;
+GLboolean occlusionCheck = GL_FALSE;  /* Run the occlusion culling self-check instead of rendering (--occlusion-check) */
+GLuint occludedObjectCount = 0;
+
+enum RenderPath {
+    FORWARD_PATH,    /* Point lights from uniform arrays */
+    CLUSTERED_PATH,  /* Point/spot lights from per-cluster light lists */
+    DEFERRED_PATH,   /* G-buffer plus screen-space lighting passes (selected at startup) */
+    RENDER_PATH_COUNT,
+};
+const char* const RENDER_PATH_NAMES[RENDER_PATH_COUNT] = {"forward", "clustered", "deferred"};
+
+/* One texture shader per render path and material permutation, compiled on demand */
+Shader textureShaders[RENDER_PATH_COUNT][Material::PERMUTATION_COUNT];
+GLboolean textureShaderReady[RENDER_PATH_COUNT][Material::PERMUTATION_COUNT];
+RenderPath renderPath = FORWARD_PATH;
+
+/* Depth-only pass before the color pass of the forward paths (toggle with Z) */
+Shader depthShader;
+GLboolean depthPrepass = GL_FALSE;
+QueryRing shadedSamplesQuery;  /* Samples that passed the depth test in the color pass */
+
+std::vector<DirLight> dirLights;
+LightBuffer lightBuffer;
+ClusterGrid clusterGrid;
+Deferred deferred;
+
+/* Extra point and spot lights of the benchmark scene (--lights, --spot-lights), circling around the y-axis */
+GLuint benchmarkLightCount = 0;
+GLuint benchmarkSpotLightCount = 0;
+std::mt19937 benchmarkRandom(1);  /* Fixed seed: the same arguments always give the same lights */
+
+/* Extra copies of the iron man behind the first one, to add overdraw (--copies) */
+GLuint ironManCopies = 0;
+
+/* Small glowing spheres on a grid behind the scene, to benchmark instancing (--instances) */
+GLuint sphereFieldSize = 0;
 
-Shader textureShader;
+/* Entities are placed once; only moved ones have their transforms recomputed */
+TransformHierarchy transforms;
+GLuint updatedTransformCount = 0;
+
+/* Frame statistics printed every second (--stats) */
+GLboolean showStats = GL_FALSE;
+GLuint statsFrames = 0;
+uint64_t statsStartTime = 0;
+uint64_t drawListTime = 0;  /* Spent building draw lists since the last report */
 Grid grid;
 Skybox skybox;
 
-GLfloat deltaTime = 0.0f;  /* Time between current frame and last frame */
-GLfloat lastFrame = 0.0f;  /* Time of last frame */
+/*
+The simulation advances in fixed steps of deltaTime (--sim-rate steps per
+second) and the render state is interpolated between the last two steps.
+*/
+FixedTimestep simulationClock;
+GLuint simulationRate = 120;
+GLfloat deltaTime = 0.0f;  /* Length of a simulation step */
+glm::vec3 previousCameraPos;
+std::vector<glm::vec3> previousLightPositions;
+std::vector<SpotLight> previousSpotLights;
 
 GLint scrWidth  = SCR_WIDTH;
 GLint scrHeight = SCR_HEIGHT;
@@ -56,15 +211,161 @@ GLboolean showGrid = GL_FALSE;
 Camera camera(scrWidth, scrHeight, glm::vec3(0.0f, 5.0f, 20.0f), glm::vec3(0.0f, 0.0f, -1.0f));
 GLboolean cursorDisabled = GL_TRUE;
 
+/*
+The main thread polls events and simulates the camera and the lights; the
+render thread owns the OpenGL context and draws from an immutable copy of
+that state. Two copies alternate, so frame N + 1 is simulated while frame N
+is submitted.
+*/
+struct FrameState {
+    glm::mat4 viewMatrix, projectionMatrix;
+    glm::vec3 cameraPos;
+    GLint width, height;
+    RenderPath renderPath;
+    GLboolean showGrid, depthPrepass, occlusionCulling;
+    std::vector<PointLight> pointLights;
+    std::vector<SpotLight> spotLights;
+};
+SnapshotExchange<FrameState> frameStates;
+const FrameState* frameState = NULL;  /* Snapshot being drawn by the render thread */
+GLint viewportWidth = 0, viewportHeight = 0;  /* Size the render thread has set up */
+
+/*
+Headless mode (--headless W H) needs no window: --frames frames, one
+simulation step apart, are rendered into an offscreen framebuffer as fast as
+possible and written to <--output>0000.ppm, <--output>0001.ppm, ... or to
+the --capture output.
+*/
+GLboolean headless = GL_FALSE;
+GLuint headlessFrameCount = 1;
+std::string headlessOutput = "frame";
+Framebuffer headlessTarget;
+GLuint outputFramebuffer = 0;  /* Where paintGL draws: 0 for the window, else the headless target */
+
+/* Every rendered frame is read back asynchronously and encoded on its own thread (--capture) */
+FrameCapture frameCapture;
+std::string captureOutput;
+
+/*
+Render server mode (--serve SOCKET, sized by --headless W H): a local
+client builds the scene and asks for frames through text commands, and
+takes the pixels from shared memory (see runServer()).
+*/
+std::string serverSocket;
+std::string serverBenchmarkSocket;  /* Benchmark a running render server instead of rendering (--serve-bench) */
+GLuint serverBenchmarkFrames = 0;
+GLuint serverMaterial;  /* Plain white, for the meshes loaded by clients */
+const GLuint SERVER_FRAME_SLOTS = 3;
+
+/* Render one screenshot of any size in tiles of the --headless size and exit (--poster W H FILE) */
+std::string posterOutput;
+GLint posterWidth = 0, posterHeight = 0;
+
+/* Draw the headless frames on the CPU, without any OpenGL context (--software) */
+GLboolean softwareRendering = GL_FALSE;
+SoftwareRenderer softwareRenderer;
+std::vector<SoftwareDraw> softwareDraws;
+std::vector<PointLight> softwarePointLights;
+std::vector<SpotLight> softwareSpotLights;
+
+/*
+Submit --null frames to a NullRenderDevice, which only counts the commands,
+and report the CPU cost of paintGL() without any driver or GPU time.
+*/
+GLuint nullFrameCount = 0;
+
+/* Record CPU scopes and GPU sections, and write them as a Chrome trace when the program exits (--profile) */
+std::string profileOutput;
+GpuTimers gpuTimers;
+
+/*
+Benchmark (--bench N F): draw N frames of one simulation step each, v-sync
+off, with the camera on a path (--path, or one orbit of the scene), and
+write the frame, CPU and GPU times to F as JSON. The warm-up frames before
+them, at the start of the path, are not timed: shaders compile on first use.
+--record saves the camera of a live session as a path.
+*/
+const GLuint BENCHMARK_WARMUP_FRAMES = 10;
+GLuint benchmarkFrameCount = 0;
+std::string benchmarkOutput, cameraPathInput, cameraPathOutput;
+CameraPath cameraPath;
+FrameTimings frameTimings;
+QueryRing frameTimeQuery;
+GLuint simulationStep = 0;  /* Steps since the start, the time of the camera path */
+GLuint benchmarkFrameIndex = 0;  /* Drawn by the render thread, warm-up included */
+uint64_t lastBenchmarkFrameEnd = 0;
+
+/*
+Count heap allocations per scope and per frame, and print them at exit
+(--alloc-report). --alloc-check N draws N frames on the null render device
+and fails if paintGL() allocates in any of them after the warm-up, when
+the frame's vectors and caches reach their steady size.
+*/
+const GLuint ALLOCATION_WARMUP_FRAMES = 10;
+GLboolean allocationReport = GL_FALSE;
+GLboolean allocationCheck = GL_FALSE;
+
+const std::vector<std::string> SKYBOX_TEX_PATHS = {
+    /* Credit: https://learnopengl.com/Advanced-OpenGL/Cubemaps */
+    "resources/skybox/right.jpg",
+    "resources/skybox/left.jpg",
+    "resources/skybox/top.jpg",
+    "resources/skybox/bottom.jpg",
+    "resources/skybox/front.jpg",
+    "resources/skybox/back.jpg",
+};
+
 // GLboolean fullscreenEnabled = GL_FALSE;
 // GLint windowXPos, windowYPos;
 // GLint nonFullscreenWidth, nonFullscreenHeight;
 
 /* ----- Define function prototypes ----- */
+GLboolean parseArguments(int argc, char* argv[]);
+void simulate(FrameState& state);
+void renderLoop(GLFWwindow* window);
+GLboolean setupHeadlessGL(HeadlessContext& context);
+int runHeadless(void);
+int runServer(void);
+int runPoster(void);
+int runSoftware(void);
+int runNullDevice(void);
+void writeProfile(void);
+GLboolean setupBenchmark(void);
+GLboolean beginBenchmarkFrame(void);
+void recordBenchmarkFrame(uint64_t paintTime);
+void finishBenchmark(void);
+int writeBenchmarkReport(void);
+std::string escapeJSON(const std::string& text);
+void paintSoftware(GLuint frameIndex);
+void headlessRenderLoop(const HeadlessContext* context);
 void paintGL(void);
+void setTextureShaderUniforms(const Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+const Shader& useTextureShader(GLuint materialID);
+void gatherDrawItems(void);
+void cullDrawItems(glm::mat4 viewProjectionMatrix);
+void occludeDrawItems(glm::mat4 viewProjectionMatrix);
+void drawDepthPrepass(glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+void sortDrawItemsByState(glm::mat4 viewMatrix);
+void buildDrawCommands(void);
+void drawObjects(void);
+void reportFrameStats(void);
+void setupLights(void);
+void setupBenchmarkLights(GLuint count, GLuint spotCount);
+GLfloat benchmarkRandomReal(GLfloat a, GLfloat b);
+glm::vec3 benchmarkRandomColor(void);
+void updateBenchmarkLights(void);
+void placeOrbitingLight(Entity entity, const OrbitComponent& orbit);
+void setupScene(void);
+Entity createRenderable(GLuint parentNode, glm::mat4 localMatrix, GLuint meshID, GLuint materialID);
+void attachMesh(Entity entity, GLuint meshID, GLuint materialID);
+void setupSphereField(GLuint count);
+void loadAssets(void);
 void sendObjectsToOpenGL(void);
+void setupTextureShader(GLuint permutation);
 void initializeGL(void);
-void sendObject(GLuint objectID, const char* objPath, GLuint* vboID, GLuint* eboID);
+GLuint loadMesh(const char* objPath);
+GLuint addMeshAsset(const Model& obj);
+GLuint loadMaterial(const char* diffusePath, const char* specularPath, const char* normalPath, GLfloat shininess);
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void smoothKeyCallback(void);
@@ -75,13 +376,40 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
 int main(int argc, char* argv[])
 {
-    /* Allocate memory */
-    objectInfo = new(std::nothrow) ObjectInfo[OBJECT_COUNT];
-    if (!objectInfo) {
-        std::cerr << "ERR: Failed to allocate memory" << std::endl;
+    if (!parseArguments(argc, argv))
         return -1;
+    if (!profileOutput.empty()) {
+        setupProfiler();
+        nameProfilerThread("Main");
+        atexit(writeProfile);  /* Also after an error exit */
     }
-    
+    if (benchmarkFrameCount && !setupBenchmark())
+        return -1;
+    if (allocationReport || allocationCheck) {
+        setupAllocationTracker(ALLOCATION_WARMUP_FRAMES);
+        if (allocationReport)
+            atexit(reportAllocations);
+    }
+
+    if (cullBenchmarkObjects) {
+        benchmarkFrustumCulling(cullBenchmarkObjects, 100);
+        return 0;
+    }
+    if (occlusionCheck)
+        return checkOcclusionCulling() ? 0 : 1;
+    if (!serverBenchmarkSocket.empty()) {
+        benchmarkRenderServer(serverBenchmarkSocket, serverBenchmarkFrames);
+        return 0;
+    }
+    if (!serverSocket.empty())
+        return runServer();
+    if (!posterOutput.empty())
+        return runPoster();
+    if (nullFrameCount)
+        return runNullDevice();
+    if (headless)
+        return softwareRendering ? runSoftware() : runHeadless();
+
     /* Initialize GLFW */
     if (!glfwInit()) {
         std::cerr << "ERR: Failed to initialize GLFW" << std::endl;
@@ -98,7 +426,8 @@ int main(int argc, char* argv[])
 #endif
     
     // glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);  /* Disable resizing */
-    glfwWindowHint(GLFW_SAMPLES, 4);  /* Use 4x MSAA */
+    /* Use 4x MSAA (not with the deferred path, whose depth is blitted to the window) */
+    glfwWindowHint(GLFW_SAMPLES, renderPath == DEFERRED_PATH ? 0 : 4);
 
     /* Create a window and its OpenGL context */
     GLFWwindow* window = glfwCreateWindow(scrWidth, scrHeight, TITLE, NULL, NULL);
@@ -109,7 +438,7 @@ int main(int argc, char* argv[])
     }
     
     glfwMakeContextCurrent(window);  /* Make the window's context current */
-    glfwSwapInterval(1);  /* Enable v-sync */
+    glfwSwapInterval(benchmarkFrameCount ? 0 : 1);  /* Enable v-sync, except in benchmarks */
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);  /* Disable cursor */
 
     /* Register callback functions */
@@ -128,214 +457,1348 @@ int main(int argc, char* argv[])
 
     showOpenGLInfo();
     initializeGL();
+    if (!captureOutput.empty()) {
+        const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());  /* Frames come at the v-sync rate */
+        GLint framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        if (!frameCapture.setupFrameCapture(captureOutput, framebufferWidth, framebufferHeight, videoMode ? videoMode->refreshRate : 60)) {
+            glfwTerminate();
+            return -1;
+        }
+    }
+    statsStartTime = getTimeNs();
+    simulationClock.setupFixedTimestep(simulationRate, 8);
+    deltaTime = simulationClock.getStepSeconds();
 
-    /* Loop until the user closes the window */
-    while (!glfwWindowShouldClose(window)) {
-        paintGL();  /* Render */
-        glfwSwapBuffers(window);  /* Swap front and back buffers */
+    /* Hand the context over to the render thread */
+    glfwMakeContextCurrent(NULL);
+    std::thread renderThread(renderLoop, window);
+
+    /* Loop until the user closes the window, or the benchmark ends */
+    while (!glfwWindowShouldClose(window) && (!benchmarkFrameCount || simulationStep < BENCHMARK_WARMUP_FRAMES + benchmarkFrameCount)) {
         glfwPollEvents();  /* Poll for and process events */
+        FrameState* state = frameStates.beginWrite();  /* Waits while the render thread is a frame behind */
+        if (!state)
+            break;
+        simulate(*state);
+        frameStates.publish();
     }
-    
-    delete[] objectInfo;
+    frameStates.close();
+    renderThread.join();
 
     glfwDestroyWindow(window);
     glfwTerminate();
 
+    if (!cameraPathOutput.empty() && !cameraPath.saveCameraPath(cameraPathOutput))
+        return -1;
+    return benchmarkFrameCount ? writeBenchmarkReport() : 0;
+}
+
+GLboolean parseArguments(int argc, char* argv[])
+{
+    GLboolean outputGiven = GL_FALSE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--clustered") == 0)
+            renderPath = CLUSTERED_PATH;
+        else if (strcmp(argv[i], "--deferred") == 0)
+            renderPath = DEFERRED_PATH;
+        else if (strcmp(argv[i], "--copies") == 0 && i + 1 < argc)
+            ironManCopies = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+            benchmarkLightCount = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--spot-lights") == 0 && i + 1 < argc)
+            benchmarkSpotLightCount = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+            sphereFieldSize = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc)
+            simulationRate = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            jobThreadCount = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--headless") == 0 && i + 2 < argc) {
+            headless = GL_TRUE;
+            scrWidth = std::atoi(argv[++i]);
+            scrHeight = std::atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            headlessFrameCount = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            headlessOutput = argv[++i];
+            outputGiven = GL_TRUE;
+        }
+        else if (strcmp(argv[i], "--null") == 0 && i + 1 < argc) {
+            headless = GL_TRUE;  /* One simulation step per frame */
+            nullFrameCount = static_cast<GLuint>(std::atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--software") == 0)
+            softwareRendering = GL_TRUE;
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            captureOutput = argv[++i];
+        else if (strcmp(argv[i], "--poster") == 0 && i + 3 < argc) {
+            posterWidth = std::atoi(argv[++i]);
+            posterHeight = std::atoi(argv[++i]);
+            posterOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+            serverSocket = argv[++i];
+        else if (strcmp(argv[i], "--serve-bench") == 0 && i + 2 < argc) {
+            serverBenchmarkSocket = argv[++i];
+            serverBenchmarkFrames = static_cast<GLuint>(std::atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--no-sort") == 0)
+            sortDrawItems = GL_FALSE;
+        else if (strcmp(argv[i], "--no-mdi") == 0)
+            multiDrawIndirect = GL_FALSE;
+        else if (strcmp(argv[i], "--no-persistent-map") == 0)
+            persistentMapping = GL_FALSE;
+        else if (strcmp(argv[i], "--prepass") == 0)
+            depthPrepass = GL_TRUE;
+        else if (strcmp(argv[i], "--stats") == 0)
+            showStats = GL_TRUE;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            profileOutput = argv[++i];
+        else if (strcmp(argv[i], "--bench") == 0 && i + 2 < argc) {
+            benchmarkFrameCount = static_cast<GLuint>(std::atoi(argv[++i]));
+            benchmarkOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+            cameraPathInput = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            cameraPathOutput = argv[++i];
+        else if (strcmp(argv[i], "--alloc-report") == 0)
+            allocationReport = GL_TRUE;
+        else if (strcmp(argv[i], "--alloc-check") == 0 && i + 1 < argc) {
+            headless = GL_TRUE;  /* One simulation step per frame */
+            allocationCheck = GL_TRUE;
+            nullFrameCount = static_cast<GLuint>(std::atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--cull-bench") == 0 && i + 1 < argc)
+            cullBenchmarkObjects = static_cast<GLuint>(std::atoi(argv[++i]));
+        else if (strcmp(argv[i], "--occlusion") == 0)
+            occlusionCulling = GL_TRUE;
+        else if (strcmp(argv[i], "--occlusion-check") == 0)
+            occlusionCheck = GL_TRUE;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [options]" << std::endl;
+            std::cerr << "  --clustered   Use clustered forward shading (toggle with C)" << std::endl;
+            std::cerr << "  --deferred    Use deferred shading" << std::endl;
+            std::cerr << "  --lights N    Add N moving point lights (benchmark scene, needs --clustered or --deferred)" << std::endl;
+            std::cerr << "  --spot-lights N  Add N moving spot lights aimed at the scene (needs --clustered or --deferred)" << std::endl;
+            std::cerr << "  --copies N    Draw N more iron men behind the first one (overdraw benchmark)" << std::endl;
+            std::cerr << "  --instances N Draw N small spheres behind the scene (instancing benchmark)" << std::endl;
+            std::cerr << "  --sim-rate N  Simulate N fixed steps per second (default: 120)" << std::endl;
+            std::cerr << "  --threads N   Run the per-frame CPU work on N threads (default: one per core)" << std::endl;
+            std::cerr << "  --headless W H  Render W x H frames offscreen without a window (EGL on Linux, CGL on macOS)" << std::endl;
+            std::cerr << "  --frames N    Number of headless frames (default: 1)" << std::endl;
+            std::cerr << "  --output P    Write headless frames to P0000.ppm, P0001.ppm, ... (default: frame; \"\" to discard them)" << std::endl;
+            std::cerr << "  --software    Draw the headless frames with the multithreaded CPU rasterizer instead of OpenGL" << std::endl;
+            std::cerr << "  --null N      Time N frames submitted to a render device that only counts commands (no GL context), and exit" << std::endl;
+            std::cerr << "  --capture F   Record every frame to F: *.y4m, raw RGB24 otherwise, or \"|command\" to pipe Y4M to an encoder" << std::endl;
+            std::cerr << "  --poster W H F  Render a W x H screenshot to the PPM file F in tiles of the --headless size, and exit" << std::endl;
+            std::cerr << "  --serve S     Render frames on request from a client of the Unix socket S (size from --headless)" << std::endl;
+            std::cerr << "  --serve-bench S N  Request N frames from the render server at S, report frames/s and latency, and exit" << std::endl;
+            std::cerr << "  --no-sort     Submit draw items in scene order instead of sorting them by state" << std::endl;
+            std::cerr << "  --no-mdi      Replay draws one by one instead of glMultiDrawElementsIndirect" << std::endl;
+            std::cerr << "  --no-persistent-map  Map the stream ring every frame instead of once with glBufferStorage" << std::endl;
+            std::cerr << "  --prepass     Draw a depth pre-pass before shading (toggle with Z)" << std::endl;
+            std::cerr << "  --stats       Print frame statistics every second" << std::endl;
+            std::cerr << "  --profile F   Write CPU scopes and GPU times to F as Chrome trace JSON (chrome://tracing, Perfetto)" << std::endl;
+            std::cerr << "  --bench N F   Draw N frames with v-sync off along a camera path, write frame/CPU/GPU time percentiles to F as JSON, and exit" << std::endl;
+            std::cerr << "  --path P      Camera path for --bench (\"TIME X Y Z YAW PITCH FOV\" per line; default: one orbit of the scene)" << std::endl;
+            std::cerr << "  --record P    Save the camera of this session to the path file P" << std::endl;
+            std::cerr << "  --alloc-report  Print the heap allocations per scope and per frame at exit" << std::endl;
+            std::cerr << "  --alloc-check N  Draw N frames on the null render device, fail if any allocates after the warm-up, and exit" << std::endl;
+            std::cerr << "  --occlusion   Cull objects hidden behind occluders on the CPU (toggle with O)" << std::endl;
+            std::cerr << "  --cull-bench N  Time frustum culling of N random objects and exit" << std::endl;
+            std::cerr << "  --occlusion-check  Check the software occlusion culler and exit" << std::endl;
+            return GL_FALSE;
+        }
+    }
+    if (benchmarkFrameCount) {
+        headlessFrameCount = BENCHMARK_WARMUP_FRAMES + benchmarkFrameCount;
+        if (!outputGiven)
+            headlessOutput.clear();  /* Time the rendering, not the PPM files */
+    }
+    return GL_TRUE;
+}
+
+/* Load the camera path of the benchmark, or script an orbit of the scene that lasts exactly the run */
+GLboolean setupBenchmark(void)
+{
+    if (!cameraPathInput.empty())
+        return cameraPath.loadCameraPath(cameraPathInput);
+
+    const GLuint KEY_COUNT = 64;
+    GLfloat duration = static_cast<GLfloat>(benchmarkFrameCount) / simulationRate;
+    for (GLuint i = 0; i <= KEY_COUNT; i++) {
+        GLfloat angle = glm::radians(360.0f * i / KEY_COUNT);
+        glm::vec3 pos(20.0f * glm::sin(angle), 5.0f, 20.0f * glm::cos(angle));
+        glm::vec3 front = glm::normalize(glm::vec3(0.0f, 2.0f, 0.0f) - pos);
+        cameraPath.addKey({duration * i / KEY_COUNT, pos, glm::degrees(glm::atan(front.z, front.x)), glm::degrees(glm::asin(front.y)), 45.0f});
+    }
+    return GL_TRUE;
+}
+
+/* On the render thread, before paintGL(): whether the frame is timed */
+GLboolean beginBenchmarkFrame(void)
+{
+    if (!benchmarkFrameCount || benchmarkFrameIndex++ < BENCHMARK_WARMUP_FRAMES)
+        return GL_FALSE;
+    frameTimeQuery.begin();
+    return GL_TRUE;
+}
+
+/* On the render thread, after each frame is presented */
+void recordBenchmarkFrame(uint64_t paintTime)
+{
+    uint64_t now = getTimeNs();
+    if (benchmarkFrameIndex > BENCHMARK_WARMUP_FRAMES)
+        frameTimings.addFrame(now - lastBenchmarkFrameEnd, paintTime);
+    lastBenchmarkFrameEnd = now;
+    GLuint64 gpuTime;
+    while (frameTimeQuery.takeResult(gpuTime, GL_FALSE))
+        frameTimings.addGpuTime(gpuTime);
+}
+
+/* On the render thread: wait for the GPU times still in flight */
+void finishBenchmark(void)
+{
+    GLuint64 gpuTime;
+    while (frameTimeQuery.takeResult(gpuTime, GL_TRUE))
+        frameTimings.addGpuTime(gpuTime);
+}
+
+int writeBenchmarkReport(void)
+{
+    std::ostringstream config;
+    config << "{\"renderPath\": \"" << RENDER_PATH_NAMES[renderPath] << "\", \"width\": " << scrWidth << ", \"height\": " << scrHeight
+           << ", \"headless\": " << (headless ? "true" : "false") << ", \"cameraPath\": \"" << (cameraPathInput.empty() ? "orbit" : escapeJSON(cameraPathInput))
+           << "\", \"simulationRate\": " << simulationRate << ", \"threads\": " << jobSystem.getThreadCount()
+           << ", \"lights\": " << benchmarkLightCount << ", \"spotLights\": " << benchmarkSpotLightCount << ", \"instances\": " << sphereFieldSize
+           << ", \"copies\": " << ironManCopies << ", \"depthPrepass\": " << (depthPrepass ? "true" : "false")
+           << ", \"occlusionCulling\": " << (occlusionCulling ? "true" : "false") << ", \"sortDrawItems\": " << (sortDrawItems ? "true" : "false")
+           << ", \"multiDrawIndirect\": " << (multiDrawIndirect ? "true" : "false") << "}";
+    return frameTimings.writeReport(benchmarkOutput, config.str()) ? 0 : -1;
+}
+
+/* Escape text for use between the quotes of a JSON string */
+std::string escapeJSON(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            escaped += std::string("\\") + c;
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+/*
+Render headlessFrameCount frames into headlessTarget, simulated on this
+thread and drawn on a render thread as with a window. Every frame is one
+simulation step, so image sequences do not depend on the rendering speed.
+*/
+int runHeadless(void)
+{
+    HeadlessContext context;
+    if (!setupHeadlessGL(context))
+        return -1;
+    headlessTarget.setupFramebuffer(scrWidth, scrHeight, renderPath == DEFERRED_PATH ? 0 : 4);
+    outputFramebuffer = headlessTarget.getID();
+    if (!captureOutput.empty() && !frameCapture.setupFrameCapture(captureOutput, scrWidth, scrHeight, simulationRate))
+        return -1;
+    statsStartTime = getTimeNs();
+    simulationClock.setupFixedTimestep(simulationRate, 8);
+    deltaTime = simulationClock.getStepSeconds();
+
+    context.releaseCurrent();
+    uint64_t startTime = getTimeNs();
+    std::thread renderThread(headlessRenderLoop, &context);
+    for (GLuint i = 0; i < headlessFrameCount; i++) {
+        FrameState* state = frameStates.beginWrite();
+        if (!state)
+            break;
+        simulate(*state);
+        frameStates.publish();
+    }
+    frameStates.close();
+    renderThread.join();
+
+    double seconds = 1e-9 * (getTimeNs() - startTime);
+    std::cout << "INF: Rendered " << headlessFrameCount << " frames of " << scrWidth << "x" << scrHeight << " in "
+              << seconds << " s (" << headlessFrameCount / seconds << " frames/s)" << std::endl;
+    if (!cameraPathOutput.empty() && !cameraPath.saveCameraPath(cameraPathOutput))
+        return -1;
+    return benchmarkFrameCount ? writeBenchmarkReport() : 0;
+}
+
+/* Create a windowless context, current on this thread, and set up the scene */
+GLboolean setupHeadlessGL(HeadlessContext& context)
+{
+    if (!context.setupHeadlessContext(3, 3))
+        return GL_FALSE;
+    context.makeCurrent();
+
+    /* GLEW built for GLX finds no X display, but only after loading the OpenGL entry points */
+    GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK && glewStatus != GLEW_ERROR_NO_GLX_DISPLAY) {
+        std::cerr << "ERR: Failed to initialize GLEW" << std::endl;
+        return GL_FALSE;
+    }
+
+    showOpenGLInfo();
+    initializeGL();
+    return GL_TRUE;
+}
+
+/* The global scene, edited and drawn by the commands of the render server */
+class ServerScene : public RenderServerScene
+{
+public:
+    FrameState state;
+
+    GLboolean addMesh(const std::string& path, glm::vec3 pos, GLfloat scale, GLuint& entity) override
+    {
+        Model obj;
+        if (!loadOBJ(path.c_str(), obj))
+            return GL_FALSE;
+        GLuint meshID = addMeshAsset(obj);
+        geometryArena.upload(GL_TRUE);
+        glm::mat4 localMatrix = glm::scale(glm::translate(glm::mat4(1.0f), pos), glm::vec3(scale));
+        entity = createRenderable(TransformHierarchy::NO_PARENT, localMatrix, meshID, serverMaterial);
+        return GL_TRUE;
+    }
+
+    GLuint getPointLightCount(void) const override
+    {
+        return static_cast<GLuint>(registry.pointLights.size());
+    }
+
+    void setPointLight(GLuint index, glm::vec3 pos, glm::vec3 intensity) override
+    {
+        if (index == registry.pointLights.size()) {
+            PointLight pointLight;
+            pointLight.light = {glm::vec3(0.4f), glm::vec3(0.5f), intensity};
+            pointLight.attenuation = {1.0f, 0.01f, 0.001f};
+            registry.pointLights.add(registry.createEntity(), pointLight);
+        }
+        registry.pointLights[index].pos = pos;
+        registry.pointLights[index].light.intensity = intensity;
+    }
+
+    /* On this thread, which owns the context, then read back straight into the frame ring */
+    void render(glm::vec3 eye, glm::vec3 target, GLfloat fov, unsigned char* rgba) override
+    {
+        state.cameraPos = eye;
+        state.viewMatrix = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+        state.projectionMatrix = glm::perspective(glm::radians(fov), static_cast<GLfloat>(scrWidth) / static_cast<GLfloat>(scrHeight), 0.01f, FAR);
+        state.pointLights = registry.pointLights.getComponents();
+        state.spotLights = registry.spotLights.getComponents();
+        frameState = &state;
+        paintGL();
+
+        headlessTarget.resolve();
+        getRenderDevice().pixelStorei(GL_PACK_ALIGNMENT, 4);
+        getRenderDevice().readPixels(0, 0, scrWidth, scrHeight, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    }
+};
+
+/* Serve frames to one local client at a time, with the commands of RenderServer::serve() */
+int runServer(void)
+{
+    HeadlessContext context;
+    if (!setupHeadlessGL(context))
+        return -1;
+    headlessTarget.setupFramebuffer(scrWidth, scrHeight, renderPath == DEFERRED_PATH ? 0 : 4);
+    outputFramebuffer = headlessTarget.getID();
+
+    SharedFrameRing frames;
+    RenderServer server;
+    if (!frames.createSharedFrameRing("/opengl-template-" + std::to_string(getpid()), scrWidth, scrHeight, SERVER_FRAME_SLOTS) ||
+        !server.setupRenderServer(serverSocket))
+        return -1;
+
+    ServerScene scene;
+    scene.state.width = scrWidth;
+    scene.state.height = scrHeight;
+    scene.state.renderPath = renderPath;
+    scene.state.showGrid = showGrid;
+    scene.state.depthPrepass = depthPrepass;
+    scene.state.occlusionCulling = occlusionCulling;
+    uint64_t frameCount = server.serve(scene, frames, camera.getPos(), camera.getPos() + camera.getFront(), camera.getFOV());
+
+    server.close();
+    frames.close();
+    std::cout << "INF: Served " << frameCount << " frames" << std::endl;
+    return 0;
+}
+
+/*
+Render posterWidth x posterHeight pixels as seen by the camera, one tile of
+the --headless size at a time through the off-axis frustum of the tile.
+*/
+int runPoster(void)
+{
+    HeadlessContext context;
+    if (!setupHeadlessGL(context))
+        return -1;
+    PosterRenderer poster;
+    if (!poster.setupPosterRenderer(posterOutput, posterWidth, posterHeight, scrWidth, scrHeight, renderPath == DEFERRED_PATH ? 0 : 4))
+        return -1;
+    outputFramebuffer = poster.getTarget().getID();
+
+    FrameState state;
+    state.cameraPos = camera.getPos();
+    state.viewMatrix = glm::lookAt(camera.getPos(), camera.getPos() + camera.getFront(), camera.getUp());
+    state.width = poster.getTarget().getWidth();
+    state.height = poster.getTarget().getHeight();
+    state.renderPath = renderPath;
+    state.showGrid = showGrid;
+    state.depthPrepass = depthPrepass;
+    state.occlusionCulling = occlusionCulling;
+    state.pointLights = registry.pointLights.getComponents();
+    state.spotLights = registry.spotLights.getComponents();
+    frameState = &state;
+
+    uint64_t startTime = getTimeNs();
+    for (GLuint tile = 0; tile < poster.getTileCount(); tile++) {
+        state.projectionMatrix = poster.getTileProjection(tile, camera.getFOV(), 0.01f, FAR);
+        paintGL();
+        poster.readTile(tile);
+    }
+    if (!poster.finish())
+        return -1;
+
+    double seconds = 1e-9 * (getTimeNs() - startTime);
+    std::cout << "INF: Rendered " << poster.getTileCount() << " tiles in " << seconds << " s (" << poster.getTileCount() / seconds
+              << " tiles/s)" << std::endl;
+    return 0;
+}
+
+/*
+Headless rendering on the CPU: the same scene, simulation and output files
+as runHeadless(), with every frame drawn by softwareRenderer on the job
+system's threads. There is no grid and no render thread.
+*/
+int runSoftware(void)
+{
+    jobSystem.setupJobSystem(jobThreadCount ? jobThreadCount : std::thread::hardware_concurrency());
+    softwareRenderer.setupSoftwareRenderer(scrWidth, scrHeight, &jobSystem);
+    softwareRenderer.setupSkybox(SKYBOX_TEX_PATHS);
+    loadAssets();
+    setupLights();
+    setupScene();
+    simulationClock.setupFixedTimestep(simulationRate, 8);
+    deltaTime = simulationClock.getStepSeconds();
+
+    FrameState state;
+    frameState = &state;
+    uint64_t startTime = getTimeNs();
+    for (GLuint i = 0; i < headlessFrameCount; i++) {
+        simulate(state);
+        paintSoftware(i);
+    }
+
+    double seconds = 1e-9 * (getTimeNs() - startTime);
+    std::cout << "INF: Rendered " << headlessFrameCount << " frames of " << scrWidth << "x" << scrHeight << " in "
+              << seconds << " s (" << headlessFrameCount / seconds << " frames/s, " << softwareRenderer.getTriangleCount()
+              << " triangles in the last one)" << std::endl;
+    return 0;
+}
+
+/*
+Time paintGL() alone, with every command going to a NullRenderDevice: the
+scene, culling, sorting, uniforms and streaming all run, but nothing
+reaches a driver. Deferred shading needs real framebuffers.
+*/
+int runNullDevice(void)
+{
+    if (renderPath == DEFERRED_PATH) {
+        std::cerr << "ERR: The null render device cannot run the deferred path" << std::endl;
+        return -1;
+    }
+    NullRenderDevice device;
+    setRenderDevice(&device);
+    initializeGL();
+    statsStartTime = getTimeNs();
+    simulationClock.setupFixedTimestep(simulationRate, 8);
+    deltaTime = simulationClock.getStepSeconds();
+
+    FrameState state;
+    frameState = &state;
+    uint64_t totalTime = 0, minTime = UINT64_MAX;
+    GLuint64 totalCommands[NullRenderDevice::COMMAND_KIND_COUNT] = {0}, totalUploadBytes = 0;
+    for (GLuint i = 0; i < nullFrameCount; i++) {
+        simulate(state);
+        device.resetCounters();
+        uint64_t startTime = getTimeNs();
+        paintGL();
+        uint64_t frameTime = getTimeNs() - startTime;
+        totalTime += frameTime;
+        minTime = MIN(minTime, frameTime);
+        for (GLuint kind = 0; kind < NullRenderDevice::COMMAND_KIND_COUNT; kind++)
+            totalCommands[kind] += device.getCommandCount(static_cast<NullRenderDevice::CommandKind>(kind));
+        totalUploadBytes += device.getUploadBytes();
+    }
+    setRenderDevice(NULL);
+
+    GLuint frames = MAX(nullFrameCount, 1u);
+    std::cout << "INF: " << nullFrameCount << " frames on the null render device: " << 1e-6 * totalTime / frames << " ms mean, "
+              << 1e-6 * minTime << " ms min of CPU time in paintGL()" << std::endl;
+    std::cout << "INF: Commands per frame:";
+    for (GLuint kind = 0; kind < NullRenderDevice::COMMAND_KIND_COUNT; kind++)
+        std::cout << " " << totalCommands[kind] / frames << " " << NullRenderDevice::getCommandKindName(static_cast<NullRenderDevice::CommandKind>(kind));
+    std::cout << ", " << (totalUploadBytes / frames >> 10) << " KB uploaded" << std::endl;
+    if (allocationCheck) {
+        if (getSteadyAllocationCount()) {
+            reportAllocations();
+            std::cerr << "ERR: paintGL() allocated after the warm-up" << std::endl;
+            return 1;
+        }
+        std::cout << "INF: paintGL() did not allocate after " << ALLOCATION_WARMUP_FRAMES << " warm-up frames" << std::endl;
+    }
     return 0;
 }
 
+/* Registered with atexit() by --profile */
+void writeProfile(void)
+{
+    writeChromeTrace(profileOutput);
+}
+
+/* Software counterpart of paintGL() and the readback of headlessRenderLoop() */
+void paintSoftware(GLuint frameIndex)
+{
+    PROFILE_SCOPE("paintSoftware");
+    const FrameState& frame = *frameState;
+    transforms.update(&jobSystem);
+    softwareDraws.resize(registry.meshes.size());
+    for (size_t i = 0; i < registry.meshes.size(); i++) {
+        Entity entity = registry.meshes.getEntity(i);
+        SoftwareDraw& draw = softwareDraws[i];
+        draw.meshID = meshAssets[registry.meshes[i].meshID].arenaMeshID;
+        draw.materialID = registry.materials.get(entity).materialID;
+        draw.modelMatrix = transforms.getWorldMatrix(registry.transforms.get(entity).node);
+        draw.emissionK = registry.emissions.has(entity) ? registry.emissions.get(entity).emissionK : glm::vec3(0.0f);
+    }
+
+    /* The point lights the OpenGL path would shade */
+    GLuint pointLightCount = static_cast<GLuint>(frame.pointLights.size());
+    if (frame.renderPath == FORWARD_PATH)
+        pointLightCount = MIN(pointLightCount, N_FORWARD_POINT_LIGHTS);
+    softwarePointLights.assign(frame.pointLights.begin(), frame.pointLights.begin() + pointLightCount);
+    if (frame.renderPath == FORWARD_PATH)
+        softwareSpotLights.clear();
+    else
+        softwareSpotLights = frame.spotLights;
+
+    SoftwareFrame softwareFrame;
+    softwareFrame.viewMatrix = frame.viewMatrix;
+    softwareFrame.projectionMatrix = frame.projectionMatrix;
+    softwareFrame.cameraPos = frame.cameraPos;
+    softwareFrame.ambientK = AMBIENT_K;
+    softwareFrame.draws = &softwareDraws;
+    softwareFrame.pointLights = &softwarePointLights;
+    softwareFrame.spotLights = &softwareSpotLights;
+    softwareFrame.dirLights = &dirLights;
+    softwareRenderer.render(softwareFrame);
+
+    if (!headlessOutput.empty()) {
+        std::string index = std::to_string(frameIndex);
+        std::string path = headlessOutput + std::string(index.size() < 4 ? 4 - index.size() : 0, '0') + index + ".ppm";
+        if (!writePPM(path, scrWidth, scrHeight, softwareRenderer.getPixels().data()))
+            headlessOutput.clear();
+    }
+}
+
+/* Headless counterpart of renderLoop(): read every frame back and write it to disk, or to the capture */
+void headlessRenderLoop(const HeadlessContext* context)
+{
+    std::vector<unsigned char> pixels;
+    GLuint frameIndex = 0;
+
+    nameProfilerThread("Render");
+    context->makeCurrent();
+    while ((frameState = frameStates.acquire())) {
+        GLboolean timed = beginBenchmarkFrame();
+        uint64_t paintStart = getTimeNs();
+        paintGL();
+        uint64_t paintTime = getTimeNs() - paintStart;
+        if (timed)
+            frameTimeQuery.end();
+        if (frameCapture.isActive()) {
+            headlessTarget.resolve();
+            frameCapture.capture(frameState->width, frameState->height);
+        }
+        else if (!headlessOutput.empty()) {
+            headlessTarget.readPixels(pixels);
+            std::string index = std::to_string(frameIndex);
+            std::string path = headlessOutput + std::string(index.size() < 4 ? 4 - index.size() : 0, '0') + index + ".ppm";
+            if (!writePPM(path, scrWidth, scrHeight, pixels.data()))
+                headlessOutput.clear();  /* Report the failure once, keep rendering */
+        }
+        if (benchmarkFrameCount)
+            recordBenchmarkFrame(paintTime);
+        frameIndex++;
+    }
+    if (benchmarkFrameCount)
+        finishBenchmark();
+    frameCapture.finish();
+    context->releaseCurrent();
+}
+
+/*
+Run the simulation steps due since the last frame and record what the render
+thread needs, interpolated between the last two steps. Mouse look is not
+integrated over time, so the view direction is always the latest one.
+*/
+void simulate(FrameState& state)
+{
+    ALLOCATION_SCOPE("simulate");
+    const std::vector<PointLight>& pointLights = registry.pointLights.getComponents();
+    const std::vector<SpotLight>& spotLights = registry.spotLights.getComponents();
+    if (previousLightPositions.size() != pointLights.size() || previousSpotLights.size() != spotLights.size()) {
+        previousCameraPos = camera.getPos();
+        previousLightPositions.resize(pointLights.size());
+        for (size_t i = 0; i < pointLights.size(); i++)
+            previousLightPositions[i] = pointLights[i].pos;
+        previousSpotLights = spotLights;
+    }
+
+    GLboolean oneStepPerFrame = headless || benchmarkFrameCount;
+    GLuint steps = oneStepPerFrame ? simulationClock.advance(simulationClock.getStepNs()) : simulationClock.advance();
+    for (GLuint step = 0; step < steps; step++) {
+        previousCameraPos = camera.getPos();
+        for (size_t i = 0; i < pointLights.size(); i++)
+            previousLightPositions[i] = pointLights[i].pos;
+        for (size_t i = 0; i < spotLights.size(); i++)
+            previousSpotLights[i] = spotLights[i];
+        if (benchmarkFrameCount) {  /* The path alone moves the camera */
+            GLuint pathStep = simulationStep - MIN(simulationStep, BENCHMARK_WARMUP_FRAMES);
+            CameraKey key = cameraPath.sample(pathStep * simulationClock.getStepSeconds());
+            camera.setPose(key.pos, glm::radians(key.yaw), glm::radians(key.pitch), key.fov);
+        }
+        else {
+            smoothKeyCallback();
+            if (!cameraPathOutput.empty())
+                cameraPath.addKey({simulationStep * simulationClock.getStepSeconds(), camera.getPos(), glm::degrees(camera.getYaw()),
+                                   glm::degrees(camera.getPitch()), camera.getFOV()});
+        }
+        simulationStep++;
+        updateBenchmarkLights();
+    }
+
+    GLfloat alpha = simulationClock.getAlpha();
+    state.cameraPos = glm::mix(previousCameraPos, camera.getPos(), alpha);
+    state.viewMatrix = glm::lookAt(state.cameraPos, state.cameraPos + camera.getFront(), camera.getUp());
+    state.projectionMatrix = glm::perspective(glm::radians(camera.getFOV()), static_cast<GLfloat>(scrWidth) / static_cast<GLfloat>(scrHeight), 0.01f, FAR);
+    state.width = scrWidth;
+    state.height = scrHeight;
+    state.renderPath = renderPath;
+    state.showGrid = showGrid;
+    state.depthPrepass = depthPrepass;
+    state.occlusionCulling = occlusionCulling;
+    state.pointLights = pointLights;
+    for (size_t i = 0; i < pointLights.size(); i++)
+        state.pointLights[i].pos = glm::mix(previousLightPositions[i], pointLights[i].pos, alpha);
+    state.spotLights = spotLights;
+    for (size_t i = 0; i < spotLights.size(); i++) {
+        state.spotLights[i].pos = glm::mix(previousSpotLights[i].pos, spotLights[i].pos, alpha);
+        state.spotLights[i].dir = glm::mix(previousSpotLights[i].dir, spotLights[i].dir, alpha);
+    }
+}
+
+/* Draw every published frame state until the main thread closes the exchange */
+void renderLoop(GLFWwindow* window)
+{
+    nameProfilerThread("Render");
+    glfwMakeContextCurrent(window);
+    while ((frameState = frameStates.acquire())) {
+        GLboolean timed = beginBenchmarkFrame();
+        uint64_t paintStart = getTimeNs();
+        paintGL();  /* Render */
+        uint64_t paintTime = getTimeNs() - paintStart;
+        if (timed)
+            frameTimeQuery.end();
+        if (frameCapture.isActive()) {
+            getRenderDevice().bindFramebuffer(GL_READ_FRAMEBUFFER, 0);  /* The back buffer */
+            frameCapture.capture(frameState->width, frameState->height);
+        }
+        glfwSwapBuffers(window);  /* Swap front and back buffers */
+        if (benchmarkFrameCount)
+            recordBenchmarkFrame(paintTime);
+    }
+    if (benchmarkFrameCount)
+        finishBenchmark();
+    frameCapture.finish();
+    glfwMakeContextCurrent(NULL);
+}
+
 void paintGL(void)
 {
-    GLfloat currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
+    PROFILE_SCOPE("paintGL");
+    ALLOCATION_SCOPE("paintGL");
+    beginAllocationFrame();
+    const FrameState& frame = *frameState;
+    if (frame.width != viewportWidth || frame.height != viewportHeight) {
+        viewportWidth = frame.width;
+        viewportHeight = frame.height;
+        getRenderDevice().viewport(0, 0, viewportWidth, viewportHeight);
+        if (frame.renderPath == DEFERRED_PATH)
+            deferred.resize(viewportWidth, viewportHeight);
+    }
+    getRenderDevice().bindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
 
-    glClearColor(R(51), G(51), B(51), 1.0f);  /* Specify the background color */
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    smoothKeyCallback();
+    getRenderDevice().clearColor(R(51), G(51), B(51), 1.0f);  /* Specify the background color */
+    getRenderDevice().clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glm::mat4 modelMatrix;
-    glm::mat4 viewMatrix = camera.getViewMatrix();
-    glm::mat4 projectionMatrix = glm::perspective(glm::radians(camera.getFOV()), static_cast<GLfloat>(scrWidth) / static_cast<GLfloat>(scrHeight), 0.01f, FAR);
+    glm::mat4 viewMatrix = frame.viewMatrix;
+    glm::mat4 projectionMatrix = frame.projectionMatrix;
+
+    if (frame.renderPath == DEFERRED_PATH)
+        deferred.beginGeometryPass();
+    else if (frame.showGrid) {
+        gpuTimers.begin("Grid");
+        grid.draw(viewMatrix, projectionMatrix, frame.cameraPos);
+        gpuTimers.end();
+    }
+
+    streamRing.beginFrame();
+    if (frame.renderPath != FORWARD_PATH)
+        lightBuffer.upload(frame.pointLights, frame.spotLights);
+    if (frame.renderPath == CLUSTERED_PATH) {
+        clusterGrid.build(viewMatrix, projectionMatrix, NEAR, FAR, frame.width, frame.height, frame.pointLights, frame.spotLights);
+        lightBuffer.bind(LIGHT_DATA_SLOT);
+        clusterGrid.bind(CLUSTER_GRID_SLOT, LIGHT_INDEX_SLOT);
+    }
+
+    for (GLuint permutation = 0; permutation < Material::PERMUTATION_COUNT; permutation++)
+        if (textureShaderReady[frame.renderPath][permutation])
+            setTextureShaderUniforms(textureShaders[frame.renderPath][permutation], viewMatrix, projectionMatrix);
+
+    uint64_t drawListStart = getTimeNs();
+    {
+        PROFILE_SCOPE("Build draw list");
+        updatedTransformCount = transforms.update(&jobSystem);
+        gatherDrawItems();
+
+        cullDrawItems(projectionMatrix * viewMatrix);
+        if (frame.occlusionCulling)
+            occludeDrawItems(projectionMatrix * viewMatrix);
+        sortDrawItemsByState(viewMatrix);
+        buildDrawCommands();
+        streamRing.flush();
+    }
+    drawListTime += getTimeNs() - drawListStart;
+
+    if (frame.depthPrepass && frame.renderPath != DEFERRED_PATH) {
+        drawDepthPrepass(viewMatrix, projectionMatrix);
+        getRenderDevice().depthFunc(GL_EQUAL);  /* Only shade the visible fragments */
+        getRenderDevice().depthMask(GL_FALSE);
+    }
+    if (showStats)
+        shadedSamplesQuery.begin();
+    gpuTimers.begin("Objects");
+    drawObjects();
+    gpuTimers.end();
+    if (showStats)
+        shadedSamplesQuery.end();
+    getRenderDevice().depthFunc(GL_LESS);
+    getRenderDevice().depthMask(GL_TRUE);
+    drawItems.clear();
+
+    if (frame.renderPath == DEFERRED_PATH) {
+        deferred.endGeometryPass(outputFramebuffer);
+        const ArenaMesh& volume = geometryArena.getMesh(meshAssets[sphereMesh].arenaMeshID);
+        deferred.drawLights(viewMatrix, projectionMatrix, frame.cameraPos, AMBIENT_K, dirLights, lightBuffer,
+                            geometryArena.getVAO(GeometryArena::POSITION_STREAM), volume.indexCount, volume.posFirstIndex, volume.posBaseVertex,
+                            LIGHT_VOLUME_SCALE);
+        if (frame.showGrid) {
+            gpuTimers.begin("Grid");
+            grid.draw(viewMatrix, projectionMatrix, frame.cameraPos);
+            gpuTimers.end();
+        }
+    }
+
+    gpuTimers.begin("Skybox");
+    skybox.draw(viewMatrix, projectionMatrix);
+    gpuTimers.end();
+    streamRing.endFrame();
+    endAllocationFrame();  /* The diagnostics below may allocate */
+
+    if (showStats)
+        reportFrameStats();
+    if (profilerEnabled) {
+        gpuTimers.collect();
+        collectProfileEvents();
+    }
+}
 
-    if (showGrid)
-        grid.draw(viewMatrix, projectionMatrix, camera);
+/* Set the per-frame uniforms (camera and lights) of a texture shader */
+void setTextureShaderUniforms(const Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+{
+    GLuint i;
 
-    textureShader.use();
-    textureShader.setMat4("viewMatrix", viewMatrix);
-    textureShader.setMat4("projectionMatrix", projectionMatrix);
-    textureShader.setVec3("eyePosWorld", camera.getPos());
+    shader.use();
+    shader.setMat4("viewMatrix", viewMatrix);
+    shader.setMat4("projectionMatrix", projectionMatrix);
+    shader.setVec3("eyePosWorld", frameState->cameraPos);
 
     /* ----- Modify texture shader ----- */
-    glm::vec3 pointLightPos = glm::vec3(0.0f, 8.0f, 10.0f);
+    shader.setInt("material.diffuse", 0);
+    shader.setInt("material.specular", 1);
+    shader.setInt("material.normal", 2);
 
-    textureShader.setInt("material.diffuse", 0);
-    textureShader.setInt("material.specular", 1);
-    textureShader.setInt("material.normal", 2);
+    shader.setBool("useBlinn", GL_TRUE);
+    shader.setVec3("ambientK", AMBIENT_K);
+    /* --------------------------------- */
 
-    textureShader.setBool("useBlinn", GL_TRUE);
-    textureShader.setVec3("emissionK", glm::vec3(0.0f));
-    textureShader.setVec3("ambientK", glm::vec3(0.1f));
+    if (frameState->renderPath == DEFERRED_PATH)  /* Lights are applied by Deferred::drawLights() */
+        return;
 
     /*
     Remember to modify the N_X_LIGHTS macors in texture.fs. 
-    Also disable for-loop(s) in main() if that particular kind of light is not used at all.
+    The forward path only shades the first N_FORWARD_POINT_LIGHTS point lights.
     */
-    
-    textureShader.setVec3("pointLights[0].light.diffuseK", glm::vec3(0.4f));
-    textureShader.setVec3("pointLights[0].light.specularK", glm::vec3(0.5f));
-    textureShader.setVec3("pointLights[0].light.intensity", glm::vec3(5.0f));
-    textureShader.setVec3("pointLights[0].pos", pointLightPos);
-    textureShader.setFloat("pointLights[0].attenuation.a", 1.0f);
-    textureShader.setFloat("pointLights[0].attenuation.b", 0.01f);
-    textureShader.setFloat("pointLights[0].attenuation.c", 0.001f);
-
-    /* Directional light from the front */
-    textureShader.setVec3("dirLights[0].light.diffuseK", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[0].light.specularK", glm::vec3(0.5f));
-    textureShader.setVec3("dirLights[0].light.intensity", glm::vec3(2.0f));
-    textureShader.setVec3("dirLights[0].dir", glm::vec3(0.0f, 0.0f, 1.0f));
-
-    /* Directional light from the back */
-    textureShader.setVec3("dirLights[1].light.diffuseK", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[1].light.specularK", glm::vec3(0.5f));
-    textureShader.setVec3("dirLights[1].light.intensity", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[1].dir", glm::vec3(0.0f, 0.0f, -1.0f));
-
-    /* Directional light from the left */
-    textureShader.setVec3("dirLights[2].light.diffuseK", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[2].light.specularK", glm::vec3(0.5f));
-    textureShader.setVec3("dirLights[2].light.intensity", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[2].dir", glm::vec3(1.0f, 0.0f, 0.0f));
-
-    /* Directional light from the right */
-    textureShader.setVec3("dirLights[3].light.diffuseK", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[3].light.specularK", glm::vec3(0.5f));
-    textureShader.setVec3("dirLights[3].light.intensity", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[3].dir", glm::vec3(-1.0f, 0.0f, 0.0f));
-
-    /* Directional light from the top */
-    textureShader.setVec3("dirLights[4].light.diffuseK", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[4].light.specularK", glm::vec3(0.5f));
-    textureShader.setVec3("dirLights[4].light.intensity", glm::vec3(1.0f));
-    textureShader.setVec3("dirLights[4].dir", glm::vec3(0.0f, -1.0f, 0.0f));
-
-    /* Directional light from the bottom */
-    textureShader.setVec3("dirLights[5].light.diffuseK", glm::vec3(0.4f));
-    textureShader.setVec3("dirLights[5].light.specularK", glm::vec3(0.5f));
-    textureShader.setVec3("dirLights[5].light.intensity", glm::vec3(0.5f));
-    textureShader.setVec3("dirLights[5].dir", glm::vec3(0.0f, 1.0f, 0.0f));
-    /* --------------------------------- */
+    if (frameState->renderPath == CLUSTERED_PATH) {
+        shader.setInt("lightData", LIGHT_DATA_SLOT);
+        shader.setInt("clusterGrid", CLUSTER_GRID_SLOT);
+        shader.setInt("lightIndices", LIGHT_INDEX_SLOT);
+        clusterGrid.setUniforms(shader);
+    }
+    else {
+        const std::vector<PointLight>& pointLights = frameState->pointLights;
+        for (i = 0; i < MIN(pointLights.size(), static_cast<size_t>(N_FORWARD_POINT_LIGHTS)); i++) {
+            shader.setVec3(UniformName("pointLights", i, "light.diffuseK"), pointLights[i].light.diffuseK);
+            shader.setVec3(UniformName("pointLights", i, "light.specularK"), pointLights[i].light.specularK);
+            shader.setVec3(UniformName("pointLights", i, "light.intensity"), pointLights[i].light.intensity);
+            shader.setVec3(UniformName("pointLights", i, "pos"), pointLights[i].pos);
+            shader.setFloat(UniformName("pointLights", i, "attenuation.a"), pointLights[i].attenuation.a);
+            shader.setFloat(UniformName("pointLights", i, "attenuation.b"), pointLights[i].attenuation.b);
+            shader.setFloat(UniformName("pointLights", i, "attenuation.c"), pointLights[i].attenuation.c);
+        }
+    }
 
-    /* ----- Draw non-luminous objects ----- */
-    glBindVertexArray(objectInfo[IRON_MAN].vaoID);
-    objectInfo[IRON_MAN].texDiffuse.bind(0);
-    objectInfo[IRON_MAN].texSpecular.bind(1);
-    objectInfo[IRON_MAN].texNormal.bind(2);
-    textureShader.setFloat("material.shininess", 64);
-    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 5.0f, 0.0f));
-    modelMatrix = glm::scale(modelMatrix, glm::vec3(10.0f, 10.0f, 10.0f));
-    textureShader.setMat4("modelMatrix", modelMatrix);
-    glDrawElements(GL_TRIANGLES, objectInfo[IRON_MAN].vertexCount, GL_UNSIGNED_INT, 0);
-    /* ------------------------------------- */
+    for (i = 0; i < dirLights.size(); i++) {
+        shader.setVec3(UniformName("dirLights", i, "light.diffuseK"), dirLights[i].light.diffuseK);
+        shader.setVec3(UniformName("dirLights", i, "light.specularK"), dirLights[i].light.specularK);
+        shader.setVec3(UniformName("dirLights", i, "light.intensity"), dirLights[i].light.intensity);
+        shader.setVec3(UniformName("dirLights", i, "dir"), dirLights[i].dir);
+    }
+}
 
-    /* ----- Draw luminous objects ----- */
-    glBindVertexArray(objectInfo[SPHERE].vaoID);
-    textureShader.setVec3("emissionK", glm::vec3(0.5f));
-    objectInfo[SPHERE].texDiffuse.bind(0);
-    objectInfo[SPHERE].texSpecular.bind(1);
-    objectInfo[SPHERE].texNormal.bind(2);
-    textureShader.setFloat("material.shininess", 32);
-    modelMatrix = glm::translate(glm::mat4(1.0f), pointLightPos);
-    modelMatrix = glm::scale(modelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
-    textureShader.setMat4("modelMatrix", modelMatrix);
-    glDrawElements(GL_TRIANGLES, objectInfo[SPHERE].vertexCount, GL_UNSIGNED_INT, 0);
-    /* --------------------------------- */
+/* Use the texture shader matching a material */
+const Shader& useTextureShader(GLuint materialID)
+{
+    const Shader& shader = textureShaders[frameState->renderPath][materialAssets[materialID].getPermutation()];
+    shader.use();
+    return shader;
+}
 
-    skybox.draw(viewMatrix, projectionMatrix);
+/* Print the average frame time and light statistics once per second */
+void reportFrameStats(void)
+{
+    statsFrames++;
+    uint64_t elapsed = getTimeNs() - statsStartTime;
+    if (elapsed < 1000000000ull)
+        return;
+
+    std::cout << "INF: " << 1e-6 * elapsed / statsFrames << " ms/frame ("
+              << 1e-6 * drawListTime / statsFrames << " ms draw lists on " << jobSystem.getThreadCount() << " threads), "
+              << RENDER_PATH_NAMES[frameState->renderPath] << (frameState->depthPrepass && frameState->renderPath != DEFERRED_PATH ? " with depth pre-pass, " : ", ")
+              << frameState->pointLights.size() << " point lights, " << frameState->spotLights.size() << " spot lights, " << ironManCopies << " copies, "
+              << registry.getEntityCount() << " entities, "
+              << drawnObjectCount << " objects drawn, " << culledObjectCount << " culled, ";
+    if (frameState->occlusionCulling)
+        std::cout << occludedObjectCount << " occluded (" << occlusionCuller.getTriangleCount() << " occluder triangles), ";
+    std::cout << stateChanges << " state changes (" << unsortedStateChanges << " unsorted), "
+              << updatedTransformCount << "/" << transforms.getNodeCount() << " transforms updated, "
+              << shadedSamplesQuery.getResult() << " shaded samples, "
+              << (streamRing.getFrameBytes() >> 10) << " KB streamed (" << streamRing.getStallCount() << " stalls)";
+    if (frameState->renderPath == CLUSTERED_PATH)
+        std::cout << ", " << clusterGrid.getLightIndexCount() << " light indices";
+    std::cout << std::endl;
+
+    statsFrames = 0;
+    statsStartTime += elapsed;
+    drawListTime = 0;
+}
+
+void setupLights(void)
+{
+    /* ----- Add lights ----- */
+    PointLight pointLight;
+    pointLight.light = {glm::vec3(0.4f), glm::vec3(0.5f), glm::vec3(5.0f)};
+    pointLight.pos = glm::vec3(0.0f, 8.0f, 10.0f);
+    pointLight.attenuation = {1.0f, 0.01f, 0.001f};
+    registry.pointLights.add(registry.createEntity(), pointLight);  /* The forward path only shades the first point lights */
+    setupBenchmarkLights(benchmarkLightCount, benchmarkSpotLightCount);
+
+    dirLights.push_back({{glm::vec3(0.4f), glm::vec3(0.5f), glm::vec3(2.0f)}, glm::vec3( 0.0f,  0.0f,  1.0f)});  /* From the front */
+    dirLights.push_back({{glm::vec3(0.4f), glm::vec3(0.5f), glm::vec3(0.4f)}, glm::vec3( 0.0f,  0.0f, -1.0f)});  /* From the back */
+    dirLights.push_back({{glm::vec3(0.4f), glm::vec3(0.5f), glm::vec3(0.4f)}, glm::vec3( 1.0f,  0.0f,  0.0f)});  /* From the left */
+    dirLights.push_back({{glm::vec3(0.4f), glm::vec3(0.5f), glm::vec3(0.4f)}, glm::vec3(-1.0f,  0.0f,  0.0f)});  /* From the right */
+    dirLights.push_back({{glm::vec3(0.4f), glm::vec3(0.5f), glm::vec3(1.0f)}, glm::vec3( 0.0f, -1.0f,  0.0f)});  /* From the top */
+    dirLights.push_back({{glm::vec3(0.4f), glm::vec3(0.5f), glm::vec3(0.5f)}, glm::vec3( 0.0f,  1.0f,  0.0f)});  /* From the bottom */
+    /* ---------------------- */
+}
+
+/* Scatter "count" small colored point lights and "spotCount" spot lights around the scene */
+void setupBenchmarkLights(GLuint count, GLuint spotCount)
+{
+    for (GLuint i = 0; i < count; i++) {
+        PointLight pointLight;
+        glm::vec3 color = benchmarkRandomColor();
+        pointLight.light = {color * 0.4f, color * 0.5f, glm::vec3(1.0f)};
+        pointLight.pos = glm::vec3(0.0f);
+        pointLight.attenuation = {1.0f, 1.0f, 16.0f};  /* About 4 units of range */
+        Entity entity = registry.createEntity();
+        registry.pointLights.add(entity, pointLight);
+
+        OrbitComponent orbit;
+        orbit.radius = benchmarkRandomReal(1.0f, 15.0f);
+        orbit.height = benchmarkRandomReal(0.0f, 12.0f);
+        orbit.angle  = benchmarkRandomReal(0.0f, glm::two_pi<GLfloat>());
+        orbit.speed  = benchmarkRandomReal(-1.0f, 1.0f);
+        registry.orbits.add(entity, orbit);
+        placeOrbitingLight(entity, orbit);
+    }
+
+    for (GLuint i = 0; i < spotCount; i++) {
+        SpotLight spotLight;
+        glm::vec3 color = benchmarkRandomColor();
+        spotLight.light = {color * 0.4f, color * 0.5f, glm::vec3(2.0f)};
+        spotLight.pos = glm::vec3(0.0f);
+        spotLight.dir = glm::vec3(0.0f, -1.0f, 0.0f);
+        spotLight.cutOff = glm::cos(glm::radians(15.0f));
+        spotLight.outerCutOff = glm::cos(glm::radians(20.0f));
+        spotLight.attenuation = {1.0f, 0.5f, 1.0f};  /* About 20 units of range */
+        Entity entity = registry.createEntity();
+        registry.spotLights.add(entity, spotLight);
+
+        OrbitComponent orbit;
+        orbit.radius = benchmarkRandomReal(2.0f, 15.0f);
+        orbit.height = benchmarkRandomReal(6.0f, 12.0f);
+        orbit.angle  = benchmarkRandomReal(0.0f, glm::two_pi<GLfloat>());
+        orbit.speed  = benchmarkRandomReal(-1.0f, 1.0f);
+        registry.orbits.add(entity, orbit);
+        placeOrbitingLight(entity, orbit);
+    }
+}
+
+GLfloat benchmarkRandomReal(GLfloat a, GLfloat b)
+{
+    /* Not std::uniform_real_distribution, which differs between standard libraries, unlike std::mt19937 */
+    return a + (b - a) * static_cast<GLfloat>(benchmarkRandom() / 4294967296.0);
+}
+
+glm::vec3 benchmarkRandomColor(void)
+{
+    glm::vec3 color;
+    for (GLuint c = 0; c < 3; c++)  /* In order: the arguments of a constructor may be evaluated in any */
+        color[c] = benchmarkRandomReal(0.2f, 1.0f);
+    return color;
+}
+
+/* Move the point and spot lights of the entities that orbit */
+void updateBenchmarkLights(void)
+{
+    for (size_t i = 0; i < registry.orbits.size(); i++) {
+        OrbitComponent& orbit = registry.orbits[i];
+        orbit.angle = glm::mod(orbit.angle + orbit.speed * deltaTime, glm::two_pi<GLfloat>());  /* Kept small, so steps stay above float precision */
+        placeOrbitingLight(registry.orbits.getEntity(i), orbit);
+    }
+}
+
+/* Put the point or spot light of an entity at its angle on the orbit */
+void placeOrbitingLight(Entity entity, const OrbitComponent& orbit)
+{
+    glm::vec3 pos(orbit.radius * glm::cos(orbit.angle), orbit.height, orbit.radius * glm::sin(orbit.angle));
+    if (registry.pointLights.has(entity))
+        registry.pointLights.get(entity).pos = pos;
+    if (registry.spotLights.has(entity)) {
+        SpotLight& spotLight = registry.spotLights.get(entity);
+        spotLight.pos = pos;
+        spotLight.dir = -glm::normalize(pos);
+    }
+}
+
+/* Turn every entity with a mesh into a draw item, walking the packed mesh components in parallel */
+void gatherDrawItems(void)
+{
+    drawItems.resize(registry.meshes.size());
+    jobSystem.parallelFor(static_cast<GLuint>(drawItems.size()), 1024, [](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++) {
+            Entity entity = registry.meshes.getEntity(i);
+            DrawItem& item = drawItems[i];
+            item.entity = entity;
+            item.meshID = registry.meshes[i].meshID;
+            item.materialID = registry.materials.get(entity).materialID;
+            item.batchID = batchLookup[item.meshID * materialAssets.size() + item.materialID];
+            item.modelMatrix = transforms.getWorldMatrix(registry.transforms.get(entity).node);
+            item.emissionK = registry.emissions.has(entity) ? registry.emissions.get(entity).emissionK : glm::vec3(0.0f);
+            item.occluder = registry.occluders.has(entity);
+        }
+    });
+}
+
+/* Drop the draw items that are outside the view frustum */
+void cullDrawItems(glm::mat4 viewProjectionMatrix)
+{
+    std::atomic<GLuint> visibleItems(0);
+    frustumCuller.resize(drawItems.size());
+    frustumCuller.setPlanes(viewProjectionMatrix);
+    jobSystem.parallelFor(static_cast<GLuint>(drawItems.size()), 1024, [&visibleItems](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++)
+            frustumCuller.set(i, registry.bounds.get(drawItems[i].entity), drawItems[i].modelMatrix);
+        visibleItems += frustumCuller.cullRange(begin, end);
+    });
+    drawnObjectCount = visibleItems;
+    culledObjectCount = static_cast<GLuint>(drawItems.size()) - drawnObjectCount;
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < drawItems.size(); i++)
+        if (frustumCuller.isVisible(i))
+            drawItems[visibleCount++] = drawItems[i];
+    drawItems.resize(visibleCount);
+}
+
+/* Rasterize the occluders on the CPU and drop the draw items hidden behind them */
+void occludeDrawItems(glm::mat4 viewProjectionMatrix)
+{
+    occlusionCuller.clear();
+    for (const DrawItem& item : drawItems)
+        if (item.occluder)
+            occlusionCuller.addOccluder(meshAssets[registry.occluders.get(item.entity).meshID].occluder, viewProjectionMatrix * item.modelMatrix);
+    occlusionCuller.rasterize();
+
+    /* Test the items in parallel, then compact them in order */
+    occlusionVisibility.resize(drawItems.size());
+    jobSystem.parallelFor(static_cast<GLuint>(drawItems.size()), 256, [&viewProjectionMatrix](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++)
+            occlusionVisibility[i] = occlusionCuller.isVisible(registry.bounds.get(drawItems[i].entity), viewProjectionMatrix * drawItems[i].modelMatrix);
+    });
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < drawItems.size(); i++)
+        if (occlusionVisibility[i])
+            drawItems[visibleCount++] = drawItems[i];
+    occludedObjectCount = static_cast<GLuint>(drawItems.size() - visibleCount);
+    drawnObjectCount = static_cast<GLuint>(visibleCount);
+    drawItems.resize(visibleCount);
+}
+
+/* Lay down the depth of all draw items with a position-only shader */
+void drawDepthPrepass(glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+{
+    getRenderDevice().colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    depthShader.use();
+    depthShader.setMat4("viewMatrix", viewMatrix);
+    depthShader.setMat4("projectionMatrix", projectionMatrix);
+    geometryArena.drawCommands(GeometryArena::POSITION_STREAM, 0, depthCommandCount);  /* No material: one call for everything */
+    getRenderDevice().colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/* Order the draw items by their render queue key */
+void sortDrawItemsByState(glm::mat4 viewMatrix)
+{
+    renderQueue.clear();
+    for (GLuint i = 0; i < drawItems.size(); i++) {
+        const DrawItem& item = drawItems[i];
+        GLfloat depth = -(viewMatrix * item.modelMatrix[3]).z;
+        renderQueue.push(RenderQueue::makeKey(materialAssets[item.materialID].getPermutation(), item.materialID,
+                                              item.meshID, (depth - NEAR) / (FAR - NEAR)), i);
+    }
+    unsortedStateChanges = renderQueue.countStateChanges();
+    if (!sortDrawItems) {
+        stateChanges = unsortedStateChanges;
+        return;
+    }
+
+    renderQueue.sort();
+    stateChanges = renderQueue.countStateChanges();
+    sortedDrawItems.clear();
+    for (const RenderQueueItem& queued : renderQueue.getItems())
+        sortedDrawItems.push_back(drawItems[queued.index]);
+    drawItems.swap(sortedDrawItems);
+}
+
+/* Gather the instances of every batch, in draw item order, and build this frame's indirect commands */
+void buildDrawCommands(void)
+{
+    const GLuint itemCount = static_cast<GLuint>(drawItems.size());
+    const GLuint batchCount = static_cast<GLuint>(drawBatches.size());
+    const GLuint listCount = CLAMP(itemCount / 1024, 1u, 4 * jobSystem.getThreadCount());
+    commandLists.resize(listCount);
+    jobSystem.parallelFor(listCount, 1, [itemCount, batchCount, listCount](GLuint begin, GLuint end) {
+        for (GLuint l = begin; l < end; l++) {
+            CommandList& list = commandLists[l];
+            list.instances.resize(batchCount);
+            for (std::vector<InstanceData>& instances : list.instances)
+                instances.clear();
+            list.firstItem.assign(batchCount, NO_ITEM);
+            for (GLuint i = itemCount * l / listCount; i < itemCount * (l + 1) / listCount; i++) {
+                const DrawItem& item = drawItems[i];
+                if (list.firstItem[item.batchID] == NO_ITEM)
+                    list.firstItem[item.batchID] = i;
+                list.instances[item.batchID].push_back({item.modelMatrix, item.emissionK});
+            }
+        }
+    });
+
+    /* Merge: batches in the order of their first draw item, then every list's instances of a batch in list order */
+    batchFirstItem.assign(batchCount, NO_ITEM);
+    for (const CommandList& list : commandLists)
+        for (GLuint batch = 0; batch < batchCount; batch++)
+            batchFirstItem[batch] = MIN(batchFirstItem[batch], list.firstItem[batch]);
+    batchOrder.clear();
+    for (GLuint batch = 0; batch < batchCount; batch++)
+        if (batchFirstItem[batch] != NO_ITEM)
+            batchOrder.push_back(batch);
+    std::sort(batchOrder.begin(), batchOrder.end(), [](GLuint a, GLuint b) { return batchFirstItem[a] < batchFirstItem[b]; });
+
+    frameCommands.clear();
+    commandListOffsets.resize(listCount * batchCount);
+    GLuint instanceCount = 0;
+    for (GLuint batch : batchOrder) {
+        GLuint baseInstance = instanceCount;
+        for (GLuint l = 0; l < listCount; l++) {
+            commandListOffsets[l * batchCount + batch] = instanceCount;
+            instanceCount += static_cast<GLuint>(commandLists[l].instances[batch].size());
+        }
+        frameCommands.push_back(geometryArena.makeCommand(meshAssets[drawBatches[batch].meshID].arenaMeshID, GeometryArena::POSITION_STREAM,
+                                                          instanceCount - baseInstance, baseInstance));
+    }
+    frameInstances.resize(instanceCount);
+    jobSystem.parallelFor(listCount, 1, [batchCount](GLuint begin, GLuint end) {
+        for (GLuint l = begin; l < end; l++)
+            for (GLuint batch = 0; batch < batchCount; batch++) {
+                const std::vector<InstanceData>& instances = commandLists[l].instances[batch];
+                std::copy(instances.begin(), instances.end(), frameInstances.begin() + commandListOffsets[l * batchCount + batch]);
+            }
+    });
+
+    depthCommandCount = static_cast<GLuint>(frameCommands.size());
+
+    for (GLuint i = 0; i < depthCommandCount; i++) {
+        DrawElementsIndirectCommand depthCommand = frameCommands[i];
+        frameCommands.push_back(geometryArena.makeCommand(meshAssets[drawBatches[batchOrder[i]].meshID].arenaMeshID, GeometryArena::FULL_STREAM,
+                                                          depthCommand.instanceCount, depthCommand.baseInstance));
+    }
+
+    geometryArena.uploadInstances(frameInstances);
+    geometryArena.uploadCommands(frameCommands);
+}
+
+/* Draw all instances of every batch with the texture shader of the current render path (one command per batch) */
+void drawObjects(void)
+{
+    PROFILE_SCOPE("drawObjects");
+    for (GLuint i = 0; i < batchOrder.size(); i++) {
+        GLuint materialID = drawBatches[batchOrder[i]].materialID;
+        const Shader& shader = useTextureShader(materialID);
+        materialAssets[materialID].bind(shader);
+        geometryArena.drawCommands(GeometryArena::FULL_STREAM, depthCommandCount + i, 1);
+    }
+}
+
+/* Create the scene entities under their parent nodes; they stay put unless a local matrix is changed */
+void setupScene(void)
+{
+    /* ----- Non-luminous objects ----- */
+    GLuint ironManRoot = transforms.createNode(TransformHierarchy::NO_PARENT, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 5.0f, 0.0f)));
+    for (GLuint i = ironManCopies; i > 0; i--) {  /* Back to front, so that every copy gets shaded */
+        glm::mat4 localMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f * i));
+        localMatrix = glm::scale(localMatrix, glm::vec3(10.0f, 10.0f, 10.0f));
+        createRenderable(ironManRoot, localMatrix, ironManMesh, ironManMaterial);
+    }
+    Entity ironMan = createRenderable(ironManRoot, glm::scale(glm::mat4(1.0f), glm::vec3(10.0f, 10.0f, 10.0f)), ironManMesh, ironManMaterial);
+    registry.occluders.add(ironMan, {ironManMesh});
+    /* -------------------------------- */
+
+    /* ----- Luminous objects ----- */
+    /* The sphere marks the first point light, whose entity it joins */
+    Entity lightEntity = registry.pointLights.getEntity(0);
+    glm::mat4 localMatrix = glm::translate(glm::mat4(1.0f), registry.pointLights[0].pos);
+    localMatrix = glm::scale(localMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+    registry.transforms.add(lightEntity, {transforms.createNode(TransformHierarchy::NO_PARENT, localMatrix)});
+    attachMesh(lightEntity, sphereMesh, sphereMaterial);
+    registry.emissions.add(lightEntity, {glm::vec3(0.5f)});
+    setupSphereField(sphereFieldSize);
+    /* ---------------------------- */
+}
+
+/* An entity drawn with a mesh and a material, placed relative to parentNode */
+Entity createRenderable(GLuint parentNode, glm::mat4 localMatrix, GLuint meshID, GLuint materialID)
+{
+    Entity entity = registry.createEntity();
+    registry.transforms.add(entity, {transforms.createNode(parentNode, localMatrix)});
+    attachMesh(entity, meshID, materialID);
+    return entity;
+}
+
+/* Make an entity drawable, creating the batch of its (mesh, material) pair on first use */
+void attachMesh(Entity entity, GLuint meshID, GLuint materialID)
+{
+    registry.meshes.add(entity, {meshID});
+    registry.materials.add(entity, {materialID});
+    registry.bounds.add(entity, meshAssets[meshID].bounds);
+    if (softwareRendering)  /* Draws are not batched */
+        return;
+
+    batchLookup.resize(meshAssets.size() * materialAssets.size(), NO_BATCH);
+    GLuint& batch = batchLookup[meshID * materialAssets.size() + materialID];
+    if (batch == NO_BATCH) {
+        batch = static_cast<GLuint>(drawBatches.size());
+        drawBatches.push_back({meshID, materialID});
+    }
+}
+
+/* count spheres on a square grid, 1 unit apart, starting 5 units behind the iron man */
+void setupSphereField(GLuint count)
+{
+    GLuint fieldRoot = transforms.createNode(TransformHierarchy::NO_PARENT, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, -5.0f)));
+    GLuint side = static_cast<GLuint>(glm::ceil(glm::sqrt(static_cast<GLfloat>(count))));
+    for (GLuint i = 0; i < count; i++) {
+        GLfloat x = static_cast<GLfloat>(i % side) - 0.5f * (side - 1), z = -static_cast<GLfloat>(i / side);
+        glm::mat4 localMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z)), glm::vec3(0.3f));
+        Entity sphere = createRenderable(fieldRoot, localMatrix, sphereMesh, sphereMaterial);
+
+        /* A different hue per sphere, as per-instance material */
+        GLfloat hue = glm::two_pi<GLfloat>() * i / MAX(count, 1u);
+        registry.emissions.add(sphere, {0.25f + 0.25f * glm::cos(glm::vec3(hue, hue - glm::two_pi<GLfloat>() / 3.0f, hue + glm::two_pi<GLfloat>() / 3.0f))});
+    }
 }
 
 void sendObjectsToOpenGL(void)
 {
-    GLuint vboID, eboID;
+    streamRing.setupStreamRing(4 << 20, persistentMapping);
+    geometryArena.setupGeometryArena(multiDrawIndirect, &streamRing);
+    loadAssets();
+
+    /* Render server clients load meshes later, so the arena keeps its CPU copies */
+    if (!serverSocket.empty())
+        serverMaterial = loadMaterial(NULL, NULL, NULL, 32.0f);
+    geometryArena.upload(!serverSocket.empty());
 
+    /* Compile only the texture shader permutations used by the loaded materials */
+    for (const Material& material : materialAssets)
+        setupTextureShader(material.getPermutation());
+}
+
+/* Load the meshes and materials of the scene, for OpenGL or for the software renderer */
+void loadAssets(void)
+{
+    PROFILE_SCOPE("loadAssets");
+    ALLOCATION_SCOPE("loadAssets");
     /* ----- Load objects and textures ----- */
     /* Credit: https://sketchfab.com/3d-models/iron-man-rig-a921a8cac309424e939aee1d31fa28c0 */
-    sendObject(IRON_MAN, "resources/iron-man/iron-man.obj", &vboID, &eboID);
-    objectInfo[IRON_MAN].texDiffuse.setupTexture("resources/iron-man/iron-man_diffuse.png");
-    objectInfo[IRON_MAN].texSpecular.setupTexture("resources/iron-man/iron-man_specular.png");
-    objectInfo[IRON_MAN].texNormal.setupTexture("resources/iron-man/iron-man_normal.png");
+    ironManMesh = loadMesh("resources/iron-man/iron-man.obj");
+    ironManMaterial = loadMaterial(
+        "resources/iron-man/iron-man_diffuse.png",
+        "resources/iron-man/iron-man_specular.png",
+        "resources/iron-man/iron-man_normal.png",
+        64.0f);
 
     /* Credit: https://sketchfab.com/3d-models/perfect-sphere-to-apply-360-photo-texture-a4ae557105534d97ab942ab6310f0876 */
-    sendObject(SPHERE, "resources/sphere/sphere.obj", &vboID, &eboID);
-    objectInfo[SPHERE].texDiffuse.setupTexture("resources/sphere/sphere_diffuse.jpg");
-    objectInfo[SPHERE].texSpecular.setupTexture("resources/sphere/sphere_specular.jpg");
-    objectInfo[SPHERE].texNormal.setupTexture("resources/defaults/flat_normal.jpg");
+    sphereMesh = loadMesh("resources/sphere/sphere.obj");
+    sphereMaterial = loadMaterial(
+        "resources/sphere/sphere_diffuse.jpg",
+        "resources/sphere/sphere_specular.jpg",
+        "resources/defaults/flat_normal.jpg",
+        32.0f);
     /* ------------------------------------- */
 }
 
-void initializeGL(void)
+void setupTextureShader(GLuint permutation)
 {
-    /* Set up texture shader */
-    textureShader.setupShader("shaders/texture/texture.vs", "shaders/texture/texture.fs");
+    /* Forward and clustered can be switched at runtime, deferred only at startup */
+    for (GLuint path = 0; path < RENDER_PATH_COUNT; path++) {
+        if (textureShaderReady[path][permutation] || (path == DEFERRED_PATH && renderPath != DEFERRED_PATH))
+            continue;
+        std::string defines = Material::getDefines(permutation);
+        if (path == CLUSTERED_PATH)
+            defines += "#define CLUSTERED\n";
+        textureShaders[path][permutation].setupShader("shaders/texture/texture.vs",
+            path == DEFERRED_PATH ? "shaders/gbuffer/gbuffer.fs" : "shaders/texture/texture.fs", defines);
+        textureShaderReady[path][permutation] = GL_TRUE;
+    }
+}
 
+void initializeGL(void)
+{
+    ALLOCATION_SCOPE("initializeGL");
     /* Set up grid mode */
     grid.setupGrid("shaders/grid/grid.vs", "shaders/grid/grid.fs", FAR);
     grid.sendGridsToOpenGL();
 
     /* Set up skybox */
-    const std::vector<std::string> skyboxTexPaths = {
-        /* Credit: https://learnopengl.com/Advanced-OpenGL/Cubemaps */
-        "resources/skybox/right.jpg",
-        "resources/skybox/left.jpg",
-        "resources/skybox/top.jpg",
-        "resources/skybox/bottom.jpg",
-        "resources/skybox/front.jpg",
-        "resources/skybox/back.jpg",
-    };
-    skybox.setupSkybox("shaders/skybox/skybox.vs", "shaders/skybox/skybox.fs", skyboxTexPaths);
+    skybox.setupSkybox("shaders/skybox/skybox.vs", "shaders/skybox/skybox.fs", SKYBOX_TEX_PATHS);
 
     sendObjectsToOpenGL();
 
+    /* Set up lights and clustered shading */
+    jobSystem.setupJobSystem(jobThreadCount ? jobThreadCount : std::thread::hardware_concurrency());
+    setupLights();
+    setupScene();
+    lightBuffer.setupLightBuffer(&streamRing);
+    clusterGrid.setupClusterGrid(16, 9, 24, 1.0f, &streamRing);
+    depthShader.setupShader("shaders/depth/depth.vs", "shaders/depth/depth.fs");
+    shadedSamplesQuery.setupQueryRing(GL_SAMPLES_PASSED);
+    if (benchmarkFrameCount)
+        frameTimeQuery.setupQueryRing(GL_TIME_ELAPSED);
+    else
+        gpuTimers.setupGpuTimers();  /* Its queries would nest in the benchmark's, which GL does not allow */
+    occlusionCuller.setupOcclusionCuller(256, 128, &jobSystem);
+    if (renderPath == DEFERRED_PATH)
+        deferred.setupDeferred("shaders/deferred/fullscreen.vs", "shaders/deferred/dir_light.fs",
+                               "shaders/deferred/light_volume.vs", "shaders/deferred/light_volume.fs", scrWidth, scrHeight);
+
     /* Customize 1D and 2D objects */
-    glEnable(GL_POINT_SMOOTH);
-    glPointSize(10.0f);
-    glLineWidth(1.5f);
+    getRenderDevice().enable(GL_POINT_SMOOTH);
+    getRenderDevice().pointSize(10.0f);
+    getRenderDevice().lineWidth(1.5f);
     
-    glEnable(GL_DEPTH_TEST);   /* Realize occlusion */
-    glEnable(GL_CULL_FACE);    /* Enable face culling */
-    glEnable(GL_MULTISAMPLE);  /* Enable MSAA */
+    getRenderDevice().enable(GL_DEPTH_TEST);   /* Realize occlusion */
+    getRenderDevice().enable(GL_CULL_FACE);    /* Enable face culling */
+    getRenderDevice().enable(GL_MULTISAMPLE);  /* Enable MSAA */
 }
 
-void sendObject(GLuint objectID, const char* objPath, GLuint* vboID, GLuint* eboID)
+/* Load a mesh the scene cannot do without: exit if the OBJ does not load */
+GLuint loadMesh(const char* objPath)
 {
-    Model obj = loadOBJ(objPath);
-    
-    glGenVertexArrays(1, &objectInfo[objectID].vaoID);
-    glBindVertexArray(objectInfo[objectID].vaoID);
-    
-    glGenBuffers(1, vboID);
-    glBindBuffer(GL_ARRAY_BUFFER, *vboID);
-    glBufferData(GL_ARRAY_BUFFER, obj.vertices.size() * sizeof(Vertex), &obj.vertices[0], GL_STATIC_DRAW);
-    
-    glGenBuffers(1, eboID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *eboID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, obj.indices.size() * sizeof(unsigned int), &obj.indices[0], GL_STATIC_DRAW);
-    
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, pos)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, uv)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, normal)));
-    
-    objectInfo[objectID].vertexCount = (GLsizei)obj.indices.size();
+    PROFILE_SCOPE("loadMesh");
+    Model obj;
+    if (!loadOBJ(objPath, obj))
+        exit(1);
+    return addMeshAsset(obj);
+}
+
+/* Add a mesh to the geometry arena, or to the software renderer, and return its index in meshAssets */
+GLuint addMeshAsset(const Model& obj)
+{
+    meshAssets.push_back({softwareRendering ? softwareRenderer.addMesh(obj) : geometryArena.addMesh(obj), obj.bounds, makeOccluderMesh(obj)});
+    return static_cast<GLuint>(meshAssets.size() - 1);
+}
+
+/* Return the index of the new material in materialAssets, or in the software renderer */
+GLuint loadMaterial(const char* diffusePath, const char* specularPath, const char* normalPath, GLfloat shininess)
+{
+    PROFILE_SCOPE("loadMaterial");
+    if (softwareRendering)
+        return softwareRenderer.addMaterial(diffusePath, specularPath, normalPath, shininess);
+    materialAssets.emplace_back();
+    materialAssets.back().setupMaterial(diffusePath, specularPath, normalPath, shininess);
+    return static_cast<GLuint>(materialAssets.size() - 1);
 }
 
+/* The render thread resizes the viewport and the G-buffer when the new size reaches it */
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
     scrWidth = width;
     scrHeight = height;
 }
@@ -343,14 +1806,18 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 /* Set the Keyboard callback for the current window */
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    /* Record pressed or released keys for smoothKeyCallback() */
-    if (action == GLFW_PRESS || action == GLFW_RELEASE)
-        keys[key] = !keys[key];
-    
     /* Exit */
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
+    /* A benchmark takes no other input, so that every run draws the same frames */
+    if (benchmarkFrameCount)
+        return;
+
+    /* Record pressed or released keys for smoothKeyCallback() */
+    if (action == GLFW_PRESS || action == GLFW_RELEASE)
+        keys[key] = !keys[key];
+
     /* Enable/disable cursor */
     if (key == GLFW_KEY_LEFT_CONTROL && action == GLFW_PRESS) {
         cursorDisabled = !cursorDisabled;
@@ -384,6 +1851,24 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     /* Enable/disable grid mode */
     if (key == GLFW_KEY_G && action == GLFW_PRESS)
         showGrid = !showGrid;
+
+    /* Enable/disable software occlusion culling */
+    if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+        occlusionCulling = !occlusionCulling;
+        std::cout << "INF: Occlusion culling " << (occlusionCulling ? "on" : "off") << std::endl;
+    }
+
+    /* Enable/disable the depth pre-pass */
+    if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
+        depthPrepass = !depthPrepass;
+        std::cout << "INF: Depth pre-pass " << (depthPrepass ? "on" : "off") << std::endl;
+    }
+
+    /* Switch between forward and clustered forward shading */
+    if (key == GLFW_KEY_C && action == GLFW_PRESS && renderPath != DEFERRED_PATH) {
+        renderPath = (renderPath == CLUSTERED_PATH) ? FORWARD_PATH : CLUSTERED_PATH;
+        std::cout << "INF: " << RENDER_PATH_NAMES[renderPath] << " shading" << std::endl;
+    }
 }
 
 void smoothKeyCallback(void)
@@ -405,7 +1890,7 @@ void smoothKeyCallback(void)
 /* Set the cursor position callback for the current window */
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
 {
-    if (cursorDisabled)
+    if (cursorDisabled && !benchmarkFrameCount)
         camera.view(static_cast<GLfloat>(xpos), static_cast<GLfloat>(ypos));
 }
 
@@ -418,5 +1903,6 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 /* Set the scoll callback for the current window */
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.zoom(static_cast<GLfloat>(yoffset));
+    if (!benchmarkFrameCount)
+        camera.zoom(static_cast<GLfloat>(yoffset));
 }
@@ -0,0 +1,97 @@
+/*
+Deferred lighting: ambient, emission and directional lights for every pixel
+of the G-buffer.
+*/
+
+#version 330 core
+
+#define N_DIR_LIGHTS 6
+
+struct Light {
+    vec3 diffuseK;
+    vec3 specularK;
+    vec3 intensity;
+};
+
+struct DirLight {
+    Light light;
+    vec3 dir;
+};
+
+out vec4 FragColor;
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gEmission;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform vec3 eyePosWorld;
+uniform bool useBlinn;
+uniform vec3 ambientK;
+uniform DirLight dirLights[N_DIR_LIGHTS];
+
+vec3 diffuseColor;
+vec3 specularColor;
+float shininess;
+
+vec3 calDirLight(DirLight light, vec3 normal, vec3 viewDir);
+vec3 decodeNormal(vec2 f);
+
+void main(void)
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0f)
+        discard;  /* Background, left to the skybox */
+
+    vec2 ndc = (gl_FragCoord.xy / vec2(textureSize(gDepth, 0))) * 2.0f - 1.0f;
+    vec4 pos = inverseViewProjection * vec4(ndc, depth * 2.0f - 1.0f, 1.0f);
+    vec3 vertexPosWorld = pos.xyz / pos.w;
+
+    vec4 albedo = texelFetch(gAlbedo, pixel, 0);
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+    diffuseColor = albedo.rgb;
+    specularColor = specular.rgb;
+    shininess = specular.a * 255.0f;
+    vec3 normal = decodeNormal(texelFetch(gNormal, pixel, 0).xy);
+    vec3 viewDir = normalize(eyePosWorld - vertexPosWorld);
+
+    vec3 result = texelFetch(gEmission, pixel, 0).rgb + ambientK * diffuseColor;
+    for (int i = 0; i < N_DIR_LIGHTS; i++)
+        result += calDirLight(dirLights[i], normal, viewDir);
+
+    FragColor = vec4(result, 1.0f);
+}
+
+vec3 calDirLight(DirLight light, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-light.dir);
+    
+    /* Diffuse reflection */
+    float diff = max(dot(lightDir, normal), 0.0f);
+    vec3 diffuse = light.light.diffuseK * diffuseColor * diff;
+    
+    /* Specular reflection */
+    float spec = 0.0f;
+    if (useBlinn) {
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        spec = pow(max(dot(normal, halfwayDir), 0.0f), shininess);
+    }
+    else {
+        vec3 reflectDir = reflect(-lightDir, normal);
+        spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
+    }
+    vec3 specular = light.light.specularK * specularColor * spec;
+    
+    return light.light.intensity * (diffuse + specular);
+}
+
+vec3 decodeNormal(vec2 f)
+{
+    f = f * 2.0f - 1.0f;
+    vec3 n = vec3(f, 1.0f - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0f, 1.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
@@ -0,0 +1,119 @@
+/*
+Deferred lighting: one point/spot light per instance, drawn as a sphere
+enclosing the light's range (see LightBuffer for the light layout).
+*/
+
+#version 330 core
+
+struct Light {
+    vec3 diffuseK;
+    vec3 specularK;
+    vec3 intensity;
+};
+
+struct Attenuation {
+    float a;
+    float b;
+    float c;
+};
+
+struct SpotLight {
+    Light light;
+    vec3 pos;
+    vec3 dir;
+    float cutOff;
+    float outerCutOff;
+    Attenuation attenuation;
+};
+
+flat in int lightIndex;
+
+out vec4 FragColor;
+
+uniform samplerBuffer lightData;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform vec3 eyePosWorld;
+uniform bool useBlinn;
+
+vec3 diffuseColor;
+vec3 specularColor;
+float shininess;
+
+vec3 calSpotLight(SpotLight light, vec3 normal, vec3 vertexPos, vec3 viewDir);
+SpotLight fetchLight(int index);
+vec3 decodeNormal(vec2 f);
+
+void main(void)
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+
+    vec2 ndc = (gl_FragCoord.xy / vec2(textureSize(gDepth, 0))) * 2.0f - 1.0f;
+    vec4 pos = inverseViewProjection * vec4(ndc, depth * 2.0f - 1.0f, 1.0f);
+    vec3 vertexPosWorld = pos.xyz / pos.w;
+
+    diffuseColor = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+    specularColor = specular.rgb;
+    shininess = specular.a * 255.0f;
+    vec3 normal = decodeNormal(texelFetch(gNormal, pixel, 0).xy);
+    vec3 viewDir = normalize(eyePosWorld - vertexPosWorld);
+
+    FragColor = vec4(calSpotLight(fetchLight(lightIndex), normal, vertexPosWorld, viewDir), 1.0f);
+}
+
+vec3 calSpotLight(SpotLight light, vec3 normal, vec3 vertexPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.pos - vertexPos);
+    
+    /* Diffuse */
+    float diff = max(dot(normal, lightDir), 0.0f);
+    vec3 diffuse = light.light.diffuseK * diffuseColor * diff;
+    
+    /* Specular reflection */
+    float spec = 0.0f;
+    if (useBlinn) {
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        spec = pow(max(dot(normal, halfwayDir), 0.0f), shininess);
+    }
+    else {
+        vec3 reflectDir = reflect(-lightDir, normal);
+        spec = pow(max(dot(viewDir, reflectDir), 0.0f), shininess);
+    }
+    vec3 specular = light.light.specularK * specularColor * spec;
+    
+    /* Attenuate */
+    float dist = length(light.pos - vertexPos);
+    float attenuation = min(1.0f / (light.attenuation.a + light.attenuation.b * dist + light.attenuation.c * pow(dist, 2)), 1.0f);
+    
+    /* Spotlight intensity */
+    float theta = dot(lightDir, normalize(-light.dir));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float cutoff_intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    
+    return attenuation * light.light.intensity * cutoff_intensity * (diffuse + specular);
+}
+
+SpotLight fetchLight(int index)
+{
+    int base = index * 5;
+    vec4 t0 = texelFetch(lightData, base);
+    vec4 t1 = texelFetch(lightData, base + 1);
+    vec4 t2 = texelFetch(lightData, base + 2);
+    vec4 t3 = texelFetch(lightData, base + 3);
+    vec4 t4 = texelFetch(lightData, base + 4);
+    return SpotLight(Light(t1.xyz, t2.xyz, t3.xyz), t0.xyz, t4.xyz, t4.w, t0.w, Attenuation(t1.w, t2.w, t3.w));
+}
+
+vec3 decodeNormal(vec2 f)
+{
+    f = f * 2.0f - 1.0f;
+    vec3 n = vec3(f, 1.0f - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0f, 1.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
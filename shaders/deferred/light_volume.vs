@@ -0,0 +1,39 @@
+#version 330 core
+
+/* LIGHT_CUTOFF in light.h */
+#define LIGHT_CUTOFF (1.0f / 256.0f)
+
+layout (location = 0) in vec3 vertexPos;
+
+flat out int lightIndex;
+
+uniform samplerBuffer lightData;  /* LightBuffer::LIGHT_TEXELS texels per light */
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform float volumeScale;        /* Scale turning the sphere mesh into a mesh enclosing a unit sphere */
+
+/* Same as calLightRadius() in light.cpp */
+float calLightRadius(vec3 peak, vec3 attenuation)
+{
+    float k = max(max(peak.x, peak.y), peak.z) / LIGHT_CUTOFF - attenuation.x;
+    if (k <= 0.0f)
+        return 0.0f;
+    if (attenuation.z > 0.0f)
+        return (-attenuation.y + sqrt(attenuation.y * attenuation.y + 4.0f * attenuation.z * k)) / (2.0f * attenuation.z);
+    if (attenuation.y > 0.0f)
+        return k / attenuation.y;
+    return 1e+6f;
+}
+
+void main()
+{
+    int base = gl_InstanceID * 5;
+    vec4 t0 = texelFetch(lightData, base);
+    vec4 t1 = texelFetch(lightData, base + 1);
+    vec4 t2 = texelFetch(lightData, base + 2);
+    vec4 t3 = texelFetch(lightData, base + 3);
+
+    float radius = calLightRadius(t3.xyz * (t1.xyz + t2.xyz), vec3(t1.w, t2.w, t3.w));
+    gl_Position = projectionMatrix * viewMatrix * vec4(t0.xyz + vertexPos * radius * volumeScale, 1.0f);
+    lightIndex = gl_InstanceID;
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+layout (location = 0) in vec3 vertexPos;
+layout (location = 3) in mat4 modelMatrix;  /* Per instance (InstanceBuffer) */
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+/* Must match texture.vs exactly, as the color pass tests depth with GL_EQUAL */
+invariant gl_Position;
+
+void main()
+{
+    vec4 newPos = modelMatrix * vec4(vertexPos, 1.0f);
+    gl_Position = projectionMatrix * viewMatrix * newPos;
+}
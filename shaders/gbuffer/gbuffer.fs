@@ -0,0 +1,87 @@
+/*
+Geometry pass of the deferred path. Material handling (and its permutation
+macros) is the same as in texture.fs.
+*/
+
+#version 330 core
+
+struct Material {
+#ifdef CONST_DIFFUSE
+    vec3 diffuseColor;
+#else
+    sampler2D diffuse;
+#endif
+#ifdef CONST_SPECULAR
+    vec3 specularColor;
+#else
+    sampler2D specular;
+#endif
+#ifndef FLAT_NORMAL
+    sampler2D normal;
+#endif
+    float shininess;
+};
+
+in vec3 vertexPosWorld;
+in vec3 normalWorld;
+in vec2 UV;
+flat in vec3 emissionK;
+
+layout (location = 0) out vec4 gAlbedo;    /* Diffuse color, unused */
+layout (location = 1) out vec4 gSpecular;  /* Specular color, shininess / 255 */
+layout (location = 2) out vec2 gNormal;    /* Octahedral-encoded world-space normal */
+layout (location = 3) out vec3 gEmission;  /* Emission color */
+
+uniform Material material;
+
+vec3 getNormalFromMap(void);
+vec2 encodeNormal(vec3 n);
+
+void main(void)
+{
+#ifdef FLAT_NORMAL
+    vec3 normal = normalize(normalWorld);
+#else
+    vec3 normal = getNormalFromMap();
+#endif
+#ifdef CONST_DIFFUSE
+    gAlbedo = vec4(material.diffuseColor, 1.0f);
+#else
+    gAlbedo = vec4(texture(material.diffuse, UV).rgb, 1.0f);
+#endif
+#ifdef CONST_SPECULAR
+    gSpecular = vec4(material.specularColor, material.shininess / 255.0f);
+#else
+    gSpecular = vec4(texture(material.specular, UV).rgb, material.shininess / 255.0f);
+#endif
+    gNormal = encodeNormal(normal);
+    gEmission = emissionK;
+}
+
+/* Reference: https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/ */
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0f)
+        n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    return n.xy * 0.5f + 0.5f;
+}
+
+#ifndef FLAT_NORMAL
+vec3 getNormalFromMap(void)
+{
+    vec3 tangentNormal = texture(material.normal, UV).xyz * 2.0f - 1.0f;
+
+    vec3 Q1 = dFdx(vertexPosWorld);
+    vec3 Q2 = dFdy(vertexPosWorld);
+    vec2 st1 = dFdx(UV);
+    vec2 st2 = dFdy(UV);
+
+    vec3 n = normalize(normalWorld);
+    vec3 t = normalize(Q1 * st2.t - Q2 * st1.t);
+    vec3 b = -normalize(cross(n, t));
+    mat3 tbn = mat3(t, b, n);
+
+    return normalize(tbn * tangentNormal);
+}
+#endif
@@ -11,10 +11,27 @@ References: https://learnopengl.com/Lighting/Light-casters
 #define N_SPOT_LIGHTS 1
 /* ------------------------------ */
 
+/*
+Permutation macros (set by Material::getDefines()):
+CONST_DIFFUSE/CONST_SPECULAR replace a single-color map by a uniform color,
+FLAT_NORMAL skips normal mapping.
+CLUSTERED takes point/spot lights from the light lists of the fragment's
+cluster (see ClusterGrid) instead of the pointLights array.
+*/
 struct Material {
+#ifdef CONST_DIFFUSE
+    vec3 diffuseColor;
+#else
     sampler2D diffuse;
+#endif
+#ifdef CONST_SPECULAR
+    vec3 specularColor;
+#else
     sampler2D specular;
+#endif
+#ifndef FLAT_NORMAL
     sampler2D normal;
+#endif
     float shininess;
 };
 
@@ -53,32 +70,69 @@ struct SpotLight {
 in vec3 vertexPosWorld;
 in vec3 normalWorld;
 in vec2 UV;
+flat in vec3 emissionK;
 
 out vec4 FragColor;
 
 uniform vec3 eyePosWorld;
 uniform Material material;
 uniform bool useBlinn;
-uniform vec3 emissionK;
 uniform vec3 ambientK;
 uniform PointLight pointLights[N_POINT_LIGHTS];
 uniform DirLight dirLights[N_DIR_LIGHTS];
 // uniform SpotLight spotLights[N_SPOT_LIGHTS];
 
+#ifdef CLUSTERED
+uniform mat4 viewMatrix;
+uniform samplerBuffer lightData;     /* LightBuffer::LIGHT_TEXELS texels per light */
+uniform usamplerBuffer clusterGrid;  /* (offset, count) into lightIndices per cluster */
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterDims;
+uniform vec4 clusterScale;           /* (tiles per pixel x/y, slices per log depth, near split) */
+#endif
+
+/* Material colors of the current fragment, fetched once in main() */
+vec3 diffuseColor;
+vec3 specularColor;
+
 vec3 calPointLight(PointLight light, vec3 normal, vec3 vertexPos, vec3 viewDir);
 vec3 calDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 calSpotLight(SpotLight light, vec3 normal, vec3 vertexPos, vec3 viewDir);
 vec3 getNormalFromMap(void);
+SpotLight fetchLight(int index);
 
 void main(void)
 {
     int i;
     vec3 viewDir = normalize(eyePosWorld - vertexPosWorld);
+#ifdef FLAT_NORMAL
+    vec3 normal = normalize(normalWorld);
+#else
     vec3 normal = getNormalFromMap();
+#endif
+#ifdef CONST_DIFFUSE
+    diffuseColor = material.diffuseColor;
+#else
+    diffuseColor = texture(material.diffuse, UV).rgb;
+#endif
+#ifdef CONST_SPECULAR
+    specularColor = material.specularColor;
+#else
+    specularColor = texture(material.specular, UV).rgb;
+#endif
     
-    vec3 result = emissionK + ambientK * texture(material.diffuse, UV).rgb;
+    vec3 result = emissionK + ambientK * diffuseColor;
+#ifdef CLUSTERED
+    float viewDepth = -(viewMatrix * vec4(vertexPosWorld, 1.0f)).z;
+    int slice = viewDepth < clusterScale.w ? 0 : 1 + int(log(viewDepth / clusterScale.w) * clusterScale.z);
+    ivec3 cluster = clamp(ivec3(ivec2(gl_FragCoord.xy * clusterScale.xy), slice), ivec3(0), clusterDims - 1);
+    uvec2 lightList = texelFetch(clusterGrid, (cluster.z * clusterDims.y + cluster.y) * clusterDims.x + cluster.x).xy;
+    for (uint j = 0u; j < lightList.y; j++)
+        result += calSpotLight(fetchLight(int(texelFetch(lightIndices, int(lightList.x + j)).x)), normal, vertexPosWorld, viewDir);
+#else
     for (i = 0; i < N_POINT_LIGHTS; i++)
         result += calPointLight(pointLights[i], normal, vertexPosWorld, viewDir);
+#endif
     for (i = 0; i < N_DIR_LIGHTS; i++)
         result += calDirLight(dirLights[i], normal, viewDir);
     // for (i = 0; i < N_SPOT_LIGHTS; i++)
@@ -93,7 +147,7 @@ vec3 calPointLight(PointLight light, vec3 normal, vec3 vertexPos, vec3 viewDir)
     
     /* Diffuse reflection */
     float diff = max(dot(lightDir, normal), 0.0f);
-    vec3 diffuse = light.light.diffuseK * texture(material.diffuse, UV).rgb * diff;
+    vec3 diffuse = light.light.diffuseK * diffuseColor * diff;
     
     /* Specular reflection */
     float spec = 0.0f;
@@ -105,7 +159,7 @@ vec3 calPointLight(PointLight light, vec3 normal, vec3 vertexPos, vec3 viewDir)
         vec3 reflectDir = reflect(-lightDir, normal);
         spec = pow(max(dot(viewDir, reflectDir), 0.0f), material.shininess);
     }
-    vec3 specular = light.light.specularK * texture(material.specular, UV).rgb * spec;
+    vec3 specular = light.light.specularK * specularColor * spec;
     
     /* Attenuate */
     float dist = length(light.pos - vertexPos);
@@ -120,7 +174,7 @@ vec3 calDirLight(DirLight light, vec3 normal, vec3 viewDir)
     
     /* Diffuse reflection */
     float diff = max(dot(lightDir, normal), 0.0f);
-    vec3 diffuse = light.light.diffuseK * texture(material.diffuse, UV).rgb * diff;
+    vec3 diffuse = light.light.diffuseK * diffuseColor * diff;
     
     /* Specular reflection */
     float spec = 0.0f;
@@ -132,7 +186,7 @@ vec3 calDirLight(DirLight light, vec3 normal, vec3 viewDir)
         vec3 reflectDir = reflect(-lightDir, normal);
         spec = pow(max(dot(viewDir, reflectDir), 0.0f), material.shininess);
     }
-    vec3 specular = light.light.specularK * texture(material.specular, UV).rgb * spec;
+    vec3 specular = light.light.specularK * specularColor * spec;
     
     return light.light.intensity * (diffuse + specular);
 }
@@ -143,7 +197,7 @@ vec3 calSpotLight(SpotLight light, vec3 normal, vec3 vertexPos, vec3 viewDir)
     
     /* Diffuse */
     float diff = max(dot(normal, lightDir), 0.0f);
-    vec3 diffuse = light.light.diffuseK * texture(material.diffuse, UV).rgb * diff;
+    vec3 diffuse = light.light.diffuseK * diffuseColor * diff;
     
     /* Specular reflection */
     float spec = 0.0f;
@@ -155,7 +209,7 @@ vec3 calSpotLight(SpotLight light, vec3 normal, vec3 vertexPos, vec3 viewDir)
         vec3 reflectDir = reflect(-lightDir, normal);
         spec = pow(max(dot(viewDir, reflectDir), 0.0f), material.shininess);
     }
-    vec3 specular = light.light.specularK * texture(material.specular, UV).rgb * spec;
+    vec3 specular = light.light.specularK * specularColor * spec;
     
     /* Attenuate */
     float dist = length(light.pos - vertexPos);
@@ -169,6 +223,20 @@ vec3 calSpotLight(SpotLight light, vec3 normal, vec3 vertexPos, vec3 viewDir)
     return attenuation * light.light.intensity * cutoff_intensity * (diffuse + specular);
 }
 
+#ifdef CLUSTERED
+SpotLight fetchLight(int index)
+{
+    int base = index * 5;
+    vec4 t0 = texelFetch(lightData, base);
+    vec4 t1 = texelFetch(lightData, base + 1);
+    vec4 t2 = texelFetch(lightData, base + 2);
+    vec4 t3 = texelFetch(lightData, base + 3);
+    vec4 t4 = texelFetch(lightData, base + 4);
+    return SpotLight(Light(t1.xyz, t2.xyz, t3.xyz), t0.xyz, t4.xyz, t4.w, t0.w, Attenuation(t1.w, t2.w, t3.w));
+}
+#endif
+
+#ifndef FLAT_NORMAL
 vec3 getNormalFromMap(void)
 {
     vec3 tangentNormal = texture(material.normal, UV).xyz * 2.0f - 1.0f;
@@ -185,3 +253,4 @@ vec3 getNormalFromMap(void)
 
     return normalize(tbn * tangentNormal);
 }
+#endif
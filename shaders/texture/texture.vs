@@ -3,21 +3,35 @@
 layout (location = 0) in vec3 vertexPos;
 layout (location = 1) in vec2 vertexUV;
 layout (location = 2) in vec3 normal;
+layout (location = 3) in mat4 modelMatrix;        /* Per instance (InstanceBuffer) */
+layout (location = 7) in vec3 instanceEmissionK;  /* Per instance */
 
 out vec3 vertexPosWorld;
 out vec3 normalWorld;
 out vec2 UV;
+flat out vec3 emissionK;
 
-uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
+/* Must match depth.vs exactly, as the depth pre-pass is tested with GL_EQUAL */
+invariant gl_Position;
+
 void main()
 {
     vec4 newPos = modelMatrix * vec4(vertexPos, 1.0f);
     gl_Position = projectionMatrix * viewMatrix * newPos;
     
     vertexPosWorld = newPos.xyz;
-    normalWorld = (modelMatrix * vec4(normal, 0.0f)).xyz;
+    /*
+    Cofactors of the upper 3x3: the inverse transpose times the determinant,
+    fine as normals are normalized later once the sign of the determinant is
+    undone (mirrored instances would point them inward)
+    */
+    mat3 m = mat3(modelMatrix);
+    mat3 normalMatrix = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+    normalMatrix *= dot(m[0], normalMatrix[0]) < 0.0f ? -1.0f : 1.0f;
+    normalWorld = normalMatrix * normal;
     UV = vertexUV;
+    emissionK = instanceEmissionK;
 }
@@ -0,0 +1,190 @@
+#include "alloc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+GLboolean allocationTrackingEnabled = GL_FALSE;
+thread_local const char* allocationTag = NULL;
+
+/* ----- Totals per tag, claimed lock-free; slot 0 holds untagged allocations and those past MAX_TAGS ----- */
+static const GLuint MAX_TAGS = 64;
+
+struct TagTotals {
+    std::atomic<const char*> tag;
+    std::atomic<uint64_t> count, bytes;
+};
+
+static TagTotals tagTotals[MAX_TAGS];
+/* ------------------------------------------------------------------------------------------------------- */
+
+/* ----- The frame open on this thread, and the totals of the frames of the render thread ----- */
+static thread_local GLboolean frameOpen = GL_FALSE;
+static thread_local uint64_t frameCount = 0, frameBytes = 0;
+static thread_local GLboolean frameHelper = GL_FALSE;
+static std::atomic<bool> frameActive(false);
+static std::atomic<uint64_t> helperCount(0), helperBytes(0);  /* Of the helper threads in the open frame */
+
+static GLuint warmupFrameCount = 0;
+static uint64_t framesEnded = 0, allocatingFrames = 0;
+static uint64_t steadyCount = 0, steadyBytes = 0, maxFrameCount = 0, maxFrameBytes = 0;
+/* -------------------------------------------------------------------------------------------- */
+
+static TagTotals& findTagTotals(const char* tag)
+{
+    if (!tag)
+        return tagTotals[0];
+    for (GLuint i = 1; i < MAX_TAGS; i++) {
+        const char* slotTag = tagTotals[i].tag.load(std::memory_order_acquire);
+        if (!slotTag && tagTotals[i].tag.compare_exchange_strong(slotTag, tag, std::memory_order_acq_rel))
+            return tagTotals[i];
+        if (slotTag == tag)  /* Tags are string literals */
+            return tagTotals[i];
+    }
+    return tagTotals[0];
+}
+
+static void recordAllocation(size_t size)
+{
+    TagTotals& totals = findTagTotals(allocationTag);
+    totals.count.fetch_add(1, std::memory_order_relaxed);
+    totals.bytes.fetch_add(size, std::memory_order_relaxed);
+    if (frameOpen) {
+        frameCount++;
+        frameBytes += size;
+    }
+    else if (frameHelper && frameActive.load(std::memory_order_relaxed)) {
+        helperCount.fetch_add(1, std::memory_order_relaxed);
+        helperBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+void setupAllocationTracker(GLuint warmupFrames)
+{
+    warmupFrameCount = warmupFrames;
+    allocationTrackingEnabled = GL_TRUE;
+}
+
+void beginAllocationFrame(void)
+{
+    if (!allocationTrackingEnabled)
+        return;
+    frameOpen = GL_TRUE;
+    frameCount = frameBytes = 0;
+    helperCount.store(0, std::memory_order_relaxed);
+    helperBytes.store(0, std::memory_order_relaxed);
+    frameActive.store(true, std::memory_order_relaxed);
+}
+
+void endAllocationFrame(void)
+{
+    if (!frameOpen)
+        return;
+    frameOpen = GL_FALSE;
+    frameActive.store(false, std::memory_order_relaxed);
+    frameCount += helperCount.exchange(0, std::memory_order_relaxed);  /* The jobs of the frame are done */
+    frameBytes += helperBytes.exchange(0, std::memory_order_relaxed);
+    if (framesEnded++ < warmupFrameCount)
+        return;
+    if (frameCount)
+        allocatingFrames++;
+    steadyCount += frameCount;
+    steadyBytes += frameBytes;
+    maxFrameCount = std::max(maxFrameCount, frameCount);
+    maxFrameBytes = std::max(maxFrameBytes, frameBytes);
+}
+
+void countFrameAllocations(void)
+{
+    frameHelper = GL_TRUE;
+}
+
+uint64_t getSteadyAllocationCount(void)
+{
+    return steadyCount;
+}
+
+/* Tags by bytes allocated, then the frames after the warm-up */
+void reportAllocations(void)
+{
+    allocationTrackingEnabled = GL_FALSE;  /* The report allocates */
+
+    std::vector<GLuint> order;
+    for (GLuint i = 0; i < MAX_TAGS; i++)
+        if (tagTotals[i].count.load(std::memory_order_relaxed))
+            order.push_back(i);
+    std::sort(order.begin(), order.end(), [](GLuint a, GLuint b) { return tagTotals[a].bytes.load() > tagTotals[b].bytes.load(); });
+    std::cout << "INF: Heap allocations by scope:" << std::endl;
+    for (GLuint i : order) {
+        const char* tag = i ? tagTotals[i].tag.load() : "untagged";
+        std::cout << "INF:   " << tag << ": " << tagTotals[i].count.load() << " allocations, " << (tagTotals[i].bytes.load() >> 10) << " KB" << std::endl;
+    }
+
+    uint64_t steadyFrames = framesEnded - std::min<uint64_t>(framesEnded, warmupFrameCount);
+    std::cout << "INF: " << steadyFrames << " frames after " << warmupFrameCount << " warm-up frames: " << steadyCount << " allocations, "
+              << steadyBytes << " bytes (" << allocatingFrames << " frames allocated, at most " << maxFrameCount << " allocations and "
+              << maxFrameBytes << " bytes in a frame)" << std::endl;
+}
+
+/* ----- Replaced global allocation functions ----- */
+void* operator new(std::size_t size)
+{
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    if (allocationTrackingEnabled)
+        recordAllocation(size);
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    void* pointer = std::malloc(size ? size : 1);
+    if (pointer && allocationTrackingEnabled)
+        recordAllocation(size);
+    return pointer;
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+/* ------------------------------------------------ */
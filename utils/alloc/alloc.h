@@ -0,0 +1,40 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <cstdint>
+
+/*
+Heap allocation tracker. alloc.cpp replaces the global operator new and
+delete; until setupAllocationTracker() they only add one branch to malloc()
+and free(). Once on, every allocation is counted, with its size, against the
+innermost ALLOCATION_SCOPE of its thread ("untagged" outside any) and against
+the frame open on that thread, or on any thread while a frame is open if the
+thread called countFrameAllocations() (e.g. job workers). Frames are counted
+on one thread, the render thread; the first warmupFrames are left out of the
+steady-state totals while the caches and pools grow. Aligned new is not
+replaced and not counted. Nothing here allocates, so the hook can call it.
+*/
+extern GLboolean allocationTrackingEnabled;
+extern thread_local const char* allocationTag;
+
+void setupAllocationTracker(GLuint warmupFrames);
+void beginAllocationFrame(void);
+void endAllocationFrame(void);
+void countFrameAllocations(void);  /* Count this thread's allocations against the open frame */
+uint64_t getSteadyAllocationCount(void);  /* In the frames after the warm-up */
+void reportAllocations(void);
+
+class AllocationScope
+{
+public:
+    explicit AllocationScope(const char* tag) : _previousTag(allocationTag) { allocationTag = tag; }
+    ~AllocationScope() { allocationTag = _previousTag; }
+
+private:
+    const char* _previousTag;
+};
+
+#define ALLOCATION_CONCAT_(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_(a, b)
+#define ALLOCATION_SCOPE(tag) AllocationScope ALLOCATION_CONCAT(_allocationScope, __LINE__)(tag)
@@ -0,0 +1,164 @@
+#include "arena.h"
+
+#include "device/device.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+void GeometryArena::setupGeometryArena(GLboolean allowMultiDrawIndirect, StreamRing* ring)
+{
+    _ring = ring;
+    _multiDrawIndirect = allowMultiDrawIndirect && GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+    std::cout << "INF: Geometry arena draws with "
+              << (_multiDrawIndirect ? "glMultiDrawElementsIndirect" : "glDrawElementsInstancedBaseVertex") << std::endl;
+
+    getRenderDevice().genVertexArrays(STREAM_COUNT, _vaoIDs);
+    getRenderDevice().genBuffers(1, &_vboID);
+    getRenderDevice().genBuffers(1, &_eboID);
+    _commandAllocation = {NULL, 0, 0, 0};
+    _released = GL_FALSE;
+    _instances.setupInstanceBuffer();
+}
+
+/* Stage the mesh in the arena; nothing reaches OpenGL before upload() */
+GLuint GeometryArena::addMesh(const Model& model)
+{
+    if (_released) {
+        std::cerr << "ERR: Meshes cannot be added to a geometry arena uploaded without keeping its staged copies" << std::endl;
+        exit(1);
+    }
+
+    ArenaMesh mesh;
+    mesh.indexCount = static_cast<GLuint>(model.indices.size());
+    mesh.firstIndex = static_cast<GLuint>(_indices.size());
+    mesh.baseVertex = static_cast<GLint>(_vertices.size());
+    mesh.posFirstIndex = 0;  /* Set by upload() once the index count is known */
+    mesh.posBaseVertex = static_cast<GLint>(_positions.size());
+
+    _vertices.insert(_vertices.end(), model.vertices.begin(), model.vertices.end());
+    _indices.insert(_indices.end(), model.indices.begin(), model.indices.end());
+    _positions.insert(_positions.end(), model.positions.begin(), model.positions.end());
+    _positionIndexStarts.push_back(static_cast<GLuint>(_positionIndices.size()));
+    _positionIndices.insert(_positionIndices.end(), model.positionIndices.begin(), model.positionIndices.end());
+
+    _meshes.push_back(mesh);
+    return static_cast<GLuint>(_meshes.size() - 1);
+}
+
+/*
+Send all staged meshes to OpenGL, replacing what an earlier upload() sent.
+The CPU copies are released unless keepStaged, which lets meshes be added
+and uploaded again later.
+*/
+void GeometryArena::upload(GLboolean keepStaged)
+{
+    const GLsizeiptr vertexBytes = _vertices.size() * sizeof(Vertex);
+    const GLsizeiptr positionBytes = _positions.size() * sizeof(glm::vec3);
+    const GLsizeiptr indexBytes = _indices.size() * sizeof(GLuint);
+    const GLsizeiptr positionIndexBytes = _positionIndices.size() * sizeof(GLuint);
+
+    for (size_t i = 0; i < _meshes.size(); i++)
+        _meshes[i].posFirstIndex = _positionIndexStarts[i] + static_cast<GLuint>(_indices.size());
+
+    getRenderDevice().bindVertexArray(_vaoIDs[FULL_STREAM]);
+    getRenderDevice().bindBuffer(GL_ARRAY_BUFFER, _vboID);
+    getRenderDevice().bufferData(GL_ARRAY_BUFFER, vertexBytes + positionBytes, NULL, GL_STATIC_DRAW);
+    getRenderDevice().bufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, _vertices.data());
+    getRenderDevice().bufferSubData(GL_ARRAY_BUFFER, vertexBytes, positionBytes, _positions.data());
+
+    getRenderDevice().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _eboID);
+    getRenderDevice().bufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes + positionIndexBytes, NULL, GL_STATIC_DRAW);
+    getRenderDevice().bufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, _indices.data());
+    getRenderDevice().bufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, positionIndexBytes, _positionIndices.data());
+
+    getRenderDevice().enableVertexAttribArray(0);
+    getRenderDevice().vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, pos)));
+    getRenderDevice().enableVertexAttribArray(1);
+    getRenderDevice().vertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, uv)));
+    getRenderDevice().enableVertexAttribArray(2);
+    getRenderDevice().vertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, normal)));
+
+    getRenderDevice().bindVertexArray(_vaoIDs[POSITION_STREAM]);
+    getRenderDevice().bindBuffer(GL_ARRAY_BUFFER, _vboID);
+    getRenderDevice().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _eboID);
+    getRenderDevice().enableVertexAttribArray(0);
+    getRenderDevice().vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)vertexBytes);
+    getRenderDevice().bindVertexArray(0);  /* The instances are attached by uploadInstances() */
+
+    if (keepStaged)
+        return;
+    _released = GL_TRUE;
+    std::vector<Vertex>().swap(_vertices);
+    std::vector<glm::vec3>().swap(_positions);
+    std::vector<GLuint>().swap(_indices);
+    std::vector<GLuint>().swap(_positionIndices);
+}
+
+const ArenaMesh& GeometryArena::getMesh(GLuint meshID) const
+{
+    return _meshes[meshID];
+}
+
+GLuint GeometryArena::getVAO(Stream stream) const
+{
+    return _vaoIDs[stream];
+}
+
+DrawElementsIndirectCommand GeometryArena::makeCommand(GLuint meshID, Stream stream, GLuint instanceCount, GLuint baseInstance) const
+{
+    const ArenaMesh& mesh = _meshes[meshID];
+    if (stream == POSITION_STREAM)
+        return {mesh.indexCount, instanceCount, mesh.posFirstIndex, mesh.posBaseVertex, baseInstance};
+    return {mesh.indexCount, instanceCount, mesh.firstIndex, mesh.baseVertex, baseInstance};
+}
+
+void GeometryArena::uploadInstances(const std::vector<InstanceData>& instances)
+{
+    _instances.upload(instances, *_ring);
+    if (instances.empty())
+        return;
+
+    for (GLuint stream = 0; stream < STREAM_COUNT; stream++)
+        _instances.attach(_vaoIDs[stream], 0);
+    getRenderDevice().bindVertexArray(0);
+}
+
+void GeometryArena::uploadCommands(const std::vector<DrawElementsIndirectCommand>& commands)
+{
+    _commands = commands;
+    if (!_multiDrawIndirect || commands.empty())
+        return;
+
+    _commandAllocation = _ring->allocate(static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand)), 16);
+    memcpy(_commandAllocation.data, commands.data(), _commandAllocation.size);
+}
+
+/* Draw the commands [firstCommand, firstCommand + commandCount) of the last uploadCommands() */
+void GeometryArena::drawCommands(Stream stream, GLuint firstCommand, GLsizei commandCount)
+{
+    if (commandCount <= 0)
+        return;
+
+    getRenderDevice().bindVertexArray(_vaoIDs[stream]);
+    if (_multiDrawIndirect) {
+        getRenderDevice().bindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandAllocation.bufferID);
+        getRenderDevice().multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(_commandAllocation.offset + firstCommand * sizeof(DrawElementsIndirectCommand)),
+                                    commandCount, 0);
+        getRenderDevice().bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return;
+    }
+
+    for (GLsizei i = 0; i < commandCount; i++) {
+        const DrawElementsIndirectCommand& command = _commands[firstCommand + i];
+        _instances.attach(_vaoIDs[stream], command.baseInstance);
+        getRenderDevice().drawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(GLuint)),
+                                          command.instanceCount, command.baseVertex);
+    }
+    _instances.attach(_vaoIDs[stream], 0);
+}
+
+GLboolean GeometryArena::usesMultiDrawIndirect(void) const
+{
+    return _multiDrawIndirect;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "instance/instance.h"
+#include "misc/misc.h"
+#include "ring/ring.h"
+
+#include <vector>
+
+/* Same layout as the command read by glMultiDrawElementsIndirect */
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/* Where a mesh lives in the arena, for both vertex streams */
+struct ArenaMesh {
+    GLuint indexCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint posFirstIndex;
+    GLint posBaseVertex;
+};
+
+/*
+One vertex buffer and one index buffer shared by all static meshes. The
+vertex buffer holds every interleaved Vertex followed by every deduplicated
+position, and each stream has its own VAO, so a whole pass is drawn without
+rebinding buffers.
+
+A frame's draws are streamed through a StreamRing as
+DrawElementsIndirectCommands whose baseInstance points at their
+InstanceData (streamed as well), which replaces a per-draw table indexed by
+gl_DrawID. With ARB_multi_draw_indirect and ARB_base_instance a
+range of commands is one glMultiDrawElementsIndirect; otherwise every
+command is replayed with glDrawElementsInstancedBaseVertex after moving the
+instance attributes to its first instance.
+*/
+class GeometryArena
+{
+public:
+    enum Stream {
+        FULL_STREAM,      /* Vertex: position, uv, normal */
+        POSITION_STREAM,  /* Position only */
+        STREAM_COUNT
+    };
+
+    void setupGeometryArena(GLboolean allowMultiDrawIndirect, StreamRing* ring);
+    GLuint addMesh(const Model& model);
+    void upload(GLboolean keepStaged);
+    const ArenaMesh& getMesh(GLuint meshID) const;
+    GLuint getVAO(Stream stream) const;
+    DrawElementsIndirectCommand makeCommand(GLuint meshID, Stream stream, GLuint instanceCount, GLuint baseInstance) const;
+    void uploadInstances(const std::vector<InstanceData>& instances);
+    void uploadCommands(const std::vector<DrawElementsIndirectCommand>& commands);
+    void drawCommands(Stream stream, GLuint firstCommand, GLsizei commandCount);
+    GLboolean usesMultiDrawIndirect(void) const;
+
+private:
+    std::vector<Vertex> _vertices;
+    std::vector<glm::vec3> _positions;
+    std::vector<GLuint> _indices, _positionIndices;
+    std::vector<GLuint> _positionIndexStarts;  /* Per mesh, relative to the position indices */
+    std::vector<ArenaMesh> _meshes;
+    std::vector<DrawElementsIndirectCommand> _commands;
+
+    GLuint _vaoIDs[STREAM_COUNT];
+    GLuint _vboID, _eboID;
+    RingAllocation _commandAllocation;
+    InstanceBuffer _instances;
+    StreamRing* _ring;
+    GLboolean _multiDrawIndirect;
+    GLboolean _released;  /* The staged copies are gone, so no more meshes */
+};
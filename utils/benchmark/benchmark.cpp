@@ -0,0 +1,160 @@
+#include "benchmark.h"
+
+#include "misc/misc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+GLboolean CameraPath::loadCameraPath(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "ERR: Failed to open camera path " << path << std::endl;
+        return GL_FALSE;
+    }
+
+    _keys.clear();
+    std::string line;
+    for (GLuint lineNumber = 1; std::getline(file, line); lineNumber++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        CameraKey key;
+        if (!(fields >> key.time)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;  /* Blank or comment */
+        }
+        else if ((fields >> key.pos.x >> key.pos.y >> key.pos.z >> key.yaw >> key.pitch >> key.fov)
+                 && (_keys.empty() || key.time >= _keys.back().time)) {
+            _keys.push_back(key);
+            continue;
+        }
+        std::cerr << "ERR: " << path << ":" << lineNumber << ": expected TIME X Y Z YAW PITCH FOV in increasing time" << std::endl;
+        return GL_FALSE;
+    }
+    if (_keys.empty()) {
+        std::cerr << "ERR: Camera path " << path << " has no keys" << std::endl;
+        return GL_FALSE;
+    }
+    std::cout << "INF: Loaded " << _keys.size() << " camera keys (" << getDuration() << " s) from " << path << std::endl;
+    return GL_TRUE;
+}
+
+GLboolean CameraPath::saveCameraPath(const std::string& path) const
+{
+    std::ofstream file(path);
+    file << "# TIME X Y Z YAW PITCH FOV (seconds, degrees)\n";
+    for (const CameraKey& key : _keys)
+        file << key.time << " " << key.pos.x << " " << key.pos.y << " " << key.pos.z << " " << key.yaw << " " << key.pitch << " " << key.fov << "\n";
+    file.close();
+    if (!file) {
+        std::cerr << "ERR: Failed to write camera path " << path << std::endl;
+        return GL_FALSE;
+    }
+    std::cout << "INF: Saved " << _keys.size() << " camera keys (" << getDuration() << " s) to " << path << std::endl;
+    return GL_TRUE;
+}
+
+void CameraPath::addKey(const CameraKey& key)
+{
+    _keys.push_back(key);
+}
+
+CameraKey CameraPath::sample(GLfloat time) const
+{
+    if (_keys.empty())
+        return {time, glm::vec3(0.0f), -90.0f, 0.0f, 45.0f};
+    auto after = std::upper_bound(_keys.begin(), _keys.end(), time, [](GLfloat t, const CameraKey& key) { return t < key.time; });
+    if (after == _keys.begin())
+        return _keys.front();
+    if (after == _keys.end())
+        return _keys.back();
+
+    const CameraKey& a = *(after - 1);
+    const CameraKey& b = *after;
+    GLfloat t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 1.0f;
+    GLfloat yawDelta = std::remainder(b.yaw - a.yaw, 360.0f);  /* In [-180, 180] */
+    return {time, glm::mix(a.pos, b.pos, t), a.yaw + yawDelta * t, glm::mix(a.pitch, b.pitch, t), glm::mix(a.fov, b.fov, t)};
+}
+
+GLfloat CameraPath::getDuration(void) const
+{
+    return _keys.empty() ? 0.0f : _keys.back().time - _keys.front().time;
+}
+
+GLuint CameraPath::getKeyCount(void) const
+{
+    return static_cast<GLuint>(_keys.size());
+}
+
+void FrameTimings::setupFrameTimings(GLuint frameCount)
+{
+    _frameTimes.clear();
+    _cpuTimes.clear();
+    _gpuTimes.clear();
+    _frameTimes.reserve(frameCount);
+    _cpuTimes.reserve(frameCount);
+    _gpuTimes.reserve(frameCount);
+}
+
+void FrameTimings::addFrame(uint64_t frameNs, uint64_t cpuNs)
+{
+    _frameTimes.push_back(frameNs);
+    _cpuTimes.push_back(cpuNs);
+}
+
+void FrameTimings::addGpuTime(uint64_t gpuNs)
+{
+    _gpuTimes.push_back(gpuNs);
+}
+
+GLuint FrameTimings::getFrameCount(void) const
+{
+    return static_cast<GLuint>(_frameTimes.size());
+}
+
+/* {"min": ..., "mean": ..., "p50": ..., ...} in milliseconds, nearest-rank percentiles */
+static std::string summarize(std::vector<uint64_t> times)
+{
+    std::ostringstream json;
+    if (times.empty())
+        return "null";
+    std::sort(times.begin(), times.end());
+    uint64_t total = 0;
+    for (uint64_t time : times)
+        total += time;
+    auto percentile = [&times](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * times.size()));
+        return 1e-6 * times[CLAMP(rank, static_cast<size_t>(1), times.size()) - 1];
+    };
+    json << "{\"min\": " << 1e-6 * times.front() << ", \"mean\": " << 1e-6 * total / times.size() << ", \"p50\": " << percentile(0.50)
+         << ", \"p95\": " << percentile(0.95) << ", \"p99\": " << percentile(0.99) << ", \"max\": " << 1e-6 * times.back() << "}";
+    return json.str();
+}
+
+GLboolean FrameTimings::writeReport(const std::string& path, const std::string& configJSON) const
+{
+    uint64_t totalTime = 0;
+    for (uint64_t time : _frameTimes)
+        totalTime += time;
+
+    std::ofstream file(path);
+    file << "{\n";
+    file << "  \"config\": " << configJSON << ",\n";
+    file << "  \"frames\": " << _frameTimes.size() << ",\n";
+    file << "  \"gpuFrames\": " << _gpuTimes.size() << ",\n";
+    file << "  \"fps\": " << (totalTime ? 1e9 * _frameTimes.size() / totalTime : 0.0) << ",\n";
+    file << "  \"frameMs\": " << summarize(_frameTimes) << ",\n";
+    file << "  \"cpuMs\": " << summarize(_cpuTimes) << ",\n";
+    file << "  \"gpuMs\": " << summarize(_gpuTimes) << "\n";
+    file << "}\n";
+    file.close();
+    if (!file) {
+        std::cerr << "ERR: Failed to write the benchmark report to " << path << std::endl;
+        return GL_FALSE;
+    }
+    std::cout << "INF: " << _frameTimes.size() << " benchmark frames: " << summarize(_frameTimes) << " ms, written to " << path << std::endl;
+    return GL_TRUE;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Camera pose at a time of a path, angles in degrees */
+struct CameraKey {
+    GLfloat time;
+    glm::vec3 pos;
+    GLfloat yaw, pitch, fov;
+};
+
+/*
+Camera keys over time, played back by linear interpolation (yaw the short
+way round). A path file is text with one key per line,
+    TIME X Y Z YAW PITCH FOV
+in seconds and degrees, in increasing time; '#' starts a comment. Paths are
+written by hand or recorded from live input with saveCameraPath().
+*/
+class CameraPath
+{
+public:
+    GLboolean loadCameraPath(const std::string& path);
+    GLboolean saveCameraPath(const std::string& path) const;
+    void addKey(const CameraKey& key);  /* Not earlier than the last key */
+    CameraKey sample(GLfloat time) const;  /* Clamped to the first and last keys */
+    GLfloat getDuration(void) const;
+    GLuint getKeyCount(void) const;
+
+private:
+    std::vector<CameraKey> _keys;
+};
+
+/*
+Times of every frame of a benchmark run: the interval between frames, the
+CPU time spent submitting it and, from GL_TIME_ELAPSED, its GPU time (which
+may come back for fewer frames). writeReport() summarizes each as min,
+mean, p50, p95, p99 and max in milliseconds, in a JSON object that also
+holds the caller's "config" object.
+*/
+class FrameTimings
+{
+public:
+    void setupFrameTimings(GLuint frameCount);
+    void addFrame(uint64_t frameNs, uint64_t cpuNs);
+    void addGpuTime(uint64_t gpuNs);
+    GLuint getFrameCount(void) const;
+    GLboolean writeReport(const std::string& path, const std::string& configJSON) const;
+
+private:
+    std::vector<uint64_t> _frameTimes, _cpuTimes, _gpuTimes;
+};
@@ -66,8 +66,12 @@ void Camera::view(GLfloat xpos, GLfloat ypos)
     
     _yaw   = glm::mod(_yaw + xoffset, _TWO_PI);
     _pitch = CLAMP(_pitch + yoffset, _MIN_PITCH, _MAX_PITCH);  /* Restrict pitch */
-    
-    /* Compute new camera directions */
+    _updateDirections();
+}
+
+/* Compute new camera directions from the yaw and pitch */
+void Camera::_updateDirections(void)
+{
     _cameraFront.x = cos(_yaw) * cos(_pitch);
     _cameraFront.y = sin(_pitch);
     _cameraFront.z = sin(_yaw) * cos(_pitch);
@@ -120,3 +124,12 @@ void Camera::setFirstMouse(GLboolean value)
 {
     _firstMouse = value;
 }
+
+void Camera::setPose(glm::vec3 pos, GLfloat yaw, GLfloat pitch, GLfloat fov)
+{
+    _cameraPos = pos;
+    _yaw = glm::mod(yaw, _TWO_PI);
+    _pitch = CLAMP(pitch, _MIN_PITCH, _MAX_PITCH);
+    _fov = CLAMP(fov, _minFOV, _maxFOV);
+    _updateDirections();
+}
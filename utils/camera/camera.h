@@ -27,6 +27,7 @@ public:
     GLfloat getYaw(void) const;
     GLfloat getPitch(void) const;
     void setFirstMouse(GLboolean value);
+    void setPose(glm::vec3 pos, GLfloat yaw, GLfloat pitch, GLfloat fov);  /* Angles in radians, FOV in degrees */
 
 private:
     const GLfloat _TWO_PI = glm::radians(360.0f), _MIN_PITCH = glm::radians(-89.0f), _MAX_PITCH = glm::radians(89.0f);
@@ -38,4 +39,6 @@ private:
     GLfloat _sensitivity;
     GLfloat _fov, _minFOV, _maxFOV;
     GLboolean _useCameraSpace;
+
+    void _updateDirections(void);
 };
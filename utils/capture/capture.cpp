@@ -0,0 +1,223 @@
+#include "capture.h"
+
+#include <cstring>
+#include <iostream>
+
+GLboolean FrameCapture::setupFrameCapture(const std::string& output, GLint width, GLint height, GLuint framesPerSecond)
+{
+    _output = output;
+    _width = width;
+    _height = height;
+    _active = GL_FALSE;
+    _pipe = !output.empty() && output[0] == '|';
+    _y4m = _pipe || (output.size() > 4 && output.compare(output.size() - 4, 4, ".y4m") == 0);
+
+    _file = _pipe ? popen(output.c_str() + 1, "w") : fopen(output.c_str(), "wb");
+    if (!_file) {
+        std::cerr << "ERR: Failed to open " << (_pipe ? "pipe to " : "") << (_pipe ? output.substr(1) : output) << std::endl;
+        return GL_FALSE;
+    }
+    if (_y4m)
+        fprintf(_file, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+
+    const GLsizeiptr frameSize = static_cast<GLsizeiptr>(width) * height * 4;
+    glGenBuffers(RING_SIZE, _pboIDs);
+    for (GLuint i = 0; i < RING_SIZE; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _pboIDs[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, NULL, GL_STREAM_READ);
+        _fences[i] = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    _next = _pendingCount = 0;
+
+    _frames.assign(POOL_SIZE, std::vector<unsigned char>(frameSize));
+    _freeFrames.clear();
+    for (GLuint i = 0; i < POOL_SIZE; i++)
+        _freeFrames.push_back(i);
+    _encodeQueue.clear();
+    _finishing = false;
+    _capturedCount = _skippedCount = _readbackStalls = _encoderStalls = 0;
+    _encoder = std::thread(&FrameCapture::_encodeLoop, this);
+    _active = GL_TRUE;
+
+    std::cout << "INF: Capturing " << width << "x" << height << " frames to " << (_pipe ? output.substr(1) : output)
+              << (_y4m ? " (Y4M)" : " (raw RGB24)") << std::endl;
+    return GL_TRUE;
+}
+
+/* Queue a readback of the current read framebuffer, and hand over the frames whose readback is done */
+void FrameCapture::capture(GLint width, GLint height)
+{
+    if (!_active)
+        return;
+    if (width != _width || height != _height) {
+        _skippedCount++;
+        return;
+    }
+
+    if (_pendingCount == RING_SIZE)
+        _retireOldest();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pboIDs[_next]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);  /* RGBA is the fast path */
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    _fences[_next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _next = (_next + 1) % RING_SIZE;
+    _pendingCount++;
+
+    /* Do not keep frames waiting longer than needed */
+    while (_pendingCount > 1) {
+        GLuint oldest = (_next + RING_SIZE - _pendingCount) % RING_SIZE;
+        if (glClientWaitSync(_fences[oldest], 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        _retireOldest();
+    }
+}
+
+/* Drain the readbacks, let the encoder write everything and close the output */
+void FrameCapture::finish(void)
+{
+    if (!_active)
+        return;
+
+    while (_pendingCount)
+        _retireOldest();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _finishing = true;
+    }
+    _frameReady.notify_one();
+    _encoder.join();
+
+    GLboolean failed = ferror(_file) != 0;
+    if (_pipe)
+        failed = pclose(_file) != 0 || failed;
+    else
+        failed = fclose(_file) != 0 || failed;
+    glDeleteBuffers(RING_SIZE, _pboIDs);
+    _active = GL_FALSE;
+
+    if (failed)
+        std::cerr << "ERR: Failed to write the capture to " << (_pipe ? _output.substr(1) : _output) << std::endl;
+    std::cout << "INF: Captured " << _capturedCount << " frames (" << _skippedCount << " skipped for their size), "
+              << _readbackStalls << " waits for readback, " << _encoderStalls << " waits for the encoder" << std::endl;
+}
+
+GLboolean FrameCapture::isActive(void) const
+{
+    return _active;
+}
+
+/* Copy the oldest pending readback into a free frame and queue it for the encoder */
+void FrameCapture::_retireOldest(void)
+{
+    GLuint slot = (_next + RING_SIZE - _pendingCount) % RING_SIZE;
+    if (glClientWaitSync(_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+        _readbackStalls++;
+        while (glClientWaitSync(_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+    }
+    glDeleteSync(_fences[slot]);
+    _fences[slot] = NULL;
+    _pendingCount--;
+
+    GLuint frame;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_freeFrames.empty()) {
+            _encoderStalls++;
+            _frameFree.wait(lock, [this] { return !_freeFrames.empty(); });
+        }
+        frame = _freeFrames.back();
+        _freeFrames.pop_back();
+    }
+
+    const GLsizeiptr frameSize = static_cast<GLsizeiptr>(_frames[frame].size());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pboIDs[slot]);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameSize, GL_MAP_READ_BIT);
+    if (pixels)
+        memcpy(_frames[frame].data(), pixels, frameSize);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (pixels) {
+            _encodeQueue.push_back(frame);
+            _capturedCount++;
+        }
+        else
+            _freeFrames.push_back(frame);
+    }
+    _frameReady.notify_one();
+}
+
+void FrameCapture::_encodeLoop(void)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _frameReady.wait(lock, [this] { return !_encodeQueue.empty() || _finishing; });
+        if (_encodeQueue.empty())
+            return;
+        GLuint frame = _encodeQueue.front();
+        _encodeQueue.pop_front();
+
+        lock.unlock();
+        _writeFrame(_frames[frame].data());
+        lock.lock();
+
+        _freeFrames.push_back(frame);
+        _frameFree.notify_one();
+    }
+}
+
+/* Flip to top row first and convert to the output format */
+void FrameCapture::_writeFrame(const unsigned char* rgba)
+{
+    const size_t width = _width, height = _height;
+
+    if (!_y4m) {
+        _scratch.resize(width * 3);
+        for (size_t y = 0; y < height; y++) {
+            const unsigned char* src = rgba + (height - 1 - y) * width * 4;
+            for (size_t x = 0; x < width; x++)
+                memcpy(&_scratch[x * 3], src + x * 4, 3);
+            fwrite(_scratch.data(), 1, _scratch.size(), _file);
+        }
+        return;
+    }
+
+    /* BT.601 limited range; chroma is the average of each 2x2 block */
+    const size_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    _scratch.resize(width * height + 2 * chromaWidth * chromaHeight);
+    unsigned char* lumaPlane = _scratch.data();
+    unsigned char* uPlane = lumaPlane + width * height;
+    unsigned char* vPlane = uPlane + chromaWidth * chromaHeight;
+    for (size_t y = 0; y < height; y++) {
+        const unsigned char* src = rgba + (height - 1 - y) * width * 4;
+        for (size_t x = 0; x < width; x++, src += 4)
+            lumaPlane[y * width + x] = static_cast<unsigned char>(((66 * src[0] + 129 * src[1] + 25 * src[2] + 128) >> 8) + 16);
+    }
+    for (size_t cy = 0; cy < chromaHeight; cy++) {
+        for (size_t cx = 0; cx < chromaWidth; cx++) {
+            int r = 0, g = 0, b = 0, count = 0;
+            for (size_t y = 2 * cy; y < 2 * cy + 2 && y < height; y++) {
+                for (size_t x = 2 * cx; x < 2 * cx + 2 && x < width; x++) {
+                    const unsigned char* src = rgba + ((height - 1 - y) * width + x) * 4;
+                    r += src[0];
+                    g += src[1];
+                    b += src[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+            uPlane[cy * chromaWidth + cx] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            vPlane[cy * chromaWidth + cx] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    fputs("FRAME\n", _file);
+    fwrite(_scratch.data(), 1, _scratch.size(), _file);
+}
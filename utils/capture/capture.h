@@ -0,0 +1,65 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Frame capture that never waits for the GPU or the disk in the common case.
+
+capture() starts an asynchronous glReadPixels of the current read
+framebuffer into the next of RING_SIZE pixel buffer objects and fences it.
+A PBO is only mapped RING_SIZE - 1 frames later (or earlier if its fence has
+already signaled), by which time the copy is done. Its pixels then go into
+one of POOL_SIZE frame buffers and an encoder thread converts and writes
+them, so the render thread only blocks when the encoder is a whole pool
+behind.
+
+The output is chosen by name:
+    "|command"  YUV4MPEG2 piped to command, e.g. "|ffmpeg -i - flythrough.mp4"
+    "*.y4m"     YUV4MPEG2 file (4:2:0, BT.601 limited range)
+    anything else  raw RGB24, top row first
+finish() must be called on the thread owning the context, before it goes away.
+*/
+class FrameCapture
+{
+public:
+    static const GLuint RING_SIZE = 3;
+    static const GLuint POOL_SIZE = 8;
+
+    GLboolean setupFrameCapture(const std::string& output, GLint width, GLint height, GLuint framesPerSecond);
+    void capture(GLint width, GLint height);  /* Frames of another size than the capture are skipped */
+    void finish(void);
+    GLboolean isActive(void) const;
+
+private:
+    std::string _output;
+    GLint _width, _height;
+    GLboolean _active, _y4m, _pipe;
+    FILE* _file;
+
+    GLuint _pboIDs[RING_SIZE];
+    GLsync _fences[RING_SIZE];
+    GLuint _next, _pendingCount;  /* Oldest pending PBO is (_next - _pendingCount) mod RING_SIZE */
+
+    std::vector<std::vector<unsigned char>> _frames;  /* RGBA, bottom row first */
+    std::vector<GLuint> _freeFrames;
+    std::deque<GLuint> _encodeQueue;
+    bool _finishing;
+    std::mutex _mutex;
+    std::condition_variable _frameFree, _frameReady;
+    std::thread _encoder;
+    std::vector<unsigned char> _scratch;  /* Encoder thread only */
+
+    GLuint _capturedCount, _skippedCount, _readbackStalls, _encoderStalls;
+
+    void _retireOldest(void);
+    void _encodeLoop(void);
+    void _writeFrame(const unsigned char* rgba);
+};
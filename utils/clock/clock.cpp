@@ -0,0 +1,54 @@
+#include "clock.h"
+
+#include "misc/misc.h"
+
+#include <chrono>
+
+uint64_t getTimeNs(void)
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+void FixedTimestep::setupFixedTimestep(GLuint stepsPerSecond, GLuint maxSteps)
+{
+    _stepNs = 1000000000ull / MAX(stepsPerSecond, 1u);
+    _lastNs = getTimeNs();
+    _accumulatorNs = 0;
+    _maxSteps = MAX(maxSteps, 1u);
+}
+
+GLuint FixedTimestep::advance(void)
+{
+    uint64_t now = getTimeNs();
+    uint64_t elapsedNs = now - _lastNs;
+    _lastNs = now;
+    return advance(elapsedNs);
+}
+
+GLuint FixedTimestep::advance(uint64_t elapsedNs)
+{
+    _accumulatorNs += elapsedNs;
+    uint64_t steps = _accumulatorNs / _stepNs;
+    _accumulatorNs -= steps * _stepNs;
+    if (steps > _maxSteps) {
+        steps = _maxSteps;
+        _accumulatorNs = 0;
+    }
+    return static_cast<GLuint>(steps);
+}
+
+uint64_t FixedTimestep::getStepNs(void) const
+{
+    return _stepNs;
+}
+
+GLfloat FixedTimestep::getStepSeconds(void) const
+{
+    return static_cast<GLfloat>(static_cast<double>(_stepNs) * 1e-9);
+}
+
+GLfloat FixedTimestep::getAlpha(void) const
+{
+    return static_cast<GLfloat>(static_cast<double>(_accumulatorNs) / static_cast<double>(_stepNs));
+}
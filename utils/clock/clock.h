@@ -0,0 +1,34 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <cstdint>
+
+/* Nanoseconds on a monotonic clock, counted from the first call */
+uint64_t getTimeNs(void);
+
+/*
+Fixed-rate simulation steps. advance() adds the real time elapsed since the
+last call to an integer nanosecond accumulator and returns how many whole
+steps to run, so motion does not depend on the frame rate and the clock
+does not lose precision over long uptimes. getAlpha() is the fraction of a
+step left in the accumulator, for interpolating between the last two steps.
+
+At most maxSteps steps are run per call; time beyond that is dropped rather
+than making the next frames slower still. advance(elapsedNs) feeds a chosen
+time instead of the real one, e.g. exactly one step per rendered frame.
+*/
+class FixedTimestep
+{
+public:
+    void setupFixedTimestep(GLuint stepsPerSecond, GLuint maxSteps);
+    GLuint advance(void);
+    GLuint advance(uint64_t elapsedNs);
+    uint64_t getStepNs(void) const;
+    GLfloat getStepSeconds(void) const;
+    GLfloat getAlpha(void) const;
+
+private:
+    uint64_t _stepNs, _lastNs, _accumulatorNs;
+    GLuint _maxSteps;
+};
@@ -0,0 +1,214 @@
+#include "cluster.h"
+
+#include "device/device.h"
+#include "misc/misc.h"
+
+#include <algorithm>
+
+void ClusterGrid::setupClusterGrid(GLuint dimX, GLuint dimY, GLuint dimZ, GLfloat nearSplit, StreamRing* ring)
+{
+    _ring = ring;
+    _dimX = dimX;
+    _dimY = dimY;
+    _dimZ = MAX(dimZ, 2u);
+    _nearSplit = nearSplit;
+    _near = _far = 0.0f;
+    _projectionMatrix = glm::mat4(0.0f);
+
+    const size_t clusterCount = static_cast<size_t>(_dimX) * _dimY * _dimZ;
+    _clusterMin.resize(clusterCount);
+    _clusterMax.resize(clusterCount);
+    _grid.resize(clusterCount);
+
+    getRenderDevice().genBuffers(1, &_gridBufferID);
+    getRenderDevice().genTextures(1, &_gridTextureID);
+    getRenderDevice().genBuffers(1, &_indexBufferID);
+    getRenderDevice().genTextures(1, &_indexTextureID);
+    _gridCapacity = _indexCapacity = 0;
+}
+
+/*
+After a list had to grow, make room for twice its size, so that a list whose
+size varies from frame to frame stops reallocating once it has seen its
+usual peak
+*/
+template <typename T>
+static void keepHeadroom(std::vector<T>& list, size_t previousCapacity)
+{
+    if (list.capacity() != previousCapacity)
+        list.reserve(list.size() * 2);
+}
+
+/* Assign the lights to clusters and upload the light lists (once per frame) */
+void ClusterGrid::build(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, GLfloat near, GLfloat far, GLint viewportWidth, GLint viewportHeight,
+                        const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights)
+{
+    _viewportWidth = viewportWidth;
+    _viewportHeight = viewportHeight;
+    if (projectionMatrix != _projectionMatrix || near != _near || far != _far) {
+        _projectionMatrix = projectionMatrix;
+        _near = near;
+        _far = MAX(far, _nearSplit * 2.0f);
+        _computeClusterBounds();
+    }
+
+    size_t pairCapacity = _clusterLightPairs.capacity(), indexCapacity = _indices.capacity();
+    _clusterLightPairs.clear();
+    GLuint lightIndex = 0;
+    for (const SpotLight& l : spotLights)
+        _assignLight(glm::vec3(viewMatrix * glm::vec4(l.pos, 1.0f)), calLightRadius(l.light, l.attenuation), lightIndex++);
+    for (const PointLight& l : pointLights)
+        _assignLight(glm::vec3(viewMatrix * glm::vec4(l.pos, 1.0f)), calLightRadius(l.light, l.attenuation), lightIndex++);
+
+    /* Counting sort of the (cluster, light) pairs into compact per-cluster lists */
+    std::fill(_grid.begin(), _grid.end(), glm::uvec2(0));
+    for (const glm::uvec2& pair : _clusterLightPairs)
+        _grid[pair.x].y++;
+    GLuint offset = 0;
+    for (glm::uvec2& cell : _grid) {
+        cell.x = offset;
+        offset += cell.y;
+        cell.y = 0;
+    }
+    _indices.resize(MAX(offset, 1u));
+    for (const glm::uvec2& pair : _clusterLightPairs) {
+        glm::uvec2& cell = _grid[pair.x];
+        _indices[cell.x + cell.y++] = pair.y;
+    }
+    keepHeadroom(_clusterLightPairs, pairCapacity);
+    keepHeadroom(_indices, indexCapacity);
+
+    _uploadBuffer(_gridBufferID, _gridTextureID, GL_RG32UI, _grid.data(), _grid.size() * sizeof(glm::uvec2), &_gridCapacity);
+    _uploadBuffer(_indexBufferID, _indexTextureID, GL_R32UI, _indices.data(), _indices.size() * sizeof(GLuint), &_indexCapacity);
+}
+
+void ClusterGrid::bind(unsigned int gridSlot, unsigned int indexSlot) const
+{
+    getRenderDevice().activeTexture(GL_TEXTURE0 + gridSlot);
+    getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, _gridTextureID);
+    getRenderDevice().activeTexture(GL_TEXTURE0 + indexSlot);
+    getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, _indexTextureID);
+}
+
+/* Uniforms used by texture.fs to find the cluster of a fragment */
+void ClusterGrid::setUniforms(const Shader& shader) const
+{
+    shader.setIVec3("clusterDims", glm::ivec3(_dimX, _dimY, _dimZ));
+    shader.setVec4("clusterScale",
+        static_cast<GLfloat>(_dimX) / static_cast<GLfloat>(_viewportWidth),
+        static_cast<GLfloat>(_dimY) / static_cast<GLfloat>(_viewportHeight),
+        static_cast<GLfloat>(_dimZ - 1) / glm::log(_far / _nearSplit),
+        _nearSplit);
+}
+
+/* Total length of the per-cluster light lists of the last build */
+GLuint ClusterGrid::getLightIndexCount(void) const
+{
+    return static_cast<GLuint>(_clusterLightPairs.size());
+}
+
+GLfloat ClusterGrid::_sliceDepth(GLuint slice) const
+{
+    if (slice == 0)
+        return _near;
+    return _nearSplit * glm::pow(_far / _nearSplit, static_cast<GLfloat>(slice - 1) / static_cast<GLfloat>(_dimZ - 1));
+}
+
+GLuint ClusterGrid::_depthToSlice(GLfloat depth) const
+{
+    if (depth < _nearSplit)
+        return 0;
+    GLint slice = 1 + static_cast<GLint>(glm::log(depth / _nearSplit) * static_cast<GLfloat>(_dimZ - 1) / glm::log(_far / _nearSplit));
+    return static_cast<GLuint>(CLAMP(slice, 1, static_cast<GLint>(_dimZ) - 1));
+}
+
+/* View-space AABB of every cluster (only when the projection changes) */
+void ClusterGrid::_computeClusterBounds(void)
+{
+    glm::mat4 inverseProjection = glm::inverse(_projectionMatrix);
+    for (GLuint y = 0; y < _dimY; y++) {
+        for (GLuint x = 0; x < _dimX; x++) {
+            /* Rays through the tile corners, scaled to unit view depth */
+            glm::vec3 rays[4];
+            for (GLuint i = 0; i < 4; i++) {
+                glm::vec2 ndc(-1.0f + 2.0f * static_cast<GLfloat>(x + (i & 1)) / static_cast<GLfloat>(_dimX),
+                              -1.0f + 2.0f * static_cast<GLfloat>(y + (i >> 1)) / static_cast<GLfloat>(_dimY));
+                glm::vec4 p = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+                rays[i] = glm::vec3(p) / p.w;
+                rays[i] /= -rays[i].z;
+            }
+            for (GLuint z = 0; z < _dimZ; z++) {
+                GLfloat d0 = _sliceDepth(z), d1 = (z + 1 == _dimZ) ? _far : _sliceDepth(z + 1);
+                glm::vec3 lo(1e+30f), hi(-1e+30f);
+                for (GLuint i = 0; i < 4; i++) {
+                    lo = glm::min(lo, glm::min(rays[i] * d0, rays[i] * d1));
+                    hi = glm::max(hi, glm::max(rays[i] * d0, rays[i] * d1));
+                }
+                size_t cluster = (static_cast<size_t>(z) * _dimY + y) * _dimX + x;
+                _clusterMin[cluster] = lo;
+                _clusterMax[cluster] = hi;
+            }
+        }
+    }
+}
+
+void ClusterGrid::_assignLight(glm::vec3 center, GLfloat radius, GLuint lightIndex)
+{
+    GLfloat minDepth = -center.z - radius, maxDepth = -center.z + radius;
+    if (maxDepth < _near || minDepth > _far)
+        return;
+    GLuint z0 = _depthToSlice(MAX(minDepth, _near)), z1 = _depthToSlice(MIN(maxDepth, _far));
+
+    /* Screen rectangle of the sphere's bounding box (whole screen if it crosses the near plane) */
+    GLint x0 = 0, y0 = 0, x1 = _dimX - 1, y1 = _dimY - 1;
+    if (minDepth > _near) {
+        glm::vec2 lo(1.0f), hi(-1.0f);
+        for (GLuint i = 0; i < 8; i++) {
+            glm::vec3 corner = center + radius * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+            glm::vec4 clip = _projectionMatrix * glm::vec4(corner, 1.0f);
+            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            lo = glm::min(lo, ndc);
+            hi = glm::max(hi, ndc);
+        }
+        if (hi.x < -1.0f || hi.y < -1.0f || lo.x > 1.0f || lo.y > 1.0f)
+            return;
+        x0 = CLAMP(static_cast<GLint>((lo.x * 0.5f + 0.5f) * _dimX), 0, static_cast<GLint>(_dimX) - 1);
+        x1 = CLAMP(static_cast<GLint>((hi.x * 0.5f + 0.5f) * _dimX), 0, static_cast<GLint>(_dimX) - 1);
+        y0 = CLAMP(static_cast<GLint>((lo.y * 0.5f + 0.5f) * _dimY), 0, static_cast<GLint>(_dimY) - 1);
+        y1 = CLAMP(static_cast<GLint>((hi.y * 0.5f + 0.5f) * _dimY), 0, static_cast<GLint>(_dimY) - 1);
+    }
+
+    /* Keep the clusters whose AABB actually touches the sphere */
+    const GLfloat radius2 = radius * radius;
+    for (GLuint z = z0; z <= z1; z++) {
+        for (GLint y = y0; y <= y1; y++) {
+            for (GLint x = x0; x <= x1; x++) {
+                GLuint cluster = (z * _dimY + y) * _dimX + x;
+                glm::vec3 closest = glm::clamp(center, _clusterMin[cluster], _clusterMax[cluster]);
+                glm::vec3 delta = closest - center;
+                if (glm::dot(delta, delta) <= radius2)
+                    _clusterLightPairs.push_back(glm::uvec2(cluster, lightIndex));
+            }
+        }
+    }
+}
+
+void ClusterGrid::_uploadBuffer(GLuint bufferID, GLuint textureID, GLenum format, const void* data, GLsizeiptr size, GLsizeiptr* capacity)
+{
+    if (_ring && _ring->uploadTextureBuffer(textureID, format, data, size))
+        return;
+
+    getRenderDevice().bindBuffer(GL_TEXTURE_BUFFER, bufferID);
+    if (size > *capacity) {
+        getRenderDevice().bufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+        *capacity = size;
+        getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, textureID);
+        getRenderDevice().texBuffer(GL_TEXTURE_BUFFER, format, bufferID);
+        getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else {
+        getRenderDevice().bufferData(GL_TEXTURE_BUFFER, *capacity, NULL, GL_STREAM_DRAW);  /* Orphan the old storage */
+        getRenderDevice().bufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    }
+    getRenderDevice().bindBuffer(GL_TEXTURE_BUFFER, 0);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "light/light.h"
+#include "ring/ring.h"
+#include "shader/shader.h"
+
+#include <vector>
+
+/*
+Clustered forward shading: the view frustum is split into a dimX x dimY x dimZ
+grid of froxels (screen tiles x exponential depth slices) and every cluster
+gets the list of point/spot lights whose range sphere touches it.
+
+Slice 0 covers [near, nearSplit], slices 1..dimZ-1 split [nearSplit, far]
+exponentially. Light indices refer to the order of LightBuffer (spot lights
+first, then point lights). Like the lights, the lists go through the
+StreamRing when glTexBufferRange is available.
+*/
+class ClusterGrid
+{
+public:
+    void setupClusterGrid(GLuint dimX, GLuint dimY, GLuint dimZ, GLfloat nearSplit, StreamRing* ring);
+    void build(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, GLfloat near, GLfloat far, GLint viewportWidth, GLint viewportHeight,
+               const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights);
+    void bind(unsigned int gridSlot, unsigned int indexSlot) const;
+    void setUniforms(const Shader& shader) const;
+    GLuint getLightIndexCount(void) const;
+
+private:
+    GLuint _dimX, _dimY, _dimZ;
+    GLfloat _near, _far, _nearSplit;
+    GLint _viewportWidth, _viewportHeight;
+    glm::mat4 _projectionMatrix;
+
+    std::vector<glm::vec3> _clusterMin, _clusterMax;  /* View-space bounds of every cluster */
+    std::vector<glm::uvec2> _clusterLightPairs;       /* (cluster, light) found during assignment */
+    std::vector<glm::uvec2> _grid;                    /* (offset, count) into _indices per cluster */
+    std::vector<GLuint> _indices;
+
+    GLuint _gridBufferID, _gridTextureID, _indexBufferID, _indexTextureID;
+    GLsizeiptr _gridCapacity, _indexCapacity;
+    StreamRing* _ring;
+
+    GLfloat _sliceDepth(GLuint slice) const;
+    GLuint _depthToSlice(GLfloat depth) const;
+    void _computeClusterBounds(void);
+    void _assignLight(glm::vec3 center, GLfloat radius, GLuint lightIndex);
+    void _uploadBuffer(GLuint bufferID, GLuint textureID, GLenum format, const void* data, GLsizeiptr size, GLsizeiptr* capacity);
+};
@@ -0,0 +1,233 @@
+#include "culling.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <chrono>
+#include <iostream>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+void FrustumCuller::clear(void)
+{
+    _centerX.clear();
+    _centerY.clear();
+    _centerZ.clear();
+    _extentX.clear();
+    _extentY.clear();
+    _extentZ.clear();
+    _radius.clear();
+    _visible.clear();
+}
+
+void FrustumCuller::add(const Bounds& bounds, const glm::mat4& modelMatrix)
+{
+    resize(size() + 1);
+    set(size() - 1, bounds, modelMatrix);
+}
+
+void FrustumCuller::resize(size_t count)
+{
+    _centerX.resize(count);
+    _centerY.resize(count);
+    _centerZ.resize(count);
+    _extentX.resize(count);
+    _extentY.resize(count);
+    _extentZ.resize(count);
+    _radius.resize(count);
+    _visible.resize(count, 1);
+}
+
+/* Move the local bounds to world space: the box stays axis aligned, the sphere grows with the largest scale */
+void FrustumCuller::set(size_t index, const Bounds& bounds, const glm::mat4& modelMatrix)
+{
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(0.5f * (bounds.bboxMin + bounds.bboxMax), 1.0f));
+    glm::vec3 halfSize = 0.5f * (bounds.bboxMax - bounds.bboxMin);
+    glm::vec3 extent = glm::abs(glm::vec3(modelMatrix[0])) * halfSize.x +
+                       glm::abs(glm::vec3(modelMatrix[1])) * halfSize.y +
+                       glm::abs(glm::vec3(modelMatrix[2])) * halfSize.z;
+    GLfloat scale = glm::max(glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1]))),
+                             glm::length(glm::vec3(modelMatrix[2])));
+    glm::vec3 sphereCenter = glm::vec3(modelMatrix * glm::vec4(bounds.sphereCenter, 1.0f));
+
+    /* Both volumes share one center: grow the sphere to cover its offset from the box center */
+    _centerX[index] = center.x;
+    _centerY[index] = center.y;
+    _centerZ[index] = center.z;
+    _extentX[index] = extent.x;
+    _extentY[index] = extent.y;
+    _extentZ[index] = extent.z;
+    _radius[index] = bounds.sphereRadius * scale + glm::length(sphereCenter - center);
+}
+
+GLuint FrustumCuller::cull(const glm::mat4& viewProjectionMatrix)
+{
+    setPlanes(viewProjectionMatrix);
+    return cullRange(0, size());
+}
+
+/* Test the objects in [begin, end) against the planes of the last setPlanes() */
+GLuint FrustumCuller::cullRange(size_t begin, size_t end)
+{
+    size_t i = begin;
+    GLuint visibleCount = 0;
+
+#if defined(__AVX__)
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    for (; i + 8 <= end; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&_centerX[i]), cy = _mm256_loadu_ps(&_centerY[i]), cz = _mm256_loadu_ps(&_centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&_extentX[i]), ey = _mm256_loadu_ps(&_extentY[i]), ez = _mm256_loadu_ps(&_extentZ[i]);
+        __m256 r = _mm256_loadu_ps(&_radius[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4& p : _planes) {
+            __m256 nx = _mm256_set1_ps(p.x), ny = _mm256_set1_ps(p.y), nz = _mm256_set1_ps(p.z);
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)),
+                                     _mm256_add_ps(_mm256_mul_ps(nz, cz), _mm256_set1_ps(p.w)));
+            __m256 boxR = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_and_ps(nx, absMask), ex), _mm256_mul_ps(_mm256_and_ps(ny, absMask), ey)),
+                                        _mm256_mul_ps(_mm256_and_ps(nz, absMask), ez));
+            __m256 reach = _mm256_min_ps(r, boxR);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; k++)
+            _visible[i + k] = (mask >> k) & 1;
+        visibleCount += __builtin_popcount(mask);
+    }
+#elif defined(__SSE2__)
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for (; i + 4 <= end; i += 4) {
+        __m128 cx = _mm_loadu_ps(&_centerX[i]), cy = _mm_loadu_ps(&_centerY[i]), cz = _mm_loadu_ps(&_centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&_extentX[i]), ey = _mm_loadu_ps(&_extentY[i]), ez = _mm_loadu_ps(&_extentZ[i]);
+        __m128 r = _mm_loadu_ps(&_radius[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const glm::vec4& p : _planes) {
+            __m128 nx = _mm_set1_ps(p.x), ny = _mm_set1_ps(p.y), nz = _mm_set1_ps(p.z);
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+                                  _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(p.w)));
+            __m128 boxR = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey)),
+                                     _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+            __m128 reach = _mm_min_ps(r, boxR);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, reach), _mm_setzero_ps()));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; k++)
+            _visible[i + k] = (mask >> k) & 1;
+        visibleCount += __builtin_popcount(mask);
+    }
+#endif
+
+    /* Remainder (or everything without SIMD) */
+    for (; i < end; i++) {
+        _visible[i] = _testScalar(i);
+        visibleCount += _visible[i];
+    }
+
+    return visibleCount;
+}
+
+/* Reference implementation of cull(), one object at a time */
+GLuint FrustumCuller::cullScalar(const glm::mat4& viewProjectionMatrix)
+{
+    setPlanes(viewProjectionMatrix);
+
+    GLuint visibleCount = 0;
+    for (size_t i = 0; i < _radius.size(); i++) {
+        _visible[i] = _testScalar(i);
+        visibleCount += _visible[i];
+    }
+    return visibleCount;
+}
+
+bool FrustumCuller::isVisible(size_t index) const
+{
+    return _visible[index];
+}
+
+size_t FrustumCuller::size(void) const
+{
+    return _radius.size();
+}
+
+/* Gribb-Hartmann: each plane is the last row of the matrix plus or minus one of the others */
+void FrustumCuller::setPlanes(const glm::mat4& viewProjectionMatrix)
+{
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(viewProjectionMatrix[0][i], viewProjectionMatrix[1][i], viewProjectionMatrix[2][i], viewProjectionMatrix[3][i]);
+
+    _planes[0] = row[3] + row[0];  /* Left */
+    _planes[1] = row[3] - row[0];  /* Right */
+    _planes[2] = row[3] + row[1];  /* Bottom */
+    _planes[3] = row[3] - row[1];  /* Top */
+    _planes[4] = row[3] + row[2];  /* Near */
+    _planes[5] = row[3] - row[2];  /* Far */
+    for (glm::vec4& p : _planes)
+        p /= glm::length(glm::vec3(p));
+}
+
+bool FrustumCuller::_testScalar(size_t index) const
+{
+    for (const glm::vec4& p : _planes) {
+        GLfloat d = p.x * _centerX[index] + p.y * _centerY[index] + (p.z * _centerZ[index] + p.w);
+        GLfloat boxR = glm::abs(p.x) * _extentX[index] + glm::abs(p.y) * _extentY[index] + glm::abs(p.z) * _extentZ[index];
+        if (d + glm::min(_radius[index], boxR) < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+/* Time cull() against cullScalar() on randomly placed objects (no OpenGL needed) */
+void benchmarkFrustumCulling(GLuint objectCount, GLuint iterations)
+{
+    FrustumCuller culler;
+    Bounds bounds = {glm::vec3(-0.5f), glm::vec3(0.5f), glm::vec3(0.0f), glm::sqrt(0.75f)};
+    for (GLuint i = 0; i < objectCount; i++) {
+        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(randreal(-500.0, 500.0), randreal(-50.0, 50.0), randreal(-500.0, 500.0)));
+        modelMatrix = glm::scale(modelMatrix, glm::vec3(randreal(0.5, 10.0)));
+        culler.add(bounds, modelMatrix);
+    }
+
+    glm::mat4 projectionMatrix = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.01f, 300.0f);
+    std::vector<glm::mat4> viewProjectionMatrices(iterations);
+    for (GLuint i = 0; i < iterations; i++) {
+        GLfloat angle = glm::radians(360.0f * i / iterations);
+        viewProjectionMatrices[i] = projectionMatrix * glm::lookAt(glm::vec3(0.0f), glm::vec3(glm::sin(angle), 0.0f, -glm::cos(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    std::vector<unsigned char> reference(objectCount);
+    double scalarTime = 0.0, simdTime = 0.0;
+    GLuint visibleCount = 0, mismatchCount = 0;
+    for (GLuint i = 0; i < iterations; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        culler.cullScalar(viewProjectionMatrices[i]);
+        auto t1 = std::chrono::steady_clock::now();
+        for (GLuint j = 0; j < objectCount; j++)
+            reference[j] = culler.isVisible(j);
+
+        auto t2 = std::chrono::steady_clock::now();
+        visibleCount += culler.cull(viewProjectionMatrices[i]);
+        auto t3 = std::chrono::steady_clock::now();
+        for (GLuint j = 0; j < objectCount; j++)
+            mismatchCount += reference[j] != culler.isVisible(j);
+
+        scalarTime += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        simdTime += std::chrono::duration<double, std::milli>(t3 - t2).count();
+    }
+
+#if defined(__AVX__)
+    const char* simdName = "AVX";
+#elif defined(__SSE2__)
+    const char* simdName = "SSE";
+#else
+    const char* simdName = "no SIMD";
+#endif
+    std::cout << "INF: Culled " << objectCount << " objects " << iterations << " times, "
+              << visibleCount / iterations << " visible on average" << std::endl;
+    std::cout << "INF: Scalar " << scalarTime / iterations << " ms, " << simdName << " " << simdTime / iterations
+              << " ms per pass (" << scalarTime / simdTime << "x)" << std::endl;
+    if (mismatchCount) {
+        std::cerr << "ERR: SIMD and scalar culling disagree on " << mismatchCount << " objects" << std::endl;
+        exit(1);
+    }
+}
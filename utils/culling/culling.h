@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "misc/misc.h"
+
+#include <vector>
+
+/*
+Frustum culling of world-space object bounds.
+
+Objects are added once per frame with their local Bounds and model matrix and
+kept in SoA arrays (center, box extent, sphere radius). cull() tests them
+against the six planes of the view-projection matrix, 8 objects at a time with
+AVX, 4 with SSE, or one by one otherwise. An object is outside when it lies
+behind a plane by more than the smaller of its sphere radius and its box
+extent projected onto the plane normal.
+
+For parallel culling, resize() then set() each object, call setPlanes() and
+cull disjoint ranges with cullRange() from any thread.
+*/
+class FrustumCuller
+{
+public:
+    void clear(void);
+    void add(const Bounds& bounds, const glm::mat4& modelMatrix);
+    void resize(size_t count);
+    void set(size_t index, const Bounds& bounds, const glm::mat4& modelMatrix);
+    GLuint cull(const glm::mat4& viewProjectionMatrix);  /* Returns the visible count */
+    void setPlanes(const glm::mat4& viewProjectionMatrix);
+    GLuint cullRange(size_t begin, size_t end);
+    GLuint cullScalar(const glm::mat4& viewProjectionMatrix);
+    bool isVisible(size_t index) const;
+    size_t size(void) const;
+
+private:
+    glm::vec4 _planes[6];
+    std::vector<float> _centerX, _centerY, _centerZ;
+    std::vector<float> _extentX, _extentY, _extentZ;
+    std::vector<float> _radius;
+    std::vector<unsigned char> _visible;
+
+    bool _testScalar(size_t index) const;
+};
+
+void benchmarkFrustumCulling(GLuint objectCount, GLuint iterations);
@@ -0,0 +1,140 @@
+#include "deferred.h"
+
+#include <iostream>
+#include <string>
+
+void Deferred::setupDeferred(const char* fullscreenVertexPath, const char* dirLightFragmentPath,
+                             const char* volumeVertexPath, const char* volumeFragmentPath, GLint width, GLint height)
+{
+    _dirLightShader.setupShader(fullscreenVertexPath, dirLightFragmentPath);
+    _volumeShader.setupShader(volumeVertexPath, volumeFragmentPath);
+    glGenVertexArrays(1, &_emptyVAO);
+
+    glGenFramebuffers(1, &_fboID);
+    glGenTextures(_TARGET_COUNT, _textureIDs);
+    _width = width;
+    _height = height;
+    _createTargets();
+}
+
+void Deferred::resize(GLint width, GLint height)
+{
+    if (width == _width && height == _height)
+        return;
+    _width = width;
+    _height = height;
+    _createTargets();
+}
+
+void Deferred::beginGeometryPass(void)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _fboID);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/* Copy the scene depth into the output framebuffer (0 for the window) for light volumes and forward-drawn extras */
+void Deferred::endGeometryPass(GLuint outputFramebuffer)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fboID);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+    glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+}
+
+void Deferred::drawLights(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, glm::vec3 eyePos, glm::vec3 ambientK,
+                          const std::vector<DirLight>& dirLights, const LightBuffer& lightBuffer,
+                          GLuint volumeVAO, GLsizei volumeIndexCount, GLuint volumeFirstIndex, GLint volumeBaseVertex, GLfloat volumeScale)
+{
+    glm::mat4 inverseViewProjection = glm::inverse(projectionMatrix * viewMatrix);
+
+    /* Ambient, emission and directional lights */
+    glDisable(GL_DEPTH_TEST);
+    _dirLightShader.use();
+    _bindTargets(_dirLightShader);
+    _dirLightShader.setMat4("inverseViewProjection", inverseViewProjection);
+    _dirLightShader.setVec3("eyePosWorld", eyePos);
+    _dirLightShader.setBool("useBlinn", GL_TRUE);
+    _dirLightShader.setVec3("ambientK", ambientK);
+    for (GLuint i = 0; i < dirLights.size(); i++) {
+        _dirLightShader.setVec3(UniformName("dirLights", i, "light.diffuseK"), dirLights[i].light.diffuseK);
+        _dirLightShader.setVec3(UniformName("dirLights", i, "light.specularK"), dirLights[i].light.specularK);
+        _dirLightShader.setVec3(UniformName("dirLights", i, "light.intensity"), dirLights[i].light.intensity);
+        _dirLightShader.setVec3(UniformName("dirLights", i, "dir"), dirLights[i].dir);
+    }
+    glBindVertexArray(_emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    /*
+    Point and spot lights, added up over their volumes. Back faces are drawn
+    with GL_GEQUAL so that the camera may be inside a volume, and depth clamping
+    keeps the parts of large volumes beyond the far plane.
+    */
+    if (lightBuffer.getLightCount() > 0) {
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_DEPTH_CLAMP);
+        glDepthFunc(GL_GEQUAL);
+        glDepthMask(GL_FALSE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        _volumeShader.use();
+        _bindTargets(_volumeShader);
+        lightBuffer.bind(_TARGET_COUNT);
+        _volumeShader.setInt("lightData", _TARGET_COUNT);
+        _volumeShader.setMat4("viewMatrix", viewMatrix);
+        _volumeShader.setMat4("projectionMatrix", projectionMatrix);
+        _volumeShader.setMat4("inverseViewProjection", inverseViewProjection);
+        _volumeShader.setFloat("volumeScale", volumeScale);
+        _volumeShader.setVec3("eyePosWorld", eyePos);
+        _volumeShader.setBool("useBlinn", GL_TRUE);
+        glBindVertexArray(volumeVAO);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, volumeIndexCount, GL_UNSIGNED_INT, (void*)(volumeFirstIndex * sizeof(GLuint)),
+                                          lightBuffer.getLightCount(), volumeBaseVertex);
+
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_CLAMP);
+        glCullFace(GL_BACK);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+    glEnable(GL_DEPTH_TEST);
+}
+
+void Deferred::_createTargets(void)
+{
+    const GLenum internalFormats[_TARGET_COUNT] = {GL_RGBA8, GL_RGBA8, GL_RG16, GL_R11F_G11F_B10F, GL_DEPTH24_STENCIL8};
+    const GLenum formats[_TARGET_COUNT] = {GL_RGBA, GL_RGBA, GL_RG, GL_RGB, GL_DEPTH_STENCIL};
+    const GLenum types[_TARGET_COUNT] = {GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT, GL_UNSIGNED_INT_24_8};
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _fboID);
+    for (GLuint i = 0; i < _TARGET_COUNT; i++) {
+        glBindTexture(GL_TEXTURE_2D, _textureIDs[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], _width, _height, 0, formats[i], types[i], NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, (i == _DEPTH) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, _textureIDs[i], 0);
+    }
+    const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3};
+    glDrawBuffers(4, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERR: Failed to create G-buffer" << std::endl;
+        exit(1);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Deferred::_bindTargets(const Shader& shader) const
+{
+    const char* names[_TARGET_COUNT] = {"gAlbedo", "gSpecular", "gNormal", "gEmission", "gDepth"};
+    for (GLuint i = 0; i < _TARGET_COUNT; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, _textureIDs[i]);
+        shader.setInt(names[i], i);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "light/light.h"
+#include "shader/shader.h"
+
+#include <vector>
+
+/*
+Deferred shading. The geometry pass renders into a G-buffer of
+    albedo (RGBA8: diffuse color),
+    specular (RGBA8: specular color, shininess / 255),
+    normal (RG16: octahedral-encoded),
+    emission (R11F_G11F_B10F: emission color) and
+    depth (24-bit depth, 8-bit stencil),
+then lighting runs as screen-space passes into the output framebuffer (the
+window's, or an offscreen one):
+ambient/emission/directional lights over the full screen and one light
+volume (an instanced sphere mesh) per point/spot light.
+*/
+class Deferred
+{
+public:
+    void setupDeferred(const char* fullscreenVertexPath, const char* dirLightFragmentPath,
+                       const char* volumeVertexPath, const char* volumeFragmentPath, GLint width, GLint height);
+    void resize(GLint width, GLint height);
+    void beginGeometryPass(void);
+    void endGeometryPass(GLuint outputFramebuffer);
+    void drawLights(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, glm::vec3 eyePos, glm::vec3 ambientK,
+                    const std::vector<DirLight>& dirLights, const LightBuffer& lightBuffer,
+                    GLuint volumeVAO, GLsizei volumeIndexCount, GLuint volumeFirstIndex, GLint volumeBaseVertex, GLfloat volumeScale);
+
+private:
+    enum _Target {
+        _ALBEDO,
+        _SPECULAR,
+        _NORMAL,
+        _EMISSION,
+        _DEPTH,
+        _TARGET_COUNT,
+    };
+
+    GLuint _fboID, _textureIDs[_TARGET_COUNT];
+    GLuint _emptyVAO;
+    GLint _width, _height;
+    Shader _dirLightShader, _volumeShader;
+
+    void _createTargets(void);
+    void _bindTargets(const Shader& shader) const;
+};
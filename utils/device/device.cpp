@@ -0,0 +1,818 @@
+#include "device.h"
+
+#include <cstdint>
+
+static GLRenderDevice glDevice;
+static RenderDevice* currentDevice = &glDevice;
+
+RenderDevice& getRenderDevice(void)
+{
+    return *currentDevice;
+}
+
+void setRenderDevice(RenderDevice* device)
+{
+    currentDevice = device ? device : &glDevice;
+}
+
+/* ----- GLRenderDevice ----- */
+GLuint GLRenderDevice::createShader(GLenum type)
+{
+    return glCreateShader(type);
+}
+
+void GLRenderDevice::shaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+    glShaderSource(shader, count, string, length);
+}
+
+void GLRenderDevice::compileShader(GLuint shader)
+{
+    glCompileShader(shader);
+}
+
+void GLRenderDevice::getShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    glGetShaderiv(shader, pname, params);
+}
+
+void GLRenderDevice::getShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    glGetShaderInfoLog(shader, bufSize, length, infoLog);
+}
+
+void GLRenderDevice::deleteShader(GLuint shader)
+{
+    glDeleteShader(shader);
+}
+
+GLuint GLRenderDevice::createProgram(void)
+{
+    return glCreateProgram();
+}
+
+void GLRenderDevice::attachShader(GLuint program, GLuint shader)
+{
+    glAttachShader(program, shader);
+}
+
+void GLRenderDevice::linkProgram(GLuint program)
+{
+    glLinkProgram(program);
+}
+
+void GLRenderDevice::getProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    glGetProgramiv(program, pname, params);
+}
+
+void GLRenderDevice::getProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    glGetProgramInfoLog(program, bufSize, length, infoLog);
+}
+
+void GLRenderDevice::useProgram(GLuint program)
+{
+    glUseProgram(program);
+}
+
+GLint GLRenderDevice::getUniformLocation(GLuint program, const GLchar* name)
+{
+    return glGetUniformLocation(program, name);
+}
+
+void GLRenderDevice::uniform1i(GLint location, GLint v0)
+{
+    glUniform1i(location, v0);
+}
+
+void GLRenderDevice::uniform1f(GLint location, GLfloat v0)
+{
+    glUniform1f(location, v0);
+}
+
+void GLRenderDevice::uniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+    glUniform2f(location, v0, v1);
+}
+
+void GLRenderDevice::uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+    glUniform3f(location, v0, v1, v2);
+}
+
+void GLRenderDevice::uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    glUniform4f(location, v0, v1, v2, v3);
+}
+
+void GLRenderDevice::uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    glUniform2fv(location, count, value);
+}
+
+void GLRenderDevice::uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    glUniform3fv(location, count, value);
+}
+
+void GLRenderDevice::uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    glUniform4fv(location, count, value);
+}
+
+void GLRenderDevice::uniform3iv(GLint location, GLsizei count, const GLint* value)
+{
+    glUniform3iv(location, count, value);
+}
+
+void GLRenderDevice::uniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    glUniformMatrix2fv(location, count, transpose, value);
+}
+
+void GLRenderDevice::uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    glUniformMatrix3fv(location, count, transpose, value);
+}
+
+void GLRenderDevice::uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    glUniformMatrix4fv(location, count, transpose, value);
+}
+
+void GLRenderDevice::genTextures(GLsizei n, GLuint* textures)
+{
+    glGenTextures(n, textures);
+}
+
+void GLRenderDevice::activeTexture(GLenum texture)
+{
+    glActiveTexture(texture);
+}
+
+void GLRenderDevice::bindTexture(GLenum target, GLuint texture)
+{
+    glBindTexture(target, texture);
+}
+
+void GLRenderDevice::texParameteri(GLenum target, GLenum pname, GLint param)
+{
+    glTexParameteri(target, pname, param);
+}
+
+void GLRenderDevice::texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* data)
+{
+    glTexImage2D(target, level, internalFormat, width, height, border, format, type, data);
+}
+
+void GLRenderDevice::generateMipmap(GLenum target)
+{
+    glGenerateMipmap(target);
+}
+
+void GLRenderDevice::texBuffer(GLenum target, GLenum internalFormat, GLuint buffer)
+{
+    glTexBuffer(target, internalFormat, buffer);
+}
+
+void GLRenderDevice::texBufferRange(GLenum target, GLenum internalFormat, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    glTexBufferRange(target, internalFormat, buffer, offset, size);
+}
+
+void GLRenderDevice::genBuffers(GLsizei n, GLuint* buffers)
+{
+    glGenBuffers(n, buffers);
+}
+
+void GLRenderDevice::deleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    glDeleteBuffers(n, buffers);
+}
+
+void GLRenderDevice::bindBuffer(GLenum target, GLuint buffer)
+{
+    glBindBuffer(target, buffer);
+}
+
+void GLRenderDevice::bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    glBufferData(target, size, data, usage);
+}
+
+void GLRenderDevice::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    glBufferSubData(target, offset, size, data);
+}
+
+void GLRenderDevice::bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    glBufferStorage(target, size, data, flags);
+}
+
+void* GLRenderDevice::mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    return glMapBufferRange(target, offset, length, access);
+}
+
+GLboolean GLRenderDevice::unmapBuffer(GLenum target)
+{
+    return glUnmapBuffer(target);
+}
+
+void GLRenderDevice::genVertexArrays(GLsizei n, GLuint* arrays)
+{
+    glGenVertexArrays(n, arrays);
+}
+
+void GLRenderDevice::bindVertexArray(GLuint array)
+{
+    glBindVertexArray(array);
+}
+
+void GLRenderDevice::enableVertexAttribArray(GLuint index)
+{
+    glEnableVertexAttribArray(index);
+}
+
+void GLRenderDevice::vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void GLRenderDevice::vertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    glVertexAttribDivisor(index, divisor);
+}
+
+void GLRenderDevice::drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    glDrawArrays(mode, first, count);
+}
+
+void GLRenderDevice::drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    glDrawElements(mode, count, type, indices);
+}
+
+void GLRenderDevice::drawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount, GLint baseVertex)
+{
+    glDrawElementsInstancedBaseVertex(mode, count, type, indices, instanceCount, baseVertex);
+}
+
+void GLRenderDevice::multiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride)
+{
+    glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+}
+
+void GLRenderDevice::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    glViewport(x, y, width, height);
+}
+
+void GLRenderDevice::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GLRenderDevice::clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    glClearColor(red, green, blue, alpha);
+}
+
+void GLRenderDevice::clear(GLbitfield mask)
+{
+    glClear(mask);
+}
+
+void GLRenderDevice::enable(GLenum cap)
+{
+    glEnable(cap);
+}
+
+void GLRenderDevice::depthFunc(GLenum func)
+{
+    glDepthFunc(func);
+}
+
+void GLRenderDevice::depthMask(GLboolean flag)
+{
+    glDepthMask(flag);
+}
+
+void GLRenderDevice::colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+    glColorMask(red, green, blue, alpha);
+}
+
+void GLRenderDevice::pointSize(GLfloat size)
+{
+    glPointSize(size);
+}
+
+void GLRenderDevice::lineWidth(GLfloat width)
+{
+    glLineWidth(width);
+}
+
+void GLRenderDevice::getIntegerv(GLenum pname, GLint* data)
+{
+    glGetIntegerv(pname, data);
+}
+
+void GLRenderDevice::pixelStorei(GLenum pname, GLint param)
+{
+    glPixelStorei(pname, param);
+}
+
+void GLRenderDevice::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+{
+    glReadPixels(x, y, width, height, format, type, pixels);
+}
+
+GLsync GLRenderDevice::fenceSync(GLenum condition, GLbitfield flags)
+{
+    return glFenceSync(condition, flags);
+}
+
+GLenum GLRenderDevice::clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    return glClientWaitSync(sync, flags, timeout);
+}
+
+void GLRenderDevice::deleteSync(GLsync sync)
+{
+    glDeleteSync(sync);
+}
+
+void GLRenderDevice::genQueries(GLsizei n, GLuint* ids)
+{
+    glGenQueries(n, ids);
+}
+
+void GLRenderDevice::beginQuery(GLenum target, GLuint id)
+{
+    glBeginQuery(target, id);
+}
+
+void GLRenderDevice::endQuery(GLenum target)
+{
+    glEndQuery(target);
+}
+
+void GLRenderDevice::getQueryObjectiv(GLuint id, GLenum pname, GLint* params)
+{
+    glGetQueryObjectiv(id, pname, params);
+}
+
+void GLRenderDevice::getQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params)
+{
+    glGetQueryObjectui64v(id, pname, params);
+}
+
+/* ----- NullRenderDevice ----- */
+NullRenderDevice::NullRenderDevice()
+{
+    _nextName = 1;
+    resetCounters();
+}
+
+void NullRenderDevice::resetCounters(void)
+{
+    for (GLuint i = 0; i < COMMAND_KIND_COUNT; i++)
+        _counts[i] = 0;
+    _uploadBytes = 0;
+}
+
+GLuint64 NullRenderDevice::getCommandCount(CommandKind kind) const
+{
+    return _counts[kind];
+}
+
+GLuint64 NullRenderDevice::getTotalCommandCount(void) const
+{
+    GLuint64 total = 0;
+    for (GLuint i = 0; i < COMMAND_KIND_COUNT; i++)
+        total += _counts[i];
+    return total;
+}
+
+GLuint64 NullRenderDevice::getUploadBytes(void) const
+{
+    return _uploadBytes;
+}
+
+const char* NullRenderDevice::getCommandKindName(CommandKind kind)
+{
+    static const char* const names[COMMAND_KIND_COUNT] = {"draws", "uniforms", "binds", "state", "resources", "sync"};
+    return names[kind];
+}
+
+GLuint NullRenderDevice::createShader(GLenum type)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    return _nextName++;
+}
+
+void NullRenderDevice::shaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::compileShader(GLuint shader)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::getShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    *params = pname == GL_INFO_LOG_LENGTH ? 1 : GL_TRUE;
+}
+
+void NullRenderDevice::getShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    if (length)
+        *length = 0;
+    if (bufSize > 0)
+        infoLog[0] = '\0';
+}
+
+void NullRenderDevice::deleteShader(GLuint shader)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+GLuint NullRenderDevice::createProgram(void)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    return _nextName++;
+}
+
+void NullRenderDevice::attachShader(GLuint program, GLuint shader)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::linkProgram(GLuint program)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::getProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    getShaderiv(program, pname, params);
+}
+
+void NullRenderDevice::getProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    getShaderInfoLog(program, bufSize, length, infoLog);
+}
+
+void NullRenderDevice::useProgram(GLuint program)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+GLint NullRenderDevice::getUniformLocation(GLuint program, const GLchar* name)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    return 0;
+}
+
+void NullRenderDevice::uniform1i(GLint location, GLint v0)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform1f(GLint location, GLfloat v0)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniform3iv(GLint location, GLsizei count, const GLint* value)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    _counts[UNIFORM_COMMANDS]++;
+}
+
+void NullRenderDevice::genTextures(GLsizei n, GLuint* textures)
+{
+    _generate(n, textures);
+}
+
+void NullRenderDevice::activeTexture(GLenum texture)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+void NullRenderDevice::bindTexture(GLenum target, GLuint texture)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+void NullRenderDevice::texParameteri(GLenum target, GLenum pname, GLint param)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border,
+                                  GLenum format, GLenum type, const void* data)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    GLuint channels = format == GL_RED ? 1 : (format == GL_RGB ? 3 : 4);
+    _uploadBytes += static_cast<GLuint64>(width) * height * channels;
+}
+
+void NullRenderDevice::generateMipmap(GLenum target)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::texBuffer(GLenum target, GLenum internalFormat, GLuint buffer)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::texBufferRange(GLenum target, GLenum internalFormat, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+void NullRenderDevice::genBuffers(GLsizei n, GLuint* buffers)
+{
+    _generate(n, buffers);
+}
+
+void NullRenderDevice::deleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    for (GLsizei i = 0; i < n; i++)
+        _storage.erase(buffers[i]);
+}
+
+void NullRenderDevice::bindBuffer(GLenum target, GLuint buffer)
+{
+    _counts[BIND_COMMANDS]++;
+    _boundBuffers[target] = buffer;
+}
+
+void NullRenderDevice::bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    if (data)
+        _uploadBytes += size;
+}
+
+void NullRenderDevice::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    _uploadBytes += size;
+}
+
+void NullRenderDevice::bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    if (data)
+        _uploadBytes += size;
+}
+
+/* The memory of a buffer lives until it is deleted, so persistent mappings stay valid */
+void* NullRenderDevice::mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    std::vector<unsigned char>& storage = _storage[_boundBuffers[target]];
+    if (storage.size() < static_cast<size_t>(offset + length))
+        storage.resize(offset + length);
+    return storage.data() + offset;
+}
+
+GLboolean NullRenderDevice::unmapBuffer(GLenum target)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    return GL_TRUE;
+}
+
+void NullRenderDevice::genVertexArrays(GLsizei n, GLuint* arrays)
+{
+    _generate(n, arrays);
+}
+
+void NullRenderDevice::bindVertexArray(GLuint array)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+void NullRenderDevice::enableVertexAttribArray(GLuint index)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+void NullRenderDevice::vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+void NullRenderDevice::vertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+void NullRenderDevice::drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    _counts[DRAW_COMMANDS]++;
+}
+
+void NullRenderDevice::drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    _counts[DRAW_COMMANDS]++;
+}
+
+void NullRenderDevice::drawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount,
+                                                       GLint baseVertex)
+{
+    _counts[DRAW_COMMANDS]++;
+}
+
+void NullRenderDevice::multiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride)
+{
+    _counts[DRAW_COMMANDS]++;
+}
+
+void NullRenderDevice::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    _counts[BIND_COMMANDS]++;
+}
+
+void NullRenderDevice::clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::clear(GLbitfield mask)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::enable(GLenum cap)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::depthFunc(GLenum func)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::depthMask(GLboolean flag)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::pointSize(GLfloat size)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::lineWidth(GLfloat width)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+/* Alignments and limits of a typical desktop driver */
+void NullRenderDevice::getIntegerv(GLenum pname, GLint* data)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    switch (pname) {
+        case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+        case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT:
+        case GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT:
+            *data = 256;
+            break;
+        case GL_MAX_RENDERBUFFER_SIZE:
+            *data = 16384;
+            break;
+        case GL_MAX_VIEWPORT_DIMS:
+            data[0] = data[1] = 16384;
+            break;
+        default:
+            *data = 0;
+    }
+}
+
+void NullRenderDevice::pixelStorei(GLenum pname, GLint param)
+{
+    _counts[STATE_COMMANDS]++;
+}
+
+void NullRenderDevice::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+{
+    _counts[RESOURCE_COMMANDS]++;
+}
+
+GLsync NullRenderDevice::fenceSync(GLenum condition, GLbitfield flags)
+{
+    _counts[SYNC_COMMANDS]++;
+    return reinterpret_cast<GLsync>(static_cast<uintptr_t>(_nextName++));  /* Never dereferenced */
+}
+
+GLenum NullRenderDevice::clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    _counts[SYNC_COMMANDS]++;
+    return GL_ALREADY_SIGNALED;
+}
+
+void NullRenderDevice::deleteSync(GLsync sync)
+{
+    _counts[SYNC_COMMANDS]++;
+}
+
+void NullRenderDevice::genQueries(GLsizei n, GLuint* ids)
+{
+    _generate(n, ids);
+}
+
+void NullRenderDevice::beginQuery(GLenum target, GLuint id)
+{
+    _counts[SYNC_COMMANDS]++;
+}
+
+void NullRenderDevice::endQuery(GLenum target)
+{
+    _counts[SYNC_COMMANDS]++;
+}
+
+void NullRenderDevice::getQueryObjectiv(GLuint id, GLenum pname, GLint* params)
+{
+    _counts[SYNC_COMMANDS]++;
+    *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+void NullRenderDevice::getQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params)
+{
+    _counts[SYNC_COMMANDS]++;
+    *params = 0;
+}
+
+void NullRenderDevice::_generate(GLsizei n, GLuint* names)
+{
+    _counts[RESOURCE_COMMANDS]++;
+    for (GLsizei i = 0; i < n; i++)
+        names[i] = _nextName++;
+}
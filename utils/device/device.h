@@ -0,0 +1,311 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <map>
+#include <vector>
+
+/*
+The OpenGL commands of Shader, Texture, Grid, Skybox, the geometry arena,
+the stream ring, the light and cluster buffers, the query rings and
+paintGL(), one method per GL function with the same arguments. They all go
+through getRenderDevice(), so that a frame can be submitted to something
+other than a GL context.
+
+Framebuffers, deferred shading, frame capture and posters only make sense
+with real pixels and keep calling OpenGL directly.
+*/
+class RenderDevice
+{
+public:
+    virtual ~RenderDevice() {}
+
+    /* ----- Shaders ----- */
+    virtual GLuint createShader(GLenum type) = 0;
+    virtual void shaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) = 0;
+    virtual void compileShader(GLuint shader) = 0;
+    virtual void getShaderiv(GLuint shader, GLenum pname, GLint* params) = 0;
+    virtual void getShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) = 0;
+    virtual void deleteShader(GLuint shader) = 0;
+    virtual GLuint createProgram(void) = 0;
+    virtual void attachShader(GLuint program, GLuint shader) = 0;
+    virtual void linkProgram(GLuint program) = 0;
+    virtual void getProgramiv(GLuint program, GLenum pname, GLint* params) = 0;
+    virtual void getProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) = 0;
+    virtual void useProgram(GLuint program) = 0;
+    virtual GLint getUniformLocation(GLuint program, const GLchar* name) = 0;
+    virtual void uniform1i(GLint location, GLint v0) = 0;
+    virtual void uniform1f(GLint location, GLfloat v0) = 0;
+    virtual void uniform2f(GLint location, GLfloat v0, GLfloat v1) = 0;
+    virtual void uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) = 0;
+    virtual void uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) = 0;
+    virtual void uniform2fv(GLint location, GLsizei count, const GLfloat* value) = 0;
+    virtual void uniform3fv(GLint location, GLsizei count, const GLfloat* value) = 0;
+    virtual void uniform4fv(GLint location, GLsizei count, const GLfloat* value) = 0;
+    virtual void uniform3iv(GLint location, GLsizei count, const GLint* value) = 0;
+    virtual void uniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) = 0;
+    virtual void uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) = 0;
+    virtual void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) = 0;
+
+    /* ----- Textures ----- */
+    virtual void genTextures(GLsizei n, GLuint* textures) = 0;
+    virtual void activeTexture(GLenum texture) = 0;
+    virtual void bindTexture(GLenum target, GLuint texture) = 0;
+    virtual void texParameteri(GLenum target, GLenum pname, GLint param) = 0;
+    virtual void texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format,
+                            GLenum type, const void* data) = 0;
+    virtual void generateMipmap(GLenum target) = 0;
+    virtual void texBuffer(GLenum target, GLenum internalFormat, GLuint buffer) = 0;
+    virtual void texBufferRange(GLenum target, GLenum internalFormat, GLuint buffer, GLintptr offset, GLsizeiptr size) = 0;
+
+    /* ----- Buffers and vertex arrays ----- */
+    virtual void genBuffers(GLsizei n, GLuint* buffers) = 0;
+    virtual void deleteBuffers(GLsizei n, const GLuint* buffers) = 0;
+    virtual void bindBuffer(GLenum target, GLuint buffer) = 0;
+    virtual void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) = 0;
+    virtual void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+    virtual void bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) = 0;
+    virtual void* mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) = 0;
+    virtual GLboolean unmapBuffer(GLenum target) = 0;
+    virtual void genVertexArrays(GLsizei n, GLuint* arrays) = 0;
+    virtual void bindVertexArray(GLuint array) = 0;
+    virtual void enableVertexAttribArray(GLuint index) = 0;
+    virtual void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) = 0;
+    virtual void vertexAttribDivisor(GLuint index, GLuint divisor) = 0;
+
+    /* ----- Drawing ----- */
+    virtual void drawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+    virtual void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) = 0;
+    virtual void drawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount,
+                                                 GLint baseVertex) = 0;
+    virtual void multiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride) = 0;
+
+    /* ----- Fixed-function state ----- */
+    virtual void viewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+    virtual void bindFramebuffer(GLenum target, GLuint framebuffer) = 0;
+    virtual void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) = 0;
+    virtual void clear(GLbitfield mask) = 0;
+    virtual void enable(GLenum cap) = 0;
+    virtual void depthFunc(GLenum func) = 0;
+    virtual void depthMask(GLboolean flag) = 0;
+    virtual void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) = 0;
+    virtual void pointSize(GLfloat size) = 0;
+    virtual void lineWidth(GLfloat width) = 0;
+    virtual void getIntegerv(GLenum pname, GLint* data) = 0;
+    virtual void pixelStorei(GLenum pname, GLint param) = 0;
+    virtual void readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) = 0;
+
+    /* ----- Synchronization and queries ----- */
+    virtual GLsync fenceSync(GLenum condition, GLbitfield flags) = 0;
+    virtual GLenum clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) = 0;
+    virtual void deleteSync(GLsync sync) = 0;
+    virtual void genQueries(GLsizei n, GLuint* ids) = 0;
+    virtual void beginQuery(GLenum target, GLuint id) = 0;
+    virtual void endQuery(GLenum target) = 0;
+    virtual void getQueryObjectiv(GLuint id, GLenum pname, GLint* params) = 0;
+    virtual void getQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) = 0;
+};
+
+/* Every command goes straight to the current OpenGL context */
+class GLRenderDevice : public RenderDevice
+{
+public:
+    GLuint createShader(GLenum type) override;
+    void shaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) override;
+    void compileShader(GLuint shader) override;
+    void getShaderiv(GLuint shader, GLenum pname, GLint* params) override;
+    void getShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) override;
+    void deleteShader(GLuint shader) override;
+    GLuint createProgram(void) override;
+    void attachShader(GLuint program, GLuint shader) override;
+    void linkProgram(GLuint program) override;
+    void getProgramiv(GLuint program, GLenum pname, GLint* params) override;
+    void getProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) override;
+    void useProgram(GLuint program) override;
+    GLint getUniformLocation(GLuint program, const GLchar* name) override;
+    void uniform1i(GLint location, GLint v0) override;
+    void uniform1f(GLint location, GLfloat v0) override;
+    void uniform2f(GLint location, GLfloat v0, GLfloat v1) override;
+    void uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) override;
+    void uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) override;
+    void uniform2fv(GLint location, GLsizei count, const GLfloat* value) override;
+    void uniform3fv(GLint location, GLsizei count, const GLfloat* value) override;
+    void uniform4fv(GLint location, GLsizei count, const GLfloat* value) override;
+    void uniform3iv(GLint location, GLsizei count, const GLint* value) override;
+    void uniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) override;
+    void uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) override;
+    void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) override;
+
+    void genTextures(GLsizei n, GLuint* textures) override;
+    void activeTexture(GLenum texture) override;
+    void bindTexture(GLenum target, GLuint texture) override;
+    void texParameteri(GLenum target, GLenum pname, GLint param) override;
+    void texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format,
+                    GLenum type, const void* data) override;
+    void generateMipmap(GLenum target) override;
+    void texBuffer(GLenum target, GLenum internalFormat, GLuint buffer) override;
+    void texBufferRange(GLenum target, GLenum internalFormat, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+
+    void genBuffers(GLsizei n, GLuint* buffers) override;
+    void deleteBuffers(GLsizei n, const GLuint* buffers) override;
+    void bindBuffer(GLenum target, GLuint buffer) override;
+    void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+    void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+    void bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) override;
+    void* mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) override;
+    GLboolean unmapBuffer(GLenum target) override;
+    void genVertexArrays(GLsizei n, GLuint* arrays) override;
+    void bindVertexArray(GLuint array) override;
+    void enableVertexAttribArray(GLuint index) override;
+    void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) override;
+    void vertexAttribDivisor(GLuint index, GLuint divisor) override;
+
+    void drawArrays(GLenum mode, GLint first, GLsizei count) override;
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) override;
+    void drawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount,
+                                         GLint baseVertex) override;
+    void multiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride) override;
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height) override;
+    void bindFramebuffer(GLenum target, GLuint framebuffer) override;
+    void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) override;
+    void clear(GLbitfield mask) override;
+    void enable(GLenum cap) override;
+    void depthFunc(GLenum func) override;
+    void depthMask(GLboolean flag) override;
+    void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) override;
+    void pointSize(GLfloat size) override;
+    void lineWidth(GLfloat width) override;
+    void getIntegerv(GLenum pname, GLint* data) override;
+    void pixelStorei(GLenum pname, GLint param) override;
+    void readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) override;
+
+    GLsync fenceSync(GLenum condition, GLbitfield flags) override;
+    GLenum clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) override;
+    void deleteSync(GLsync sync) override;
+    void genQueries(GLsizei n, GLuint* ids) override;
+    void beginQuery(GLenum target, GLuint id) override;
+    void endQuery(GLenum target) override;
+    void getQueryObjectiv(GLuint id, GLenum pname, GLint* params) override;
+    void getQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) override;
+};
+
+/*
+Accepts every command without a GL context and only counts it, so that the
+CPU side of a frame can be timed on its own. Objects get fresh names,
+shaders always compile, fences are always signaled and queries return 0.
+Mapped buffers are backed by memory of their own, since the callers write
+through the pointers.
+*/
+class NullRenderDevice : public RenderDevice
+{
+public:
+    enum CommandKind {
+        DRAW_COMMANDS,      /* Draw calls */
+        UNIFORM_COMMANDS,   /* glUniform* */
+        BIND_COMMANDS,      /* Programs, textures, buffers, vertex arrays and attributes bound */
+        STATE_COMMANDS,     /* Fixed-function state, clears and viewports */
+        RESOURCE_COMMANDS,  /* Objects created, deleted, filled, mapped or queried */
+        SYNC_COMMANDS,      /* Fences and queries */
+        COMMAND_KIND_COUNT,
+    };
+
+    NullRenderDevice();
+    void resetCounters(void);
+    GLuint64 getCommandCount(CommandKind kind) const;
+    GLuint64 getTotalCommandCount(void) const;
+    GLuint64 getUploadBytes(void) const;  /* Given to glBufferData, glBufferSubData and glTexImage2D */
+    static const char* getCommandKindName(CommandKind kind);
+
+    GLuint createShader(GLenum type) override;
+    void shaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) override;
+    void compileShader(GLuint shader) override;
+    void getShaderiv(GLuint shader, GLenum pname, GLint* params) override;
+    void getShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) override;
+    void deleteShader(GLuint shader) override;
+    GLuint createProgram(void) override;
+    void attachShader(GLuint program, GLuint shader) override;
+    void linkProgram(GLuint program) override;
+    void getProgramiv(GLuint program, GLenum pname, GLint* params) override;
+    void getProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) override;
+    void useProgram(GLuint program) override;
+    GLint getUniformLocation(GLuint program, const GLchar* name) override;
+    void uniform1i(GLint location, GLint v0) override;
+    void uniform1f(GLint location, GLfloat v0) override;
+    void uniform2f(GLint location, GLfloat v0, GLfloat v1) override;
+    void uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) override;
+    void uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) override;
+    void uniform2fv(GLint location, GLsizei count, const GLfloat* value) override;
+    void uniform3fv(GLint location, GLsizei count, const GLfloat* value) override;
+    void uniform4fv(GLint location, GLsizei count, const GLfloat* value) override;
+    void uniform3iv(GLint location, GLsizei count, const GLint* value) override;
+    void uniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) override;
+    void uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) override;
+    void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) override;
+
+    void genTextures(GLsizei n, GLuint* textures) override;
+    void activeTexture(GLenum texture) override;
+    void bindTexture(GLenum target, GLuint texture) override;
+    void texParameteri(GLenum target, GLenum pname, GLint param) override;
+    void texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format,
+                    GLenum type, const void* data) override;
+    void generateMipmap(GLenum target) override;
+    void texBuffer(GLenum target, GLenum internalFormat, GLuint buffer) override;
+    void texBufferRange(GLenum target, GLenum internalFormat, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+
+    void genBuffers(GLsizei n, GLuint* buffers) override;
+    void deleteBuffers(GLsizei n, const GLuint* buffers) override;
+    void bindBuffer(GLenum target, GLuint buffer) override;
+    void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+    void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+    void bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) override;
+    void* mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) override;
+    GLboolean unmapBuffer(GLenum target) override;
+    void genVertexArrays(GLsizei n, GLuint* arrays) override;
+    void bindVertexArray(GLuint array) override;
+    void enableVertexAttribArray(GLuint index) override;
+    void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) override;
+    void vertexAttribDivisor(GLuint index, GLuint divisor) override;
+
+    void drawArrays(GLenum mode, GLint first, GLsizei count) override;
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) override;
+    void drawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount,
+                                         GLint baseVertex) override;
+    void multiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride) override;
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height) override;
+    void bindFramebuffer(GLenum target, GLuint framebuffer) override;
+    void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) override;
+    void clear(GLbitfield mask) override;
+    void enable(GLenum cap) override;
+    void depthFunc(GLenum func) override;
+    void depthMask(GLboolean flag) override;
+    void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) override;
+    void pointSize(GLfloat size) override;
+    void lineWidth(GLfloat width) override;
+    void getIntegerv(GLenum pname, GLint* data) override;
+    void pixelStorei(GLenum pname, GLint param) override;
+    void readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) override;
+
+    GLsync fenceSync(GLenum condition, GLbitfield flags) override;
+    GLenum clientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) override;
+    void deleteSync(GLsync sync) override;
+    void genQueries(GLsizei n, GLuint* ids) override;
+    void beginQuery(GLenum target, GLuint id) override;
+    void endQuery(GLenum target) override;
+    void getQueryObjectiv(GLuint id, GLenum pname, GLint* params) override;
+    void getQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) override;
+
+private:
+    GLuint64 _counts[COMMAND_KIND_COUNT];
+    GLuint64 _uploadBytes;
+    GLuint _nextName;
+    std::map<GLenum, GLuint> _boundBuffers;              /* Per target */
+    std::map<GLuint, std::vector<unsigned char>> _storage;  /* Per buffer, created when first mapped */
+
+    void _generate(GLsizei n, GLuint* names);
+};
+
+/* The device every module submits to: a GLRenderDevice unless another one is set (NULL sets it back) */
+RenderDevice& getRenderDevice(void);
+void setRenderDevice(RenderDevice* device);
@@ -0,0 +1,30 @@
+#include "ecs.h"
+
+Entity Registry::createEntity(void)
+{
+    if (!_freeEntities.empty()) {
+        Entity entity = _freeEntities.back();
+        _freeEntities.pop_back();
+        return entity;
+    }
+    return _entityCount++;
+}
+
+void Registry::destroyEntity(Entity entity)
+{
+    transforms.remove(entity);
+    meshes.remove(entity);
+    materials.remove(entity);
+    bounds.remove(entity);
+    emissions.remove(entity);
+    occluders.remove(entity);
+    pointLights.remove(entity);
+    orbits.remove(entity);
+    _freeEntities.push_back(entity);
+}
+
+/* Live entities */
+GLuint Registry::getEntityCount(void) const
+{
+    return _entityCount - static_cast<GLuint>(_freeEntities.size());
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "light/light.h"
+#include "misc/misc.h"
+
+#include <vector>
+
+typedef GLuint Entity;
+const Entity NULL_ENTITY = ~0u;
+
+/*
+Components of one type packed in a dense array (sparse set). Entities map to
+dense indices through a sparse table, so lookups are O(1) while systems walk
+the dense array linearly. Removing a component moves the last one into its
+slot, which keeps the array packed but does not preserve order.
+*/
+template <typename T>
+class ComponentArray
+{
+public:
+    T& add(Entity entity, const T& component)
+    {
+        if (entity >= _indices.size())
+            _indices.resize(entity + 1, NULL_ENTITY);
+        if (_indices[entity] != NULL_ENTITY)
+            return _components[_indices[entity]] = component;
+        _indices[entity] = static_cast<GLuint>(_components.size());
+        _entities.push_back(entity);
+        _components.push_back(component);
+        return _components.back();
+    }
+
+    void remove(Entity entity)
+    {
+        if (!has(entity))
+            return;
+        GLuint index = _indices[entity];
+        _components[index] = _components.back();
+        _entities[index] = _entities.back();
+        _indices[_entities[index]] = index;
+        _components.pop_back();
+        _entities.pop_back();
+        _indices[entity] = NULL_ENTITY;
+    }
+
+    bool has(Entity entity) const
+    {
+        return entity < _indices.size() && _indices[entity] != NULL_ENTITY;
+    }
+
+    T& get(Entity entity) { return _components[_indices[entity]]; }
+    const T& get(Entity entity) const { return _components[_indices[entity]]; }
+
+    /* Dense access, for systems */
+    size_t size(void) const { return _components.size(); }
+    T& operator[](size_t index) { return _components[index]; }
+    const T& operator[](size_t index) const { return _components[index]; }
+    Entity getEntity(size_t index) const { return _entities[index]; }
+    const std::vector<T>& getComponents(void) const { return _components; }
+
+private:
+    std::vector<T> _components;
+    std::vector<Entity> _entities;  /* Owner of each component */
+    std::vector<GLuint> _indices;   /* Dense index of each entity, or NULL_ENTITY */
+};
+
+/* ----- Components ----- */
+struct TransformComponent {
+    GLuint node;  /* Handle in the transform hierarchy */
+};
+
+struct MeshComponent {
+    GLuint meshID;  /* Index of a loaded mesh */
+};
+
+struct MaterialComponent {
+    GLuint materialID;  /* Index of a loaded material */
+};
+
+struct EmissionComponent {
+    glm::vec3 emissionK;
+};
+
+struct OccluderComponent {
+    GLuint meshID;  /* Mesh rasterized into the occlusion depth buffer */
+};
+
+/* Circles around the y-axis, moving the entity's point light, or its spot light aimed at the origin */
+struct OrbitComponent {
+    GLfloat radius, height, angle, speed;
+};
+/* ---------------------- */
+
+/*
+Entities are plain ids; their data lives in one ComponentArray per component
+type. Ids of destroyed entities are reused.
+*/
+class Registry
+{
+public:
+    ComponentArray<TransformComponent> transforms;
+    ComponentArray<MeshComponent> meshes;
+    ComponentArray<MaterialComponent> materials;
+    ComponentArray<Bounds> bounds;  /* In model space */
+    ComponentArray<EmissionComponent> emissions;
+    ComponentArray<OccluderComponent> occluders;
+    ComponentArray<PointLight> pointLights;
+    ComponentArray<SpotLight> spotLights;
+    ComponentArray<OrbitComponent> orbits;
+
+    Entity createEntity(void);
+    void destroyEntity(Entity entity);
+    GLuint getEntityCount(void) const;
+
+private:
+    GLuint _entityCount = 0;
+    std::vector<Entity> _freeEntities;
+};
@@ -0,0 +1,108 @@
+#include "framebuffer.h"
+
+#include "misc/misc.h"
+
+#include <fstream>
+#include <iostream>
+
+void Framebuffer::setupFramebuffer(GLint width, GLint height, GLint samples)
+{
+    GLint maxSize = 0, maxSamples = 0;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    if (width <= 0 || height <= 0 || width > maxSize || height > maxSize) {
+        std::cerr << "ERR: Framebuffer of " << width << "x" << height << " exceeds the limit of " << maxSize << "x" << maxSize << std::endl;
+        exit(1);
+    }
+
+    _width = width;
+    _height = height;
+    _samples = samples > 1 ? MIN(samples, maxSamples) : 0;
+    _resolveFBOID = _resolveColorID = 0;
+
+    glGenFramebuffers(1, &_fboID);
+    glGenRenderbuffers(1, &_colorID);
+    glGenRenderbuffers(1, &_depthID);
+    _createAttachments(_fboID, _colorID, _depthID, _samples);
+    if (_samples) {
+        glGenFramebuffers(1, &_resolveFBOID);
+        glGenRenderbuffers(1, &_resolveColorID);
+        _createAttachments(_resolveFBOID, _resolveColorID, 0, 0);
+    }
+}
+
+void Framebuffer::bind(void) const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _fboID);
+}
+
+void Framebuffer::resolve(void) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fboID);
+    if (!_samples)
+        return;
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _resolveFBOID);
+    glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _resolveFBOID);
+}
+
+/* Synchronous: waits until the frame is rendered */
+void Framebuffer::readPixels(std::vector<unsigned char>& rgb) const
+{
+    rgb.resize(static_cast<size_t>(_width) * _height * 3);
+    resolve();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, _width, _height, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+GLuint Framebuffer::getID(void) const
+{
+    return _fboID;
+}
+
+GLint Framebuffer::getWidth(void) const
+{
+    return _width;
+}
+
+GLint Framebuffer::getHeight(void) const
+{
+    return _height;
+}
+
+void Framebuffer::_createAttachments(GLuint fboID, GLuint colorID, GLuint depthID, GLint samples) const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorID);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, _width, _height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorID);
+    if (depthID) {
+        glBindRenderbuffer(GL_RENDERBUFFER, depthID);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, _width, _height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthID);
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERR: Failed to create " << _width << "x" << _height << " framebuffer" << std::endl;
+        exit(1);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLboolean writePPM(const std::string& path, GLint width, GLint height, const unsigned char* rgb)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERR: Failed to open " << path << std::endl;
+        return GL_FALSE;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (GLint y = height - 1; y >= 0; y--)
+        file.write(reinterpret_cast<const char*>(rgb + static_cast<size_t>(y) * width * 3), width * 3);
+    return file.good() ? GL_TRUE : GL_FALSE;
+}
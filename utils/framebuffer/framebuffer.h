@@ -0,0 +1,36 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <string>
+#include <vector>
+
+/*
+Offscreen render target of any size up to GL_MAX_RENDERBUFFER_SIZE: an RGBA8
+color and a depth-stencil renderbuffer, multisampled when samples > 1. It
+stands in for the default framebuffer when there is no window.
+
+A multisampled target is read through resolve(), which blits it into a
+single-sampled copy and leaves that copy bound as GL_READ_FRAMEBUFFER.
+*/
+class Framebuffer
+{
+public:
+    void setupFramebuffer(GLint width, GLint height, GLint samples);
+    void bind(void) const;
+    void resolve(void) const;
+    void readPixels(std::vector<unsigned char>& rgb) const;  /* Bottom row first, as OpenGL stores it */
+    GLuint getID(void) const;
+    GLint getWidth(void) const;
+    GLint getHeight(void) const;
+
+private:
+    GLuint _fboID, _colorID, _depthID;
+    GLuint _resolveFBOID, _resolveColorID;  /* Only when multisampled */
+    GLint _width, _height, _samples;
+
+    void _createAttachments(GLuint fboID, GLuint colorID, GLuint depthID, GLint samples) const;
+};
+
+/* Binary PPM of rows stored bottom row first (e.g. from glReadPixels) */
+GLboolean writePPM(const std::string& path, GLint width, GLint height, const unsigned char* rgb);
@@ -2,6 +2,7 @@
 
 #include "glm/gtc/matrix_transform.hpp"
 
+#include "device/device.h"
 #include "misc/misc.h"
 
 #include <iostream>
@@ -95,26 +96,26 @@ void Grid::sendGridsToOpenGL(void)
 
 void Grid::_sendGrid(GLuint gridID, GLuint* vboID, GLuint* eboID, const GLfloat* data, GLint dataSize, const GLuint* indices, GLint indexSize)
 {
-    glGenVertexArrays(1, &_gridInfo[gridID].vaoID);
-    glBindVertexArray(_gridInfo[gridID].vaoID);
+    getRenderDevice().genVertexArrays(1, &_gridInfo[gridID].vaoID);
+    getRenderDevice().bindVertexArray(_gridInfo[gridID].vaoID);
     
-    glGenBuffers(1, vboID);
-    glBindBuffer(GL_ARRAY_BUFFER, *vboID);
-    glBufferData(GL_ARRAY_BUFFER, dataSize, data, GL_STATIC_DRAW);
+    getRenderDevice().genBuffers(1, vboID);
+    getRenderDevice().bindBuffer(GL_ARRAY_BUFFER, *vboID);
+    getRenderDevice().bufferData(GL_ARRAY_BUFFER, dataSize, data, GL_STATIC_DRAW);
     
-    glGenBuffers(1, eboID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *eboID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indices, GL_STATIC_DRAW);
+    getRenderDevice().genBuffers(1, eboID);
+    getRenderDevice().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, *eboID);
+    getRenderDevice().bufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indices, GL_STATIC_DRAW);
     
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+    getRenderDevice().enableVertexAttribArray(0);
+    getRenderDevice().vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
+    getRenderDevice().enableVertexAttribArray(1);
+    getRenderDevice().vertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
     
     _gridInfo[gridID].vertexCount = indexSize / sizeof(GLuint);
 }
 
-void Grid::draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, Camera camera)
+void Grid::draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, glm::vec3 cameraPos)
 {
     _gridShader.use();
     _gridShader.setMat4("viewMatrix", viewMatrix);
@@ -123,35 +124,35 @@ void Grid::draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, Camera camera)
     glm::mat4 modelMatrix;
     
     /* Origin */
-    glBindVertexArray(_gridInfo[_GRID_ORIGIN].vaoID);
+    getRenderDevice().bindVertexArray(_gridInfo[_GRID_ORIGIN].vaoID);
     modelMatrix = glm::mat4(1.0f);
     _gridShader.setMat4("modelMatrix", modelMatrix);
-    glDrawElements(GL_POINTS, _gridInfo[_GRID_ORIGIN].vertexCount, GL_UNSIGNED_INT, 0);
+    getRenderDevice().drawElements(GL_POINTS, _gridInfo[_GRID_ORIGIN].vertexCount, GL_UNSIGNED_INT, 0);
     
     /* x-axis */
-    glBindVertexArray(_gridInfo[_GRID_X_AXIS].vaoID);
-    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(glm::max(camera.getPos().x, _far), 1.0f, 0.0f));
+    getRenderDevice().bindVertexArray(_gridInfo[_GRID_X_AXIS].vaoID);
+    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(glm::max(cameraPos.x, _far), 1.0f, 0.0f));
     modelMatrix = glm::scale(modelMatrix, glm::vec3(_far, 1.0f, 1.0f));
     _gridShader.setMat4("modelMatrix", modelMatrix);
-    glDrawElements(GL_LINES, _gridInfo[_GRID_X_AXIS].vertexCount, GL_UNSIGNED_INT, 0);
+    getRenderDevice().drawElements(GL_LINES, _gridInfo[_GRID_X_AXIS].vertexCount, GL_UNSIGNED_INT, 0);
     
     /* y-axis */
-    glBindVertexArray(_gridInfo[_GRID_Y_AXIS].vaoID);
-    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, glm::max(camera.getPos().y, _far), 0.0f));
+    getRenderDevice().bindVertexArray(_gridInfo[_GRID_Y_AXIS].vaoID);
+    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, glm::max(cameraPos.y, _far), 0.0f));
     modelMatrix = glm::scale(modelMatrix, glm::vec3(1.0f, _far, 1.0f));
     _gridShader.setMat4("modelMatrix", modelMatrix);
-    glDrawElements(GL_LINES, _gridInfo[_GRID_Y_AXIS].vertexCount, GL_UNSIGNED_INT, 0);
+    getRenderDevice().drawElements(GL_LINES, _gridInfo[_GRID_Y_AXIS].vertexCount, GL_UNSIGNED_INT, 0);
     
     /* z-axis */
-    glBindVertexArray(_gridInfo[_GRID_Z_AXIS].vaoID);
-    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, glm::max(camera.getPos().z, _far)));
+    getRenderDevice().bindVertexArray(_gridInfo[_GRID_Z_AXIS].vaoID);
+    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, glm::max(cameraPos.z, _far)));
     modelMatrix = glm::scale(modelMatrix, glm::vec3(1.0f, 1.0f, _far));
     _gridShader.setMat4("modelMatrix", modelMatrix);
-    glDrawElements(GL_LINES, _gridInfo[_GRID_Z_AXIS].vertexCount, GL_UNSIGNED_INT, 0);
+    getRenderDevice().drawElements(GL_LINES, _gridInfo[_GRID_Z_AXIS].vertexCount, GL_UNSIGNED_INT, 0);
     
     /* Squares */
-    glBindVertexArray(_gridInfo[_GRID_SQUARE].vaoID);
-    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(round(camera.getPos().x) - _far, 0.0f, round(camera.getPos().z) - _far));
+    getRenderDevice().bindVertexArray(_gridInfo[_GRID_SQUARE].vaoID);
+    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(round(cameraPos.x) - _far, 0.0f, round(cameraPos.z) - _far));
     _gridShader.setMat4("modelMatrix", modelMatrix);
-    glDrawElements(GL_LINES, _gridInfo[_GRID_SQUARE].vertexCount, GL_UNSIGNED_INT, 0);
+    getRenderDevice().drawElements(GL_LINES, _gridInfo[_GRID_SQUARE].vertexCount, GL_UNSIGNED_INT, 0);
 }
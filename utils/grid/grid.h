@@ -3,7 +3,6 @@
 #include "GL/glew.h"
 #include "glm/glm.hpp"
 
-#include "camera/camera.h"
 #include "shader/shader.h"
 
 class Grid
@@ -12,7 +11,7 @@ public:
     ~Grid(void);
     void setupGrid(const char* vertexPath, const char* fragmentPath, GLfloat far);
     void sendGridsToOpenGL(void);
-    void draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, Camera camera);
+    void draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, glm::vec3 cameraPos);
 
 private:
     enum _Component {
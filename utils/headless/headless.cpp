@@ -0,0 +1,126 @@
+#include "headless.h"
+
+#include <iostream>
+
+#if defined(__APPLE__)
+#include <OpenGL/OpenGL.h>
+#elif defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#if defined(__APPLE__)
+GLboolean HeadlessContext::setupHeadlessContext(GLint majorVersion, GLint minorVersion)
+{
+    /* CGL only asks for "3.2 core or later" and returns the newest version it supports */
+    CGLPixelFormatAttribute attributes[] = {
+        kCGLPFAOpenGLProfile, static_cast<CGLPixelFormatAttribute>(kCGLOGLPVersion_3_2_Core),
+        kCGLPFAAllowOfflineRenderers,
+        static_cast<CGLPixelFormatAttribute>(0),
+    };
+    CGLPixelFormatObj pixelFormat = NULL;
+    GLint formatCount = 0;
+    CGLContextObj context = NULL;
+
+    _display = NULL;
+    _context = NULL;
+    if (CGLChoosePixelFormat(attributes, &pixelFormat, &formatCount) != kCGLNoError || !pixelFormat) {
+        std::cerr << "ERR: Failed to find a CGL pixel format for OpenGL " << majorVersion << "." << minorVersion << std::endl;
+        return GL_FALSE;
+    }
+    CGLError error = CGLCreateContext(pixelFormat, NULL, &context);
+    CGLDestroyPixelFormat(pixelFormat);
+    if (error != kCGLNoError) {
+        std::cerr << "ERR: Failed to create CGL context (" << CGLErrorString(error) << ")" << std::endl;
+        return GL_FALSE;
+    }
+    _context = context;
+    return GL_TRUE;
+}
+
+void HeadlessContext::makeCurrent(void) const
+{
+    CGLSetCurrentContext(static_cast<CGLContextObj>(_context));
+}
+
+void HeadlessContext::releaseCurrent(void) const
+{
+    CGLSetCurrentContext(NULL);
+}
+
+#elif defined(__linux__)
+GLboolean HeadlessContext::setupHeadlessContext(GLint majorVersion, GLint minorVersion)
+{
+    _display = NULL;
+    _context = NULL;
+
+    /* Mesa's surfaceless platform needs neither X11 nor a GPU; other drivers get the default display */
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        std::cerr << "ERR: Failed to initialize EGL" << std::endl;
+        return GL_FALSE;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "ERR: EGL does not support desktop OpenGL" << std::endl;
+        return GL_FALSE;
+    }
+
+    /* The default surface type is a window, which surfaceless displays have none of */
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "ERR: Failed to find an EGL config" << std::endl;
+        return GL_FALSE;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "ERR: Failed to create EGL context for OpenGL " << majorVersion << "." << minorVersion << std::endl;
+        return GL_FALSE;
+    }
+
+    _display = display;
+    _context = context;
+    return GL_TRUE;
+}
+
+/* No surface: needs EGL_KHR_surfaceless_context, which Mesa always has */
+void HeadlessContext::makeCurrent(void) const
+{
+    eglMakeCurrent(static_cast<EGLDisplay>(_display), EGL_NO_SURFACE, EGL_NO_SURFACE, static_cast<EGLContext>(_context));
+}
+
+void HeadlessContext::releaseCurrent(void) const
+{
+    eglMakeCurrent(static_cast<EGLDisplay>(_display), EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+#else
+GLboolean HeadlessContext::setupHeadlessContext(GLint majorVersion, GLint minorVersion)
+{
+    _display = NULL;
+    _context = NULL;
+    std::cerr << "ERR: Headless OpenGL " << majorVersion << "." << minorVersion << " is not supported on this platform" << std::endl;
+    return GL_FALSE;
+}
+
+void HeadlessContext::makeCurrent(void) const
+{
+}
+
+void HeadlessContext::releaseCurrent(void) const
+{
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "GL/glew.h"
+
+/*
+OpenGL context without a window or display server, for batch rendering on
+machines without a GPU (e.g. Mesa llvmpipe). On Linux it is a surfaceless
+EGL context, on macOS an offscreen CGL context. Either way there is no
+default framebuffer to draw into: render into a Framebuffer instead.
+
+Like a GLFW window's context, it is current on one thread at a time.
+*/
+class HeadlessContext
+{
+public:
+    GLboolean setupHeadlessContext(GLint majorVersion, GLint minorVersion);
+    void makeCurrent(void) const;
+    void releaseCurrent(void) const;
+
+private:
+    void* _display;  /* EGLDisplay (unused by CGL) */
+    void* _context;  /* EGLContext or CGLContextObj */
+};
@@ -0,0 +1,48 @@
+#include "instance.h"
+
+#include "device/device.h"
+
+#include <cstddef>
+#include <cstring>
+
+void InstanceBuffer::setupInstanceBuffer(void)
+{
+    _bufferID = 0;
+    _offset = 0;
+    _instanceCount = 0;
+}
+
+void InstanceBuffer::attach(GLuint vaoID, GLuint firstInstance) const
+{
+    const size_t base = _offset + firstInstance * sizeof(InstanceData);
+
+    getRenderDevice().bindVertexArray(vaoID);
+    getRenderDevice().bindBuffer(GL_ARRAY_BUFFER, _bufferID);
+    for (GLuint column = 0; column < 4; column++) {
+        getRenderDevice().enableVertexAttribArray(FIRST_LOCATION + column);
+        getRenderDevice().vertexAttribPointer(FIRST_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4)));
+        getRenderDevice().vertexAttribDivisor(FIRST_LOCATION + column, 1);
+    }
+    getRenderDevice().enableVertexAttribArray(FIRST_LOCATION + 4);
+    getRenderDevice().vertexAttribPointer(FIRST_LOCATION + 4, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, emissionK)));
+    getRenderDevice().vertexAttribDivisor(FIRST_LOCATION + 4, 1);
+}
+
+/* Attach again afterwards: the instances move to another part of the ring every frame */
+void InstanceBuffer::upload(const std::vector<InstanceData>& instances, StreamRing& ring)
+{
+    _instanceCount = static_cast<GLsizei>(instances.size());
+    if (instances.empty())
+        return;
+
+    RingAllocation allocation = ring.allocate(static_cast<GLsizeiptr>(instances.size() * sizeof(InstanceData)), 16);
+    memcpy(allocation.data, instances.data(), allocation.size);
+    _bufferID = allocation.bufferID;
+    _offset = allocation.offset;
+}
+
+GLsizei InstanceBuffer::getInstanceCount(void) const
+{
+    return _instanceCount;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "ring/ring.h"
+
+#include <vector>
+
+/* Per-instance data, read by texture.vs and depth.vs as vertex attributes */
+struct InstanceData {
+    glm::mat4 modelMatrix;
+    glm::vec3 emissionK;
+};
+
+/*
+InstanceData for instanced drawing, streamed through a StreamRing every
+frame. attach() wires the last upload into a VAO (and leaves that VAO bound)
+at locations FIRST_LOCATION.. (4 for the model matrix columns, 1 for the
+emission) with an attribute divisor of 1, so all instances are drawn with a
+single glDrawElementsInstanced. Attaching again with another firstInstance
+stands in for a base instance on OpenGL versions without one.
+*/
+class InstanceBuffer
+{
+public:
+    static const GLuint FIRST_LOCATION = 3;
+
+    void setupInstanceBuffer(void);
+    void attach(GLuint vaoID, GLuint firstInstance) const;
+    void upload(const std::vector<InstanceData>& instances, StreamRing& ring);
+    GLsizei getInstanceCount(void) const;
+
+private:
+    GLuint _bufferID;
+    GLintptr _offset;
+    GLsizei _instanceCount;
+};
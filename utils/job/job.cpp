@@ -0,0 +1,124 @@
+#include "job.h"
+
+#include "alloc/alloc.h"
+#include "misc/misc.h"
+
+/* Joining is all there is to do; no OpenGL is involved */
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (std::thread& worker : _workers)
+        worker.join();
+}
+
+void JobSystem::setupJobSystem(GLuint threadCount)
+{
+    threadCount = MAX(threadCount, 1u);
+    for (GLuint i = 0; i < threadCount; i++)
+        _queues.emplace_back(new _Queue);
+    for (GLuint i = 1; i < threadCount; i++)
+        _workers.emplace_back(&JobSystem::_workerLoop, this, i);
+}
+
+/* Call job(begin, end) on sub-ranges of [0, count) of about grainSize indices, in parallel */
+void JobSystem::parallelFor(GLuint count, GLuint grainSize, const Job& job)
+{
+    if (count == 0)
+        return;
+    grainSize = MAX(grainSize, 1u);
+    if (_workers.empty() || count <= grainSize) {
+        job(0, count);
+        return;
+    }
+
+    const GLuint threadCount = getThreadCount();
+    const GLuint taskCount = (count + grainSize - 1) / grainSize;
+    std::atomic<GLuint> pending(taskCount);
+    for (GLuint i = 0; i < taskCount; i++) {
+        _Queue& queue = *_queues[i % threadCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pushBack({&job, i * grainSize, MIN((i + 1) * grainSize, count), &pending});
+    }
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _queuedTasks += taskCount;
+    }
+    _wake.notify_all();
+
+    while (pending.load(std::memory_order_acquire) > 0)
+        if (!_runTask(0))
+            std::this_thread::yield();  /* The last tasks are running elsewhere */
+}
+
+GLuint JobSystem::getThreadCount(void) const
+{
+    return static_cast<GLuint>(_queues.size());
+}
+
+/* Run one task from our own queue, or else stolen from another one; return false when all are empty */
+bool JobSystem::_runTask(GLuint threadIndex)
+{
+    _Task task;
+    bool found = false;
+    const GLuint threadCount = getThreadCount();
+    for (GLuint i = 0; i < threadCount && !found; i++) {
+        _Queue& queue = *_queues[(threadIndex + i) % threadCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.count == 0)
+            continue;
+        if (i == 0)  /* Own queue: newest first, its data is likely still in cache */
+            task = queue.popBack();
+        else  /* Steal the oldest */
+            task = queue.popFront();
+        found = true;
+    }
+    if (!found)
+        return false;
+
+    _queuedTasks--;
+    (*task.job)(task.begin, task.end);
+    task.pending->fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::_workerLoop(GLuint threadIndex)
+{
+    countFrameAllocations();  /* Jobs run for the frames of the calling thread */
+    while (true) {
+        if (_runTask(threadIndex))
+            continue;
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _wake.wait(lock, [this] { return _quit || _queuedTasks > 0; });
+        if (_quit)
+            return;
+    }
+}
+
+void JobSystem::_Queue::pushBack(const _Task& task)
+{
+    if (count == tasks.size()) {
+        std::vector<_Task> grown(MAX(2 * tasks.size(), static_cast<size_t>(64)));
+        for (size_t i = 0; i < count; i++)
+            grown[i] = tasks[(first + i) & (tasks.size() - 1)];
+        tasks.swap(grown);
+        first = 0;
+    }
+    tasks[(first + count++) & (tasks.size() - 1)] = task;
+}
+
+JobSystem::_Task JobSystem::_Queue::popBack(void)
+{
+    return tasks[(first + --count) & (tasks.size() - 1)];
+}
+
+JobSystem::_Task JobSystem::_Queue::popFront(void)
+{
+    _Task task = tasks[first];
+    first = (first + 1) & (tasks.size() - 1);
+    count--;
+    return task;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Work-stealing job system for the per-frame CPU work.
+
+parallelFor() splits an index range into jobs and deals them out to one
+queue per thread. Each worker takes jobs from the back of its own queue and,
+when it runs dry, steals from the front of the others. The calling thread
+works on its queue too until every job of the range is done, so the call
+returns with all results written.
+
+Only one thread (the GL thread) may call parallelFor(), and jobs must not
+call it themselves.
+*/
+class JobSystem
+{
+public:
+    typedef std::function<void(GLuint begin, GLuint end)> Job;
+
+    ~JobSystem();
+    void setupJobSystem(GLuint threadCount);  /* Including the calling thread */
+    void parallelFor(GLuint count, GLuint grainSize, const Job& job);
+    GLuint getThreadCount(void) const;
+
+private:
+    struct _Task {
+        const Job* job;
+        GLuint begin, end;
+        std::atomic<GLuint>* pending;
+    };
+    /* Ring of tasks that only grows, so that queuing stops allocating once it is large enough */
+    struct _Queue {
+        std::mutex mutex;
+        std::vector<_Task> tasks;  /* Power-of-two size */
+        size_t first = 0, count = 0;
+
+        void pushBack(const _Task& task);
+        _Task popBack(void);
+        _Task popFront(void);
+    };
+
+    std::vector<std::unique_ptr<_Queue>> _queues;  /* Queue 0 belongs to the calling thread */
+    std::vector<std::thread> _workers;
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<GLuint> _queuedTasks{0};
+    bool _quit = false;
+
+    bool _runTask(GLuint threadIndex);
+    void _workerLoop(GLuint threadIndex);
+};
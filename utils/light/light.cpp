@@ -0,0 +1,84 @@
+#include "light.h"
+
+#include "device/device.h"
+#include "misc/misc.h"
+
+/*
+Distance at which a light's contribution drops below "cutoff", i.e. the root of
+    intensity * (diffuseK + specularK) / (a + b * d + c * d^2) = cutoff
+Material colors are at most 1, so no fragment beyond it gets more than "cutoff".
+*/
+GLfloat calLightRadius(const Light& light, const Attenuation& attenuation, GLfloat cutoff)
+{
+    glm::vec3 peak = light.intensity * (light.diffuseK + light.specularK);
+    GLfloat k = MAX(MAX(peak.x, peak.y), peak.z) / cutoff - attenuation.a;
+    if (k <= 0.0f)
+        return 0.0f;
+    if (attenuation.c > 0.0f)
+        return (-attenuation.b + glm::sqrt(attenuation.b * attenuation.b + 4.0f * attenuation.c * k)) / (2.0f * attenuation.c);
+    if (attenuation.b > 0.0f)
+        return k / attenuation.b;
+    return 1e+6f;  /* No falloff */
+}
+
+void LightBuffer::setupLightBuffer(StreamRing* ring)
+{
+    _ring = ring;
+    _capacity = 0;
+    _lightCount = 0;
+    getRenderDevice().genBuffers(1, &_bufferID);
+    getRenderDevice().genTextures(1, &_textureID);
+}
+
+void LightBuffer::upload(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights)
+{
+    _lightCount = static_cast<GLuint>(spotLights.size() + pointLights.size());
+    _texels.resize(MAX(_lightCount, 1u) * LIGHT_TEXELS);
+
+    glm::vec4* texel = _texels.data();
+    for (const SpotLight& l : spotLights) {
+        *texel++ = glm::vec4(l.pos, l.outerCutOff);
+        *texel++ = glm::vec4(l.light.diffuseK, l.attenuation.a);
+        *texel++ = glm::vec4(l.light.specularK, l.attenuation.b);
+        *texel++ = glm::vec4(l.light.intensity, l.attenuation.c);
+        *texel++ = glm::vec4(glm::normalize(l.dir), l.cutOff);
+    }
+    for (const PointLight& l : pointLights) {
+        /* cos(theta) >= -1 > outerCutOff, so the cone factor clamps to 1 */
+        *texel++ = glm::vec4(l.pos, -2.0f);
+        *texel++ = glm::vec4(l.light.diffuseK, l.attenuation.a);
+        *texel++ = glm::vec4(l.light.specularK, l.attenuation.b);
+        *texel++ = glm::vec4(l.light.intensity, l.attenuation.c);
+        *texel++ = glm::vec4(0.0f, 0.0f, -1.0f, -1.0f);
+    }
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(_texels.size() * sizeof(glm::vec4));
+    if (_ring && _ring->uploadTextureBuffer(_textureID, GL_RGBA32F, _texels.data(), size))
+        return;
+
+    getRenderDevice().bindBuffer(GL_TEXTURE_BUFFER, _bufferID);
+    if (size > _capacity) {
+        getRenderDevice().bufferData(GL_TEXTURE_BUFFER, size, _texels.data(), GL_STREAM_DRAW);
+        _capacity = size;
+        getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, _textureID);
+        getRenderDevice().texBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _bufferID);
+        getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else {
+        getRenderDevice().bufferData(GL_TEXTURE_BUFFER, _capacity, NULL, GL_STREAM_DRAW);  /* Orphan the old storage */
+        getRenderDevice().bufferSubData(GL_TEXTURE_BUFFER, 0, size, _texels.data());
+    }
+    getRenderDevice().bindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightBuffer::bind(unsigned int slot) const
+{
+    getRenderDevice().activeTexture(GL_TEXTURE0 + slot);
+    getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, _textureID);
+}
+
+/* Number of lights uploaded, spot lights first, then point lights */
+GLuint LightBuffer::getLightCount(void) const
+{
+    return _lightCount;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "ring/ring.h"
+
+#include <vector>
+
+/* Light structs mirror the ones in texture.fs */
+struct Light {
+    glm::vec3 diffuseK;
+    glm::vec3 specularK;
+    glm::vec3 intensity;
+};
+
+struct Attenuation {
+    GLfloat a;
+    GLfloat b;
+    GLfloat c;
+};
+
+struct PointLight {
+    Light light;
+    glm::vec3 pos;
+    Attenuation attenuation;
+};
+
+struct DirLight {
+    Light light;
+    glm::vec3 dir;
+};
+
+struct SpotLight {
+    Light light;
+    glm::vec3 pos;
+    glm::vec3 dir;
+    GLfloat cutOff;
+    GLfloat outerCutOff;
+    Attenuation attenuation;
+};
+
+/* Contribution (in [0, 1] color units) below which a light is considered out of range */
+#define LIGHT_CUTOFF (1.0f / 256.0f)
+
+GLfloat calLightRadius(const Light& light, const Attenuation& attenuation, GLfloat cutoff = LIGHT_CUTOFF);
+
+/*
+Texture buffer holding point and spot lights for the clustered and deferred
+paths. Each light takes LIGHT_TEXELS RGBA32F texels:
+    (pos, outerCutOff), (diffuseK, a), (specularK, b), (intensity, c), (dir, cutOff)
+Spot lights come first, then point lights stored as spot lights whose cone
+covers the whole sphere, so shaders can treat every light as a spot light.
+The texels are streamed through the StreamRing given to setupLightBuffer()
+when glTexBufferRange is available, and re-specify the buffer otherwise.
+*/
+class LightBuffer
+{
+public:
+    static const GLuint LIGHT_TEXELS = 5;
+
+    void setupLightBuffer(StreamRing* ring);
+    void upload(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights);
+    void bind(unsigned int slot) const;
+    GLuint getLightCount(void) const;
+
+private:
+    GLuint _bufferID, _textureID;
+    GLsizeiptr _capacity;
+    GLuint _lightCount;
+    std::vector<glm::vec4> _texels;
+    StreamRing* _ring;
+};
@@ -0,0 +1,71 @@
+#include "material.h"
+
+/* Pass NULL for a missing map: diffuse defaults to white, specular to black and normal to flat */
+void Material::setupMaterial(const char* diffusePath, const char* specularPath, const char* normalPath, GLfloat shininess)
+{
+    if (diffusePath)
+        _diffuse.setupTexture(diffusePath);
+    else
+        _diffuse.setupTextureColor(glm::vec4(1.0f));
+
+    if (specularPath)
+        _specular.setupTexture(specularPath);
+    else
+        _specular.setupTextureColor(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    if (normalPath)
+        _normal.setupTexture(normalPath);
+    else
+        _normal.setupTextureColor(glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
+
+    _shininess = shininess;
+
+    _permutation = 0;
+    if (_diffuse.isConstant())
+        _permutation |= CONST_DIFFUSE;
+    if (_specular.isConstant())
+        _permutation |= CONST_SPECULAR;
+    /* A constant (0.5, 0.5, 1.0) normal map does not perturb the geometric normal */
+    if (_normal.isConstant()) {
+        glm::vec3 delta = glm::abs(glm::vec3(_normal.getConstantColor()) - glm::vec3(0.5f, 0.5f, 1.0f));
+        if (glm::max(glm::max(delta.x, delta.y), delta.z) <= 1.0f / 255.0f)
+            _permutation |= FLAT_NORMAL;
+    }
+}
+
+/* Bind the textures (or set the replacing uniforms) used by the material's permutation */
+void Material::bind(const Shader& shader) const
+{
+    if (_permutation & CONST_DIFFUSE)
+        shader.setVec3("material.diffuseColor", glm::vec3(_diffuse.getConstantColor()));
+    else
+        _diffuse.bind(0);
+
+    if (_permutation & CONST_SPECULAR)
+        shader.setVec3("material.specularColor", glm::vec3(_specular.getConstantColor()));
+    else
+        _specular.bind(1);
+
+    if (!(_permutation & FLAT_NORMAL))
+        _normal.bind(2);
+
+    shader.setFloat("material.shininess", _shininess);
+}
+
+GLuint Material::getPermutation(void) const
+{
+    return _permutation;
+}
+
+/* Preprocessor lines selecting a permutation of texture.fs */
+std::string Material::getDefines(GLuint permutation)
+{
+    std::string defines;
+    if (permutation & CONST_DIFFUSE)
+        defines += "#define CONST_DIFFUSE\n";
+    if (permutation & CONST_SPECULAR)
+        defines += "#define CONST_SPECULAR\n";
+    if (permutation & FLAT_NORMAL)
+        defines += "#define FLAT_NORMAL\n";
+    return defines;
+}
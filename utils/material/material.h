@@ -0,0 +1,36 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "shader/shader.h"
+#include "texture/texture.h"
+
+#include <string>
+
+/*
+Diffuse/specular/normal maps of an object. Maps that are missing or hold a
+single color are detected at load time and replaced by uniforms, which selects
+a cheaper permutation of texture.fs.
+*/
+class Material
+{
+public:
+    /* Bits of a shader permutation */
+    enum Feature {
+        CONST_DIFFUSE  = 1 << 0,
+        CONST_SPECULAR = 1 << 1,
+        FLAT_NORMAL    = 1 << 2,
+    };
+    static const GLuint PERMUTATION_COUNT = 1 << 3;
+
+    void setupMaterial(const char* diffusePath, const char* specularPath, const char* normalPath, GLfloat shininess);
+    void bind(const Shader& shader) const;
+    GLuint getPermutation(void) const;
+    static std::string getDefines(GLuint permutation);
+
+private:
+    Texture _diffuse, _specular, _normal;
+    GLuint _permutation;
+    GLfloat _shininess;
+};
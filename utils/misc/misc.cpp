@@ -2,6 +2,8 @@
 
 #include "GL/glew.h"
 
+#include "profiler/profiler.h"
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -37,9 +39,10 @@ double randreal(double a, double b)
     return dis(gen);
 }
 
-/* Load OBJ file (cannot load all OBJ files) */
-Model loadOBJ(const char* objPath)
+/* Load OBJ file (cannot load all OBJ files); on a missing or malformed file tell why and return false */
+bool loadOBJ(const char* objPath, Model& model)
 {
+	PROFILE_SCOPE("loadOBJ");
 	struct V {
 		/* Struct for identify if a vertex has showed up */
 		unsigned int index_position, index_uv, index_normal;
@@ -59,7 +62,7 @@ Model loadOBJ(const char* objPath)
 
 	std::map<V, unsigned int> temp_vertices;
 
-	Model model;
+	model = Model();
 	unsigned int num_vertices = 0;
 
 	std::cout << "INF: Loading OBJ " << objPath << "..." << std::endl;
@@ -69,7 +72,7 @@ Model loadOBJ(const char* objPath)
 	/* Check for error */
 	if (file.fail()) {
 		std::cerr << "ERR: Failed to load " << objPath << std::endl;
-		exit(1);
+		return false;
 	}
     
     for (std::string line; std::getline(file, line); ) {
@@ -82,29 +85,29 @@ Model loadOBJ(const char* objPath)
 		/* Process the OBJ file */
 		const char *lineHeader=line_vec[0].c_str();
 
-		if (strcmp(lineHeader, "v") == 0) {  /* Geometric vertices */
-            // std::assert(line_vec.size() == 4);
+		if (strcmp(lineHeader, "v") == 0 && line_vec.size() >= 4) {  /* Geometric vertices */
 			glm::vec3 position = glm::vec3(std::atof(line_vec[1].c_str()), std::atof(line_vec[2].c_str()), std::atof(line_vec[3].c_str()));
 			temp_positions.push_back(position);
 		}
-		else if (strcmp(lineHeader, "vt") == 0) {  /* Texture coordinates */
-            // std::assert(line_vec.size() == 3);
+		else if (strcmp(lineHeader, "vt") == 0 && line_vec.size() >= 3) {  /* Texture coordinates */
 			glm::vec2 uv = glm::vec2(std::atof(line_vec[1].c_str()), std::atof(line_vec[2].c_str()));
 			temp_uvs.push_back(uv);
 		}
-		else if (strcmp(lineHeader, "vn") == 0) {  /* Vertex normals */
-            // std::assert(line_vec.size() == 4);
+		else if (strcmp(lineHeader, "vn") == 0 && line_vec.size() >= 4) {  /* Vertex normals */
 			glm::vec3 normal = glm::vec3(std::atof(line_vec[1].c_str()), std::atof(line_vec[2].c_str()), std::atof(line_vec[3].c_str()));
 			temp_normals.push_back(normal);
 		}
+		else if (strcmp(lineHeader, "v") == 0 || strcmp(lineHeader, "vt") == 0 || strcmp(lineHeader, "vn") == 0) {
+			std::cerr << "ERR: Too few coordinates in " << objPath << ": [" << line << "]" << std::endl;
+			return false;
+		}
 		else if (strcmp(lineHeader, "f") == 0) {  /* Face elements */
-            // std::assert((line_vec.size() == 4 || line_vec.size() == 5));
             int n = line_vec.size() - 1;
             if(n != 3 && n != 4) {
                 std::cerr << "ERR: There may exist some errors while loading the OBJ." << std::endl;
                 std::cerr << "     Error content: [" << line << "]" << std::endl;
                 std::cerr << "     Can only handle triangles or quads in OBJ for now." << std::endl;
-                exit(1);
+                return false;
             }
 
             std::vector<V> vertices(n);
@@ -115,6 +118,13 @@ Model loadOBJ(const char* objPath)
                 getline(ss, item, delim); int ip = std::atoi(item.c_str());
                 getline(ss, item, delim); int it = std::atoi(item.c_str());
                 getline(ss, item, delim); int in = std::atoi(item.c_str());
+                /* Each of the three must name an element read so far (counted from 1) */
+                if (ip < 1 || ip > static_cast<int>(temp_positions.size()) || it < 1 || it > static_cast<int>(temp_uvs.size()) ||
+                    in < 1 || in > static_cast<int>(temp_normals.size())) {
+                    std::cerr << "ERR: Face index out of range in " << objPath << ": [" << line << "]" << std::endl;
+                    std::cerr << "     Faces need position/uv/normal indices of elements listed before them." << std::endl;
+                    return false;
+                }
                 vertices[i].index_position = ip;
                 vertices[i].index_uv = it;
                 vertices[i].index_normal = in;
@@ -159,10 +169,17 @@ Model loadOBJ(const char* objPath)
 	}
     /* NOTE: vertices with the same position but different uv or normal are counted as different vertices during OBJ loading */
 	// std::cout << "INF: There are " << num_vertices << " vertices and " << model.indices.size() / 3 << " triangles in the OBJ.\n" << std::endl;
+
+	if (model.indices.empty()) {
+		std::cerr << "ERR: No faces in " << objPath << std::endl;
+		return false;
+	}
     
     normalizeToUnitBbox(model.vertices);
+    buildPositionStream(model);
+    model.bounds = calBounds(model.positions);
     
-    return model;
+    return true;
 }
 
 void calBboxAndCenter(const std::vector<Vertex>& verts)
@@ -210,3 +227,52 @@ void normalizeToUnitBbox(std::vector<Vertex>& verts)
     for(int i = 0; i < verts.size(); i++)
         verts[i].pos = (verts[i].pos - center) / S; 
 }
+
+void buildPositionStream(Model& model)
+{
+    /* Order positions lexicographically so that equal values share one entry */
+    struct PositionLess {
+        bool operator () (const glm::vec3& a, const glm::vec3& b) const {
+            return (a.x < b.x) || (a.x == b.x && a.y < b.y) || (a.x == b.x && a.y == b.y && a.z < b.z);
+        }
+    };
+
+    std::map<glm::vec3, unsigned int, PositionLess> positionIndex;
+    std::vector<unsigned int> remap(model.vertices.size());
+
+    model.positions.clear();
+    for (size_t i = 0; i < model.vertices.size(); i++) {
+        auto it = positionIndex.find(model.vertices[i].pos);
+        if (it == positionIndex.end()) {  /* The position is new */
+            it = positionIndex.emplace(model.vertices[i].pos, static_cast<unsigned int>(model.positions.size())).first;
+            model.positions.push_back(model.vertices[i].pos);
+        }
+        remap[i] = it->second;
+    }
+
+    model.positionIndices.resize(model.indices.size());
+    for (size_t i = 0; i < model.indices.size(); i++)
+        model.positionIndices[i] = remap[model.indices[i]];
+}
+
+Bounds calBounds(const std::vector<glm::vec3>& positions)
+{
+    Bounds bounds;
+    bounds.bboxMin = glm::vec3(1e+6f);
+    bounds.bboxMax = -bounds.bboxMin;
+    for (const glm::vec3& pos : positions) {
+        bounds.bboxMin = glm::min(bounds.bboxMin, pos);
+        bounds.bboxMax = glm::max(bounds.bboxMax, pos);
+    }
+
+    /* Sphere around the box center, just large enough to hold every position */
+    bounds.sphereCenter = 0.5f * (bounds.bboxMin + bounds.bboxMax);
+    float radius2 = 0.0f;
+    for (const glm::vec3& pos : positions) {
+        glm::vec3 d = pos - bounds.sphereCenter;
+        radius2 = glm::max(radius2, glm::dot(d, d));
+    }
+    bounds.sphereRadius = glm::sqrt(radius2);
+
+    return bounds;
+}
@@ -25,14 +25,28 @@ struct Vertex {
 	glm::vec3 normal;
 };
 
+/* Local-space bounds of a mesh */
+struct Bounds {
+	glm::vec3 bboxMin;
+	glm::vec3 bboxMax;
+	glm::vec3 sphereCenter;
+	float sphereRadius;
+};
+
 struct Model {
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
+	/* Position-only stream for depth-only passes: positions deduplicated by value, same triangles as indices */
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> positionIndices;
+	Bounds bounds;
 };
 
 void showOpenGLInfo(void);
 int randint(int a, int b);
 double randreal(double a, double b);
-Model loadOBJ(const char* objPath);
+bool loadOBJ(const char* objPath, Model& model);  /* False, with the reason on stderr, if the file is missing or malformed */
 void calBboxAndCenter(const std::vector<Vertex>& verts);
 void normalizeToUnitBbox(std::vector<Vertex>& verts);
+void buildPositionStream(Model& model);
+Bounds calBounds(const std::vector<glm::vec3>& positions);
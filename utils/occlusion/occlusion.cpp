@@ -0,0 +1,277 @@
+#include "occlusion.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* Clip-space w below which a vertex counts as crossing the near plane */
+#define OCCLUSION_MIN_W 1e-4f
+
+/* The deduplicated position stream of the model, without degenerate triangles */
+OccluderMesh makeOccluderMesh(const Model& model)
+{
+    OccluderMesh mesh;
+    mesh.positions = model.positions;
+    for (size_t i = 0; i + 2 < model.positionIndices.size(); i += 3) {
+        unsigned int a = model.positionIndices[i], b = model.positionIndices[i + 1], c = model.positionIndices[i + 2];
+        if (a == b || b == c || c == a)
+            continue;
+        mesh.indices.push_back(a);
+        mesh.indices.push_back(b);
+        mesh.indices.push_back(c);
+    }
+    return mesh;
+}
+
+void OcclusionCuller::setupOcclusionCuller(GLuint width, GLuint height, JobSystem* jobSystem)
+{
+    _width = MAX((width + 3) & ~3u, 4u);  /* Whole SIMD blocks per row */
+    _height = MAX(height, 1u);
+    _jobSystem = jobSystem;
+
+    _hiZ.clear();
+    for (GLuint w = _width, h = _height; ; w = MAX(w / 2, 1u), h = MAX(h / 2, 1u)) {
+        _hiZ.push_back(std::vector<GLfloat>(static_cast<size_t>(w) * h, 1.0f));
+        if (w == 1 && h == 1)
+            break;
+    }
+}
+
+void OcclusionCuller::clear(void)
+{
+    _triangles.clear();
+    std::fill(_hiZ[0].begin(), _hiZ[0].end(), 1.0f);
+}
+
+/* Project the triangles of the mesh to the screen and queue them for rasterize() */
+void OcclusionCuller::addOccluder(const OccluderMesh& mesh, const glm::mat4& modelViewProjectionMatrix)
+{
+    _clipPositions.resize(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); i++)
+        _clipPositions[i] = modelViewProjectionMatrix * glm::vec4(mesh.positions[i], 1.0f);
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        _Triangle triangle;
+        bool crossesNear = false;
+        for (int k = 0; k < 3; k++) {
+            const glm::vec4& p = _clipPositions[mesh.indices[i + k]];
+            if (p.w < OCCLUSION_MIN_W) {
+                crossesNear = true;
+                break;
+            }
+            triangle.v[k] = glm::vec3((p.x / p.w * 0.5f + 0.5f) * _width, (p.y / p.w * 0.5f + 0.5f) * _height, p.z / p.w);
+        }
+        if (crossesNear)
+            continue;
+
+        /* Make every triangle counter-clockwise, so that both sides occlude */
+        glm::vec2 e1 = glm::vec2(triangle.v[1] - triangle.v[0]), e2 = glm::vec2(triangle.v[2] - triangle.v[0]);
+        GLfloat area = e1.x * e2.y - e1.y * e2.x;
+        if (area == 0.0f || !std::isfinite(area))
+            continue;
+        if (area < 0.0f)
+            std::swap(triangle.v[1], triangle.v[2]);
+        _triangles.push_back(triangle);
+    }
+}
+
+/* Fill the depth buffer with all queued triangles, one band of rows per job, then build the Hi-Z pyramid */
+void OcclusionCuller::rasterize(void)
+{
+    _jobSystem->parallelFor(_height, BAND_ROWS, [this](GLuint rowBegin, GLuint rowEnd) { _rasterizeRows(rowBegin, rowEnd); });
+    _buildHiZ();
+}
+
+bool OcclusionCuller::isVisible(const Bounds& bounds, const glm::mat4& modelViewProjectionMatrix) const
+{
+    GLfloat minX = 1e+30f, minY = 1e+30f, maxX = -1e+30f, maxY = -1e+30f, minZ = 1.0f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = glm::vec3((i & 1) ? bounds.bboxMax.x : bounds.bboxMin.x,
+                                     (i & 2) ? bounds.bboxMax.y : bounds.bboxMin.y,
+                                     (i & 4) ? bounds.bboxMax.z : bounds.bboxMin.z);
+        glm::vec4 p = modelViewProjectionMatrix * glm::vec4(corner, 1.0f);
+        if (p.w < OCCLUSION_MIN_W)
+            return true;
+        GLfloat x = (p.x / p.w * 0.5f + 0.5f) * _width, y = (p.y / p.w * 0.5f + 0.5f) * _height;
+        minX = MIN(minX, x);
+        maxX = MAX(maxX, x);
+        minY = MIN(minY, y);
+        maxY = MAX(maxY, y);
+        minZ = MIN(minZ, p.z / p.w);
+    }
+    if (maxX < 0.0f || maxY < 0.0f || minX >= _width || minY >= _height)
+        return true;  /* Off screen: left to frustum culling */
+
+    /* Covered pixels, grown by one to make up for sampling at pixel centers */
+    GLint x0 = CLAMP(static_cast<GLint>(std::floor(minX)) - 1, 0, static_cast<GLint>(_width) - 1);
+    GLint x1 = CLAMP(static_cast<GLint>(std::floor(maxX)) + 1, 0, static_cast<GLint>(_width) - 1);
+    GLint y0 = CLAMP(static_cast<GLint>(std::floor(minY)) - 1, 0, static_cast<GLint>(_height) - 1);
+    GLint y1 = CLAMP(static_cast<GLint>(std::floor(maxY)) + 1, 0, static_cast<GLint>(_height) - 1);
+
+    /* Coarsest level at which the rectangle spans at most 2x2 texels */
+    GLuint level = 0;
+    while (level + 1 < _hiZ.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+        level++;
+
+    GLuint levelWidth = MAX(_width >> level, 1u), levelHeight = MAX(_height >> level, 1u);
+    GLuint tx0 = MIN(static_cast<GLuint>(x0) >> level, levelWidth - 1), tx1 = MIN(static_cast<GLuint>(x1) >> level, levelWidth - 1);
+    GLuint ty0 = MIN(static_cast<GLuint>(y0) >> level, levelHeight - 1), ty1 = MIN(static_cast<GLuint>(y1) >> level, levelHeight - 1);
+    GLfloat maxDepth = 0.0f;
+    for (GLuint y = ty0; y <= ty1; y++)
+        for (GLuint x = tx0; x <= tx1; x++)
+            maxDepth = MAX(maxDepth, _hiZ[level][y * levelWidth + x]);
+
+    return minZ <= maxDepth;
+}
+
+GLuint OcclusionCuller::getTriangleCount(void) const
+{
+    return static_cast<GLuint>(_triangles.size());
+}
+
+/* Rasterize every triangle over the rows [rowBegin, rowEnd), keeping the nearest depth */
+void OcclusionCuller::_rasterizeRows(GLuint rowBegin, GLuint rowEnd)
+{
+    std::vector<GLfloat>& depth = _hiZ[0];
+
+    for (const _Triangle& t : _triangles) {
+        const glm::vec3 &a = t.v[0], &b = t.v[1], &c = t.v[2];
+
+        /* Pixels whose centers may be covered */
+        GLint x0 = MAX(static_cast<GLint>(std::ceil(MIN(MIN(a.x, b.x), c.x) - 0.5f)), 0);
+        GLint x1 = MIN(static_cast<GLint>(std::floor(MAX(MAX(a.x, b.x), c.x) - 0.5f)), static_cast<GLint>(_width) - 1);
+        GLint y0 = MAX(static_cast<GLint>(std::ceil(MIN(MIN(a.y, b.y), c.y) - 0.5f)), static_cast<GLint>(rowBegin));
+        GLint y1 = MIN(static_cast<GLint>(std::floor(MAX(MAX(a.y, b.y), c.y) - 0.5f)), static_cast<GLint>(rowEnd) - 1);
+        if (x0 > x1 || y0 > y1)
+            continue;
+        x0 &= ~3;  /* Start on a SIMD block */
+
+        /* Edge functions E(x, y) = A x + B y + C, positive inside, and the depth plane */
+        const glm::vec3* v[3] = {&a, &b, &c};
+        GLfloat edgeA[3], edgeB[3], edgeC[3];
+        for (int k = 0; k < 3; k++) {
+            const glm::vec3 &p = *v[k], &q = *v[(k + 1) % 3];
+            edgeA[k] = p.y - q.y;
+            edgeB[k] = q.x - p.x;
+            edgeC[k] = p.x * q.y - p.y * q.x;
+        }
+        GLfloat area = edgeC[0] + edgeC[1] + edgeC[2];
+        GLfloat dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+        GLfloat dzdy = ((b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z)) / area;
+        GLfloat dz0 = a.z - a.x * dzdx - a.y * dzdy;
+
+        for (GLint y = y0; y <= y1; y++) {
+            GLfloat py = y + 0.5f;
+            GLfloat* row = &depth[static_cast<size_t>(y) * _width];
+#if defined(__SSE2__)
+            const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 zStep = _mm_set1_ps(4.0f * dzdx);
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<GLfloat>(x0)), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), px), _mm_set1_ps(edgeB[0] * py + edgeC[0]));
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), px), _mm_set1_ps(edgeB[1] * py + edgeC[1]));
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), px), _mm_set1_ps(edgeB[2] * py + edgeC[2]));
+            __m128 step0 = _mm_set1_ps(4.0f * edgeA[0]), step1 = _mm_set1_ps(4.0f * edgeA[1]), step2 = _mm_set1_ps(4.0f * edgeA[2]);
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(dzdy * py + dz0));
+            for (GLint x = x0; x <= x1; x += 4) {
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(_mm_min_ps(_mm_min_ps(e0, e1), e2), _mm_setzero_ps()),
+                                           _mm_cmplt_ps(z, _mm_loadu_ps(&row[x])));
+                if (_mm_movemask_ps(inside))
+                    _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, _mm_loadu_ps(&row[x]))));
+                e0 = _mm_add_ps(e0, step0);
+                e1 = _mm_add_ps(e1, step1);
+                e2 = _mm_add_ps(e2, step2);
+                z = _mm_add_ps(z, zStep);
+            }
+#else
+            for (GLint x = x0; x <= x1; x++) {
+                GLfloat px = x + 0.5f;
+                if (edgeA[0] * px + edgeB[0] * py + edgeC[0] < 0.0f ||
+                    edgeA[1] * px + edgeB[1] * py + edgeC[1] < 0.0f ||
+                    edgeA[2] * px + edgeB[2] * py + edgeC[2] < 0.0f)
+                    continue;
+                GLfloat z = dzdx * px + dzdy * py + dz0;
+                if (z < row[x])
+                    row[x] = z;
+            }
+#endif
+        }
+    }
+}
+
+/* Each texel of a level keeps the farthest depth of the 2x2 texels below it */
+void OcclusionCuller::_buildHiZ(void)
+{
+    GLuint width = _width, height = _height;
+    for (size_t level = 1; level < _hiZ.size(); level++) {
+        GLuint levelWidth = MAX(width / 2, 1u), levelHeight = MAX(height / 2, 1u);
+        const std::vector<GLfloat>& src = _hiZ[level - 1];
+        std::vector<GLfloat>& dst = _hiZ[level];
+        for (GLuint y = 0; y < levelHeight; y++)
+            for (GLuint x = 0; x < levelWidth; x++) {
+                /* Odd sizes: the last texel also covers the leftover row/column */
+                GLuint sx0 = MIN(2 * x, width - 1), sx1 = (x + 1 == levelWidth) ? width - 1 : 2 * x + 1;
+                GLuint sy0 = MIN(2 * y, height - 1), sy1 = (y + 1 == levelHeight) ? height - 1 : 2 * y + 1;
+                GLfloat d = 0.0f;
+                for (GLuint sy = sy0; sy <= sy1; sy++)
+                    for (GLuint sx = sx0; sx <= sx1; sx++)
+                        d = MAX(d, src[sy * width + sx]);
+                dst[y * levelWidth + x] = d;
+            }
+        width = levelWidth;
+        height = levelHeight;
+    }
+}
+
+/* Self-check of the occlusion culler on a hand-made scene (no OpenGL needed) */
+bool checkOcclusionCulling(void)
+{
+    struct Case {
+        const char* name;
+        glm::vec3 center;
+        GLfloat size;
+        bool expectVisible;
+    };
+    const Case cases[] = {
+        {"box behind the wall", glm::vec3(0.0f, 0.0f, -10.0f), 1.0f, false},
+        {"large box behind the wall", glm::vec3(0.0f, 0.0f, -20.0f), 8.0f, false},
+        {"box in front of the wall", glm::vec3(0.0f, 0.0f, -3.0f), 1.0f, true},
+        {"box beside the wall", glm::vec3(8.0f, 0.0f, -10.0f), 1.0f, true},
+        {"box straddling the wall edge", glm::vec3(5.5f, 0.0f, -9.0f), 1.0f, true},
+        {"box through the wall", glm::vec3(0.0f, 0.0f, -5.0f), 1.0f, true},
+        {"box around the camera", glm::vec3(0.0f), 1.0f, true},
+    };
+
+    /* A 6x6 wall (two triangles) 5 units in front of the camera */
+    OccluderMesh wall;
+    wall.positions = {glm::vec3(-3.0f, -3.0f, 0.0f), glm::vec3(3.0f, -3.0f, 0.0f), glm::vec3(3.0f, 3.0f, 0.0f), glm::vec3(-3.0f, 3.0f, 0.0f)};
+    wall.indices = {0, 1, 2, 0, 2, 3};
+
+    glm::mat4 viewProjectionMatrix = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+    glm::mat4 wallMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f));
+
+    JobSystem jobSystem;
+    jobSystem.setupJobSystem(std::max(std::thread::hardware_concurrency(), 1u));
+    OcclusionCuller culler;
+    culler.setupOcclusionCuller(256, 128, &jobSystem);
+    culler.clear();
+    culler.addOccluder(wall, viewProjectionMatrix * wallMatrix);
+    culler.rasterize();
+
+    bool passed = true;
+    Bounds unitBox = {glm::vec3(-0.5f), glm::vec3(0.5f), glm::vec3(0.0f), glm::sqrt(0.75f)};
+    for (const Case& c : cases) {
+        glm::mat4 modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), c.center), glm::vec3(c.size));
+        bool visible = culler.isVisible(unitBox, viewProjectionMatrix * modelMatrix);
+        std::cout << (visible == c.expectVisible ? "INF: " : "ERR: ") << c.name << ": "
+                  << (visible ? "visible" : "occluded") << std::endl;
+        passed = passed && visible == c.expectVisible;
+    }
+    return passed;
+}
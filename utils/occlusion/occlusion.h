@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "job/job.h"
+#include "misc/misc.h"
+
+#include <vector>
+
+/* Position-only triangle mesh rasterized into the occlusion depth buffer */
+struct OccluderMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+};
+
+OccluderMesh makeOccluderMesh(const Model& model);
+
+/*
+Software occlusion culling, entirely on the CPU.
+
+Occluder triangles are rasterized into a small depth buffer (e.g. 256x128),
+each job of the JobSystem filling its own band of rows with SIMD edge
+functions. A Hi-Z
+pyramid keeps the farthest depth of every 2x2 block, so a box is tested by
+reading at most 2x2 texels, at the finest level where its screen rectangle
+spans no more: it is occluded when its nearest corner is behind all of them.
+
+Triangles crossing the near plane are skipped and boxes crossing it are
+always visible, which keeps the test conservative.
+*/
+class OcclusionCuller
+{
+public:
+    static const GLuint BAND_ROWS = 8;  /* Rows rasterized per job */
+
+    void setupOcclusionCuller(GLuint width, GLuint height, JobSystem* jobSystem);
+    void clear(void);
+    void addOccluder(const OccluderMesh& mesh, const glm::mat4& modelViewProjectionMatrix);
+    void rasterize(void);
+    bool isVisible(const Bounds& bounds, const glm::mat4& modelViewProjectionMatrix) const;
+    GLuint getTriangleCount(void) const;
+
+private:
+    /* Screen-space triangle, counter-clockwise, depth in NDC */
+    struct _Triangle {
+        glm::vec3 v[3];
+    };
+
+    GLuint _width, _height;
+    JobSystem* _jobSystem;
+    std::vector<_Triangle> _triangles;
+    std::vector<glm::vec4> _clipPositions;
+    std::vector<std::vector<GLfloat>> _hiZ;  /* Level 0 is the depth buffer */
+
+    void _rasterizeRows(GLuint rowBegin, GLuint rowEnd);
+    void _buildHiZ(void);
+};
+
+bool checkOcclusionCulling(void);
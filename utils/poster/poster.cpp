@@ -0,0 +1,176 @@
+#include "poster.h"
+
+#include "misc/misc.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cstring>
+#include <iostream>
+
+/* Tiles are clamped to the framebuffer and viewport limits, and to the image */
+GLboolean PosterRenderer::setupPosterRenderer(const std::string& path, GLint width, GLint height, GLint tileWidth, GLint tileHeight, GLint samples)
+{
+    GLint maxRenderbufferSize = 0, maxViewportDims[2] = {0, 0};
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewportDims);
+    if (width <= 0 || height <= 0 || tileWidth <= 0 || tileHeight <= 0) {
+        std::cerr << "ERR: Invalid poster size " << width << "x" << height << " in tiles of " << tileWidth << "x" << tileHeight << std::endl;
+        return GL_FALSE;
+    }
+
+    _path = path;
+    _width = width;
+    _height = height;
+    _tileWidth = MIN(MIN(tileWidth, width), MIN(maxRenderbufferSize, maxViewportDims[0]));
+    _tileHeight = MIN(MIN(tileHeight, height), MIN(maxRenderbufferSize, maxViewportDims[1]));
+    _columnCount = static_cast<GLuint>((width + _tileWidth - 1) / _tileWidth);
+    _rowCount = static_cast<GLuint>((height + _tileHeight - 1) / _tileHeight);
+
+    _file = fopen(path.c_str(), "wb");
+    if (!_file) {
+        std::cerr << "ERR: Failed to open " << path << std::endl;
+        return GL_FALSE;
+    }
+    fprintf(_file, "P6\n%d %d\n255\n", width, height);
+
+    _target.setupFramebuffer(_tileWidth, _tileHeight, samples);
+    glGenBuffers(RING_SIZE, _pboIDs);
+    for (GLuint i = 0; i < RING_SIZE; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _pboIDs[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(_tileWidth) * _tileHeight * 4, NULL, GL_STREAM_READ);
+        _fences[i] = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    _next = _pendingCount = 0;
+
+    _stripe.assign(static_cast<size_t>(width) * _tileHeight * 3, 0);
+    _stripeRow = 0;
+    _readbackStalls = 0;
+
+    std::cout << "INF: Rendering a " << width << "x" << height << " poster to " << path << " in " << getTileCount() << " tiles of "
+              << _tileWidth << "x" << _tileHeight << std::endl;
+    return GL_TRUE;
+}
+
+GLuint PosterRenderer::getTileCount(void) const
+{
+    return _columnCount * _rowCount;
+}
+
+/*
+The part of the whole image's frustum seen by a tile. Edge tiles keep the
+full tile size, so their frustum reaches past the image and only the part
+inside is read back.
+*/
+glm::mat4 PosterRenderer::getTileProjection(GLuint tile, GLfloat fovDegrees, GLfloat near, GLfloat far) const
+{
+    GLint x, y, width, height;
+    _getTileRect(tile, x, y, width, height);
+
+    GLfloat top = near * glm::tan(glm::radians(fovDegrees) * 0.5f);
+    GLfloat right = top * static_cast<GLfloat>(_width) / static_cast<GLfloat>(_height);
+    GLfloat tileLeft = -right + 2.0f * right * x / _width;
+    GLfloat tileRight = -right + 2.0f * right * (x + _tileWidth) / _width;
+    GLfloat tileTop = top - 2.0f * top * y / _height;
+    GLfloat tileBottom = top - 2.0f * top * (y + _tileHeight) / _height;
+    return glm::frustum(tileLeft, tileRight, tileBottom, tileTop, near, far);
+}
+
+const Framebuffer& PosterRenderer::getTarget(void) const
+{
+    return _target;
+}
+
+/* Queue the readback of the tile's part of the image, retiring the oldest tile when the ring is full */
+void PosterRenderer::readTile(GLuint tile)
+{
+    GLint x, y, width, height;
+    _getTileRect(tile, x, y, width, height);
+
+    if (_pendingCount == RING_SIZE)
+        _retireOldest();
+
+    _target.resolve();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pboIDs[_next]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, _tileHeight - height, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);  /* The image is at the top of an edge tile */
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    _fences[_next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _pboTiles[_next] = tile;
+    _next = (_next + 1) % RING_SIZE;
+    _pendingCount++;
+}
+
+/* Retire the remaining tiles, write the last stripe and close the file */
+GLboolean PosterRenderer::finish(void)
+{
+    while (_pendingCount)
+        _retireOldest();
+    if (_stripeRow < _rowCount)
+        _writeStripe();
+
+    GLboolean failed = ferror(_file) != 0;
+    failed = fclose(_file) != 0 || failed;
+    glDeleteBuffers(RING_SIZE, _pboIDs);
+    std::vector<unsigned char>().swap(_stripe);
+
+    if (failed) {
+        std::cerr << "ERR: Failed to write the poster to " << _path << std::endl;
+        return GL_FALSE;
+    }
+    std::cout << "INF: Wrote " << _path << " (" << _readbackStalls << " waits for readback)" << std::endl;
+    return GL_TRUE;
+}
+
+/* Pixels of the image covered by a tile; y counts from the top */
+void PosterRenderer::_getTileRect(GLuint tile, GLint& x, GLint& y, GLint& width, GLint& height) const
+{
+    x = static_cast<GLint>(tile % _columnCount) * _tileWidth;
+    y = static_cast<GLint>(tile / _columnCount) * _tileHeight;
+    width = MIN(_tileWidth, _width - x);
+    height = MIN(_tileHeight, _height - y);
+}
+
+/* Copy the oldest pending tile into the stripe, writing out the previous stripe if the tile starts a new row */
+void PosterRenderer::_retireOldest(void)
+{
+    GLuint slot = (_next + RING_SIZE - _pendingCount) % RING_SIZE;
+    GLuint tile = _pboTiles[slot];
+    if (tile / _columnCount != _stripeRow)
+        _writeStripe();
+
+    if (glClientWaitSync(_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+        _readbackStalls++;
+        while (glClientWaitSync(_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+    }
+    glDeleteSync(_fences[slot]);
+    _fences[slot] = NULL;
+    _pendingCount--;
+
+    GLint x, y, width, height;
+    _getTileRect(tile, x, y, width, height);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pboIDs[slot]);
+    const unsigned char* pixels = static_cast<const unsigned char*>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(width) * height * 4, GL_MAP_READ_BIT));
+    if (pixels) {
+        for (GLint row = 0; row < height; row++) {  /* Bottom row first in the PBO, top row first in the stripe */
+            const unsigned char* src = pixels + static_cast<size_t>(height - 1 - row) * width * 4;
+            unsigned char* dst = &_stripe[(static_cast<size_t>(row) * _width + x) * 3];
+            for (GLint i = 0; i < width; i++)
+                memcpy(dst + i * 3, src + i * 4, 3);
+        }
+    }
+    else
+        std::cerr << "ERR: Failed to map the readback of tile " << tile << std::endl;
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void PosterRenderer::_writeStripe(void)
+{
+    GLint rowHeight = MIN(_tileHeight, _height - static_cast<GLint>(_stripeRow) * _tileHeight);
+    fwrite(_stripe.data(), 1, static_cast<size_t>(_width) * rowHeight * 3, _file);
+    _stripeRow++;
+}
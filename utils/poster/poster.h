@@ -0,0 +1,54 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "framebuffer/framebuffer.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+Screenshots larger than any framebuffer, rendered in tiles. The camera
+frustum of the whole image is split into off-axis sub-frusta, one per tile,
+and every tile is drawn into the same tile-sized Framebuffer.
+
+Tiles go row by row from the top. Each tile is read back asynchronously
+into the next of RING_SIZE pixel buffer objects, which is only mapped once
+the ring wraps around, so the GPU keeps rendering while earlier tiles are
+copied. Retired tiles fill a stripe of one tile row, written to a binary PPM
+as soon as the row is complete: the whole image is never in memory.
+*/
+class PosterRenderer
+{
+public:
+    static const GLuint RING_SIZE = 3;
+
+    GLboolean setupPosterRenderer(const std::string& path, GLint width, GLint height, GLint tileWidth, GLint tileHeight, GLint samples);
+    GLuint getTileCount(void) const;
+    glm::mat4 getTileProjection(GLuint tile, GLfloat fovDegrees, GLfloat near, GLfloat far) const;
+    const Framebuffer& getTarget(void) const;
+    void readTile(GLuint tile);  /* After drawing the tile into getTarget() */
+    GLboolean finish(void);
+
+private:
+    std::string _path;
+    FILE* _file;
+    GLint _width, _height, _tileWidth, _tileHeight;
+    GLuint _columnCount, _rowCount;
+    Framebuffer _target;
+
+    GLuint _pboIDs[RING_SIZE];
+    GLsync _fences[RING_SIZE];
+    GLuint _pboTiles[RING_SIZE];
+    GLuint _next, _pendingCount;  /* Oldest pending PBO is (_next - _pendingCount) mod RING_SIZE */
+
+    std::vector<unsigned char> _stripe;  /* RGB, top row first, of the tile row being retired */
+    GLuint _stripeRow;
+    GLuint _readbackStalls;
+
+    void _getTileRect(GLuint tile, GLint& x, GLint& y, GLint& width, GLint& height) const;
+    void _retireOldest(void);
+    void _writeStripe(void);
+};
@@ -0,0 +1,200 @@
+#include "profiler.h"
+
+#include "device/device.h"
+#include "misc/misc.h"
+
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+GLboolean profilerEnabled = GL_FALSE;
+
+/* ----- Registry of tracks and of the events collected from them ----- */
+static const size_t MAX_COLLECTED_EVENTS = 1 << 21;
+
+struct CollectedEvent {
+    ProfileEvent event;
+    GLuint trackID;
+};
+
+static std::mutex registryMutex;
+static std::vector<ProfileTrack*> tracks;  /* Never freed: a thread may exit before its events are written */
+static std::vector<CollectedEvent> collectedEvents;
+static uint64_t overflowCount = 0;  /* Collected events beyond MAX_COLLECTED_EVENTS */
+/* ------------------------------------------------------------------- */
+
+ProfileTrack::ProfileTrack(GLuint id, const std::string& name)
+    : _id(id), _head(0), _tail(0), _droppedCount(0), _name(name)
+{
+}
+
+void ProfileTrack::push(const ProfileEvent& event)
+{
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == CAPACITY) {
+        _droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _events[head % CAPACITY] = event;
+    _head.store(head + 1, std::memory_order_release);
+}
+
+GLuint ProfileTrack::getID(void) const
+{
+    return _id;
+}
+
+uint64_t ProfileTrack::getDroppedCount(void) const
+{
+    return _droppedCount.load(std::memory_order_relaxed);
+}
+
+void setupProfiler(void)
+{
+    profilerEnabled = GL_TRUE;
+    collectedEvents.reserve(1 << 16);
+    std::cout << "INF: Profiling into rings of " << ProfileTrack::CAPACITY << " events per thread" << std::endl;
+}
+
+void nameProfilerThread(const char* name)
+{
+    ProfileTrack* track = getThreadProfileTrack();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    track->_name = name;
+}
+
+ProfileTrack* getThreadProfileTrack(void)
+{
+    thread_local ProfileTrack* track = NULL;
+    if (!track) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        GLuint id = static_cast<GLuint>(tracks.size()) + 1;
+        track = new ProfileTrack(id, "Thread " + std::to_string(id));
+        tracks.push_back(track);
+    }
+    return track;
+}
+
+ProfileTrack* createProfileTrack(const char* name)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    tracks.push_back(new ProfileTrack(static_cast<GLuint>(tracks.size()) + 1, name));
+    return tracks.back();
+}
+
+/* Move the events of every track out of its ring */
+void collectProfileEvents(void)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (ProfileTrack* track : tracks) {
+        GLuint trackID = track->getID();
+        track->drain([trackID](const ProfileEvent& event) {
+            if (collectedEvents.size() < MAX_COLLECTED_EVENTS)
+                collectedEvents.push_back({event, trackID});
+            else
+                overflowCount++;
+        });
+    }
+}
+
+static void writeJSONString(FILE* file, const std::string& text)
+{
+    fputc('"', file);
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            fputc('\\', file);
+        if (static_cast<unsigned char>(c) >= 0x20)
+            fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+/* Complete ("X") events in microseconds, one thread per track, all in one process */
+GLboolean writeChromeTrace(const std::string& path)
+{
+    collectProfileEvents();
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        std::cerr << "ERR: Failed to open " << path << std::endl;
+        return GL_FALSE;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t droppedCount = overflowCount;
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (size_t i = 0; i < tracks.size(); i++) {
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ", i ? ",\n" : "", tracks[i]->getID());
+        writeJSONString(file, tracks[i]->_name);
+        fprintf(file, "}}");
+        droppedCount += tracks[i]->getDroppedCount();
+    }
+    for (const CollectedEvent& collected : collectedEvents) {
+        const ProfileEvent& event = collected.event;
+        fprintf(file, ",\n{\"name\": ");
+        writeJSONString(file, event.name);
+        fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", collected.trackID, 1e-3 * event.start,
+                1e-3 * (event.end - event.start));
+    }
+    fprintf(file, "\n]}\n");
+
+    GLboolean failed = ferror(file) != 0;
+    failed = fclose(file) != 0 || failed;
+    if (failed) {
+        std::cerr << "ERR: Failed to write the trace to " << path << std::endl;
+        return GL_FALSE;
+    }
+    std::cout << "INF: Wrote " << collectedEvents.size() << " profile events to " << path;
+    if (droppedCount)
+        std::cout << " (" << droppedCount << " dropped by full rings)";
+    std::cout << std::endl;
+    return GL_TRUE;
+}
+
+void GpuTimers::setupGpuTimers(void)
+{
+    _track = profilerEnabled ? createProfileTrack("GPU") : NULL;
+    getRenderDevice().genQueries(QUERY_COUNT, _queryIDs);
+    _next = _pending = 0;
+    _lastEnd = 0;
+}
+
+void GpuTimers::begin(const char* name)
+{
+    if (!_track)
+        return;
+    /* Forget the oldest section if its result has not come back yet */
+    if (_pending == QUERY_COUNT)
+        _pending--;
+    _names[_next] = name;
+    _submitTimes[_next] = getTimeNs();
+    getRenderDevice().beginQuery(GL_TIME_ELAPSED, _queryIDs[_next]);
+}
+
+void GpuTimers::end(void)
+{
+    if (!_track)
+        return;
+    getRenderDevice().endQuery(GL_TIME_ELAPSED);
+    _next = (_next + 1) % QUERY_COUNT;
+    _pending++;
+}
+
+/* Turn the available results, oldest first, into events of the GPU track */
+void GpuTimers::collect(void)
+{
+    while (_track && _pending > 0) {
+        GLuint oldest = (_next + QUERY_COUNT - _pending) % QUERY_COUNT;
+        GLint available = 0;
+        getRenderDevice().getQueryObjectiv(_queryIDs[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64 elapsed = 0;
+        getRenderDevice().getQueryObjectui64v(_queryIDs[oldest], GL_QUERY_RESULT, &elapsed);
+        uint64_t start = MAX(_submitTimes[oldest], _lastEnd);
+        _lastEnd = start + elapsed;
+        _track->push({_names[oldest], start, _lastEnd});
+        _pending--;
+    }
+}
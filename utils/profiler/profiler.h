@@ -0,0 +1,116 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include "clock/clock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+Scope profiler. PROFILE_SCOPE("name") times the rest of the enclosing block
+on the calling thread; names must be string literals. While the profiler
+is off a scope costs one predictable branch, and building with
+-DPROFILER_DISABLED removes the scopes entirely.
+
+Every thread writes its events into a ring of its own, with no lock: the
+thread only advances the head and collectProfileEvents() only advances the
+tail. A full ring drops new events (they are counted) until the next
+collection, so collect once per frame. writeChromeTrace() saves every
+collected event as Chrome trace-event JSON, which chrome://tracing and
+Perfetto both open.
+*/
+struct ProfileEvent {
+    const char* name;
+    uint64_t start, end;  /* getTimeNs() */
+};
+
+/* Events of one thread, or of the GPU */
+class ProfileTrack
+{
+public:
+    static const GLuint CAPACITY = 1 << 14;
+
+    ProfileTrack(GLuint id, const std::string& name);
+    void push(const ProfileEvent& event);  /* By the owning thread only */
+    GLuint getID(void) const;
+    uint64_t getDroppedCount(void) const;
+
+    template <typename F>
+    void drain(F consume)  /* Under the collector's lock */
+    {
+        uint64_t head = _head.load(std::memory_order_acquire), tail = _tail.load(std::memory_order_relaxed);
+        for (; tail < head; tail++)
+            consume(_events[tail % CAPACITY]);
+        _tail.store(tail, std::memory_order_release);
+    }
+
+private:
+    GLuint _id;
+    ProfileEvent _events[CAPACITY];
+    std::atomic<uint64_t> _head, _tail;
+    std::atomic<uint64_t> _droppedCount;
+
+    friend void nameProfilerThread(const char* name);
+    friend GLboolean writeChromeTrace(const std::string& path);
+    std::string _name;  /* Guarded by the registry lock */
+};
+
+extern GLboolean profilerEnabled;
+
+void setupProfiler(void);  /* Turns the profiler on */
+void nameProfilerThread(const char* name);
+ProfileTrack* getThreadProfileTrack(void);
+ProfileTrack* createProfileTrack(const char* name);  /* For events that are not timed on a thread */
+void collectProfileEvents(void);
+GLboolean writeChromeTrace(const std::string& path);
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) : _name(profilerEnabled ? name : NULL), _start(_name ? getTimeNs() : 0) {}
+    ~ProfileScope()
+    {
+        if (_name)
+            getThreadProfileTrack()->push({_name, _start, getTimeNs()});
+    }
+
+private:
+    const char* _name;
+    uint64_t _start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifdef PROFILER_DISABLED
+#define PROFILE_SCOPE(name) ((void)0)
+#else
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(_profileScope, __LINE__)(name)
+#endif
+
+/*
+GPU time of named sections of a frame, from GL_TIME_ELAPSED queries read
+back a few frames late so that they never stall. Sections cannot nest.
+Results go to a "GPU" track: the queries only measure durations, so each
+section is placed at its submission time, or right after the previous
+section if that ends later.
+*/
+class GpuTimers
+{
+public:
+    static const GLuint QUERY_COUNT = 32;
+
+    void setupGpuTimers(void);
+    void begin(const char* name);
+    void end(void);
+    void collect(void);  /* Once per frame, on the thread that owns the context */
+
+private:
+    ProfileTrack* _track;
+    GLuint _queryIDs[QUERY_COUNT];
+    const char* _names[QUERY_COUNT];
+    uint64_t _submitTimes[QUERY_COUNT];
+    GLuint _next, _pending;
+    uint64_t _lastEnd;
+};
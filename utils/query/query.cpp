@@ -0,0 +1,51 @@
+#include "query.h"
+
+#include "device/device.h"
+
+void QueryRing::setupQueryRing(GLenum target)
+{
+    _target = target;
+    getRenderDevice().genQueries(RING_SIZE, _queryIDs);
+    _next = _pending = 0;
+    _result = 0;
+}
+
+void QueryRing::begin(void)
+{
+    /* Drop the oldest result if the ring is full and it has not been read yet */
+    if (_pending == RING_SIZE)
+        _pending--;
+    getRenderDevice().beginQuery(_target, _queryIDs[_next]);
+}
+
+void QueryRing::end(void)
+{
+    getRenderDevice().endQuery(_target);
+    _next = (_next + 1) % RING_SIZE;
+    _pending++;
+}
+
+/* Most recent available result (older results are consumed on the way) */
+GLuint64 QueryRing::getResult(void)
+{
+    while (takeResult(_result, GL_FALSE))
+        ;
+    return _result;
+}
+
+/* Oldest result not taken yet, if it is available or wait is set; every result is taken once */
+GLboolean QueryRing::takeResult(GLuint64& result, GLboolean wait)
+{
+    if (_pending == 0)
+        return GL_FALSE;
+    GLuint oldest = (_next + RING_SIZE - _pending) % RING_SIZE;
+    if (!wait) {
+        GLint available = 0;
+        getRenderDevice().getQueryObjectiv(_queryIDs[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return GL_FALSE;
+    }
+    getRenderDevice().getQueryObjectui64v(_queryIDs[oldest], GL_QUERY_RESULT, &result);
+    _pending--;
+    return GL_TRUE;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "GL/glew.h"
+
+/*
+Ring of GL queries (e.g. GL_SAMPLES_PASSED, GL_TIME_ELAPSED) read back a few
+frames late, so that fetching a result never stalls the pipeline.
+*/
+class QueryRing
+{
+public:
+    static const GLuint RING_SIZE = 4;
+
+    void setupQueryRing(GLenum target);
+    void begin(void);
+    void end(void);
+    GLuint64 getResult(void);
+    GLboolean takeResult(GLuint64& result, GLboolean wait);
+
+private:
+    GLenum _target;
+    GLuint _queryIDs[RING_SIZE];
+    GLuint _next, _pending;
+    GLuint64 _result;
+};
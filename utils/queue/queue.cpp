@@ -0,0 +1,72 @@
+#include "queue.h"
+
+#include "misc/misc.h"
+
+#define KEY_PROGRAM_SHIFT 54
+#define KEY_MATERIAL_SHIFT 40
+#define KEY_VAO_SHIFT 24
+#define KEY_DEPTH_BITS 24
+#define KEY_FIELD(key, shift, bits) (((key) >> (shift)) & ((1ull << (bits)) - 1))
+
+/* depth is the normalized view depth in [0, 1]; fields wider than their bits wrap around */
+uint64_t RenderQueue::makeKey(GLuint program, GLuint material, GLuint vao, GLfloat depth)
+{
+    uint64_t quantizedDepth = static_cast<uint64_t>(CLAMP(depth, 0.0f, 1.0f) * ((1 << KEY_DEPTH_BITS) - 1));
+    return (static_cast<uint64_t>(program & 0x3ff) << KEY_PROGRAM_SHIFT) |
+           (static_cast<uint64_t>(material & 0x3fff) << KEY_MATERIAL_SHIFT) |
+           (static_cast<uint64_t>(vao & 0xffff) << KEY_VAO_SHIFT) |
+           quantizedDepth;
+}
+
+void RenderQueue::clear(void)
+{
+    _items.clear();
+}
+
+void RenderQueue::push(uint64_t key, GLuint index)
+{
+    _items.push_back({key, index});
+}
+
+void RenderQueue::sort(void)
+{
+    /* Histograms of all eight digits in one pass */
+    GLuint counts[8][256] = {};
+    for (const RenderQueueItem& item : _items)
+        for (int digit = 0; digit < 8; digit++)
+            counts[digit][(item.key >> (8 * digit)) & 0xff]++;
+
+    _scratch.resize(_items.size());
+    for (int digit = 0; digit < 8; digit++) {
+        if (_items.empty() || counts[digit][(_items[0].key >> (8 * digit)) & 0xff] == _items.size())
+            continue;  /* Every key has the same digit: the pass would not move anything */
+
+        GLuint offsets[256];
+        GLuint offset = 0;
+        for (int i = 0; i < 256; i++) {
+            offsets[i] = offset;
+            offset += counts[digit][i];
+        }
+        for (const RenderQueueItem& item : _items)
+            _scratch[offsets[(item.key >> (8 * digit)) & 0xff]++] = item;
+        _items.swap(_scratch);
+    }
+}
+
+const std::vector<RenderQueueItem>& RenderQueue::getItems(void) const
+{
+    return _items;
+}
+
+/* Program, material and VAO binds needed to submit the items in their current order */
+GLuint RenderQueue::countStateChanges(void) const
+{
+    GLuint changes = 0;
+    for (size_t i = 0; i < _items.size(); i++) {
+        uint64_t key = _items[i].key, last = i ? _items[i - 1].key : ~key;
+        changes += KEY_FIELD(key, KEY_PROGRAM_SHIFT, 10) != KEY_FIELD(last, KEY_PROGRAM_SHIFT, 10);
+        changes += KEY_FIELD(key, KEY_MATERIAL_SHIFT, 14) != KEY_FIELD(last, KEY_MATERIAL_SHIFT, 14);
+        changes += KEY_FIELD(key, KEY_VAO_SHIFT, 16) != KEY_FIELD(last, KEY_VAO_SHIFT, 16);
+    }
+    return changes;
+}
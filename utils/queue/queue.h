@@ -0,0 +1,36 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <cstdint>
+#include <vector>
+
+struct RenderQueueItem {
+    uint64_t key;
+    GLuint index;  /* Into the caller's draw list */
+};
+
+/*
+Per-frame queue of opaque draws ordered by a 64-bit sort key:
+    bits 63-54  program
+    bits 53-40  material (texture set)
+    bits 39-24  VAO / mesh
+    bits 23-0   view depth, quantized
+so that sorting groups draws by pipeline state, most expensive change
+first, and orders each state bucket front to back. sort() is an LSD radix
+sort over 8-bit digits that skips the digits all keys share.
+*/
+class RenderQueue
+{
+public:
+    static uint64_t makeKey(GLuint program, GLuint material, GLuint vao, GLfloat depth);
+
+    void clear(void);
+    void push(uint64_t key, GLuint index);
+    void sort(void);
+    const std::vector<RenderQueueItem>& getItems(void) const;
+    GLuint countStateChanges(void) const;
+
+private:
+    std::vector<RenderQueueItem> _items, _scratch;
+};
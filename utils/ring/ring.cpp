@@ -0,0 +1,198 @@
+#include "ring.h"
+
+#include "device/device.h"
+
+#include <cstring>
+#include <iostream>
+
+void StreamRing::setupStreamRing(GLsizeiptr regionSize, GLboolean allowPersistentMapping)
+{
+    _persistent = allowPersistentMapping && GLEW_ARB_buffer_storage;
+    std::cout << "INF: Stream ring of " << REGION_COUNT << " x " << (regionSize >> 10) << " KB, "
+              << (_persistent ? "persistently mapped" : "mapped unsynchronized every frame") << std::endl;
+
+    GLint alignment;
+    getRenderDevice().getIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    _uniformAlignment = alignment;
+    _storageAlignment = _uniformAlignment;
+    if (GLEW_ARB_shader_storage_buffer_object) {
+        getRenderDevice().getIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        _storageAlignment = alignment;
+    }
+    _textureAlignment = 0;  /* Texture buffers cannot point into the ring without glTexBufferRange */
+    if (GLEW_ARB_texture_buffer_range) {
+        getRenderDevice().getIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        _textureAlignment = alignment;
+    }
+
+    for (GLuint i = 0; i < REGION_COUNT; i++)
+        _fences[i] = NULL;
+    _region = 0;
+    _head = _frameBytes = 0;
+    _stallCount = 0;
+    _mapped = NULL;
+    _createBuffer(regionSize);
+}
+
+/* Wait until the GPU is done with this frame's region (usually long done) */
+void StreamRing::beginFrame(void)
+{
+    GLsync fence = _fences[_region];
+    if (fence) {
+        if (getRenderDevice().clientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            _stallCount++;
+            while (getRenderDevice().clientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                ;
+        }
+        getRenderDevice().deleteSync(fence);
+        _fences[_region] = NULL;
+    }
+
+    _head = _frameBytes = 0;
+    if (!_persistent)
+        _mapRegion();
+}
+
+RingAllocation StreamRing::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    GLsizeiptr offset = (_head + alignment - 1) / alignment * alignment;
+    if (offset + size > _regionSize) {
+        /* Move to a new buffer large enough for the whole frame; this frame continues at its start */
+        GLsizeiptr regionSize = _regionSize * 2;
+        while (regionSize < _head + size)
+            regionSize *= 2;
+        std::cout << "INF: Stream ring grows to " << REGION_COUNT << " x " << (regionSize >> 10) << " KB" << std::endl;
+
+        _unmapRegion();
+        _retiredBufferIDs.push_back(_bufferID);
+        for (GLuint i = 0; i < REGION_COUNT; i++) {
+            if (_fences[i])
+                getRenderDevice().deleteSync(_fences[i]);
+            _fences[i] = NULL;
+        }
+        _createBuffer(regionSize);
+        if (!_persistent)
+            _mapRegion();
+        offset = 0;
+    }
+
+    RingAllocation allocation;
+    allocation.data = _mapped + (_persistent ? _region * _regionSize : 0) + offset;
+    allocation.bufferID = _bufferID;
+    allocation.offset = _region * _regionSize + offset;
+    allocation.size = size;
+    _head = offset + size;
+    _frameBytes += size;
+    return allocation;
+}
+
+/* Copy "data" into the ring and point a buffer texture at it; GL_FALSE if glTexBufferRange is missing */
+GLboolean StreamRing::uploadTextureBuffer(GLuint textureID, GLenum format, const void* data, GLsizeiptr size)
+{
+    if (!_textureAlignment)
+        return GL_FALSE;
+
+    RingAllocation allocation = allocate(size > 0 ? size : _textureAlignment, _textureAlignment);  /* An empty range is an error */
+    memcpy(allocation.data, data, size);
+    getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, textureID);
+    getRenderDevice().texBufferRange(GL_TEXTURE_BUFFER, format, allocation.bufferID, allocation.offset, allocation.size);
+    getRenderDevice().bindTexture(GL_TEXTURE_BUFFER, 0);
+    return GL_TRUE;
+}
+
+/* Make this frame's writes visible before drawing from them */
+void StreamRing::flush(void)
+{
+    if (!_persistent)
+        _unmapRegion();
+}
+
+/* Fence the region after the frame's last draw and move to the next one */
+void StreamRing::endFrame(void)
+{
+    flush();
+    _fences[_region] = getRenderDevice().fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _region = (_region + 1) % REGION_COUNT;
+
+    if (!_retiredBufferIDs.empty()) {
+        getRenderDevice().deleteBuffers(static_cast<GLsizei>(_retiredBufferIDs.size()), _retiredBufferIDs.data());
+        _retiredBufferIDs.clear();
+    }
+}
+
+GLsizeiptr StreamRing::getUniformAlignment(void) const
+{
+    return _uniformAlignment;
+}
+
+GLsizeiptr StreamRing::getStorageAlignment(void) const
+{
+    return _storageAlignment;
+}
+
+GLsizeiptr StreamRing::getRegionSize(void) const
+{
+    return _regionSize;
+}
+
+GLsizeiptr StreamRing::getFrameBytes(void) const
+{
+    return _frameBytes;
+}
+
+GLuint StreamRing::getStallCount(void) const
+{
+    return _stallCount;
+}
+
+GLboolean StreamRing::isPersistent(void) const
+{
+    return _persistent;
+}
+
+/* GL_COPY_WRITE_BUFFER is bound so that no VAO or draw binding is disturbed */
+void StreamRing::_createBuffer(GLsizeiptr regionSize)
+{
+    const GLsizeiptr bufferSize = regionSize * REGION_COUNT;
+
+    _regionSize = regionSize;
+    getRenderDevice().genBuffers(1, &_bufferID);
+    getRenderDevice().bindBuffer(GL_COPY_WRITE_BUFFER, _bufferID);
+    if (_persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        getRenderDevice().bufferStorage(GL_COPY_WRITE_BUFFER, bufferSize, NULL, flags);
+        _mapped = static_cast<unsigned char*>(getRenderDevice().mapBufferRange(GL_COPY_WRITE_BUFFER, 0, bufferSize, flags));
+        if (!_mapped) {
+            std::cerr << "ERR: Failed to map the stream ring" << std::endl;
+            exit(1);
+        }
+    }
+    else
+        getRenderDevice().bufferData(GL_COPY_WRITE_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+    getRenderDevice().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/* The fence of the region makes skipping the driver's synchronization safe */
+void StreamRing::_mapRegion(void)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+    getRenderDevice().bindBuffer(GL_COPY_WRITE_BUFFER, _bufferID);
+    _mapped = static_cast<unsigned char*>(getRenderDevice().mapBufferRange(GL_COPY_WRITE_BUFFER, _region * _regionSize, _regionSize, flags));
+    getRenderDevice().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (!_mapped) {
+        std::cerr << "ERR: Failed to map the stream ring" << std::endl;
+        exit(1);
+    }
+}
+
+void StreamRing::_unmapRegion(void)
+{
+    if (_persistent || !_mapped)
+        return;
+
+    getRenderDevice().bindBuffer(GL_COPY_WRITE_BUFFER, _bufferID);
+    getRenderDevice().unmapBuffer(GL_COPY_WRITE_BUFFER);
+    getRenderDevice().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    _mapped = NULL;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "GL/glew.h"
+
+#include <vector>
+
+/* Part of a StreamRing handed out for one frame: write "size" bytes at "data", draw from (bufferID, offset) */
+struct RingAllocation {
+    void* data;
+    GLuint bufferID;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+/*
+Triple-buffered ring for data streamed to OpenGL every frame (instances,
+indirect commands, light lists). The buffer is split into REGION_COUNT
+regions; a frame allocates from its own region while the GPU may still read
+the previous two, and a fence placed at endFrame() is waited on before the
+region is reused, so uploads never go through glBufferData re-specification.
+
+With ARB_buffer_storage the buffer is created with glBufferStorage and
+mapped once, persistent and coherent: an allocation is a pointer bump and
+flush() does nothing. Otherwise (e.g. OpenGL 4.1 on macOS) each region is
+mapped unsynchronized in beginFrame() and unmapped in flush(), the fences
+providing the synchronization the driver is told to skip.
+
+Per frame:
+    beginFrame(), allocate() and write, flush(), draw, endFrame()
+Allocations are only valid until endFrame(); without persistent mapping no
+allocation may be made, nor written to, after flush(). A region too small
+for a frame is replaced by a larger buffer on the spot, the old buffer being
+deleted at endFrame() (OpenGL keeps it alive until the GPU is done with it).
+*/
+class StreamRing
+{
+public:
+    static const GLuint REGION_COUNT = 3;
+
+    void setupStreamRing(GLsizeiptr regionSize, GLboolean allowPersistentMapping);
+    void beginFrame(void);
+    RingAllocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+    GLboolean uploadTextureBuffer(GLuint textureID, GLenum format, const void* data, GLsizeiptr size);
+    void flush(void);
+    void endFrame(void);
+    GLsizeiptr getUniformAlignment(void) const;
+    GLsizeiptr getStorageAlignment(void) const;
+    GLsizeiptr getRegionSize(void) const;
+    GLsizeiptr getFrameBytes(void) const;  /* Bytes allocated since beginFrame() */
+    GLuint getStallCount(void) const;      /* Frames that had to wait for the GPU */
+    GLboolean isPersistent(void) const;
+
+private:
+    GLuint _bufferID;
+    std::vector<GLuint> _retiredBufferIDs;  /* Replaced this frame, deleted at endFrame() */
+    GLsizeiptr _regionSize, _head, _frameBytes;
+    GLsizeiptr _uniformAlignment, _storageAlignment, _textureAlignment;
+    GLuint _region, _stallCount;
+    GLsync _fences[REGION_COUNT];
+    unsigned char* _mapped;  /* Whole buffer when persistent, else the current region while mapped */
+    GLboolean _persistent;
+
+    void _createBuffer(GLsizeiptr regionSize);
+    void _mapRegion(void);
+    void _unmapRegion(void);
+};
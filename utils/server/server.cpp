@@ -0,0 +1,383 @@
+#include "server.h"
+
+#include "clock/clock.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared frame sequences must be lock-free to work across processes");
+
+GLboolean SharedFrameRing::createSharedFrameRing(const std::string& name, GLuint width, GLuint height, GLuint slotCount)
+{
+    const uint64_t slotSize = (sizeof(SharedFrameSlot) + static_cast<uint64_t>(width) * height * 4 + 63) & ~static_cast<uint64_t>(63);
+
+    _name = name;
+    _owner = GL_TRUE;
+    _size = static_cast<size_t>(64 + slotSize * slotCount);
+    shm_unlink(name.c_str());  /* Left over by a crashed server */
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(_size)) != 0) {
+        std::cerr << "ERR: Failed to create shared memory " << name << ": " << strerror(errno) << std::endl;
+        if (fd >= 0)
+            ::close(fd);
+        return GL_FALSE;
+    }
+    void* memory = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "ERR: Failed to map shared memory " << name << std::endl;
+        return GL_FALSE;
+    }
+    _base = static_cast<unsigned char*>(memory);
+
+    SharedFrameHeader* header = reinterpret_cast<SharedFrameHeader*>(_base);
+    header->slotCount = slotCount;
+    header->width = width;
+    header->height = height;
+    header->slotSize = slotSize;
+    for (GLuint i = 0; i < slotCount; i++)
+        new (_getSlot(i)) SharedFrameSlot{{0}};
+    header->magic = MAGIC;
+    return GL_TRUE;
+}
+
+GLboolean SharedFrameRing::openSharedFrameRing(const std::string& name)
+{
+    _name = name;
+    _owner = GL_FALSE;
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "ERR: Failed to open shared memory " << name << ": " << strerror(errno) << std::endl;
+        return GL_FALSE;
+    }
+    off_t end = lseek(fd, 0, SEEK_END);
+    _size = end > 0 ? static_cast<size_t>(end) : 0;
+    void* memory = _size >= 64 ? mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (memory == MAP_FAILED || !_fitsSlots(*static_cast<const SharedFrameHeader*>(memory), _size)) {
+        std::cerr << "ERR: " << name << " is not a shared frame ring" << std::endl;
+        if (memory != MAP_FAILED)
+            munmap(memory, _size);
+        return GL_FALSE;
+    }
+    _base = static_cast<unsigned char*>(memory);
+    return GL_TRUE;
+}
+
+/* The header is ours, and its slots, each large enough for its pixels, fit in the size mapped */
+GLboolean SharedFrameRing::_fitsSlots(const SharedFrameHeader& header, size_t size)
+{
+    const uint64_t slotBytes = sizeof(SharedFrameSlot) + static_cast<uint64_t>(header.width) * header.height * 4;
+    return header.magic == MAGIC && header.slotSize >= slotBytes &&
+           (header.slotCount == 0 || header.slotSize <= (size - 64) / header.slotCount);
+}
+
+/* Pixels of the slot, to be filled before endWrite() */
+unsigned char* SharedFrameRing::beginWrite(GLuint slot)
+{
+    SharedFrameSlot* s = _getSlot(slot);
+    s->sequence.store(s->sequence.load(std::memory_order_relaxed) | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return reinterpret_cast<unsigned char*>(s + 1);
+}
+
+void SharedFrameRing::endWrite(GLuint slot, uint64_t frame)
+{
+    _getSlot(slot)->sequence.store(2 * (frame + 1), std::memory_order_release);
+}
+
+GLboolean SharedFrameRing::read(GLuint slot, uint64_t frame, std::vector<unsigned char>& rgba) const
+{
+    const SharedFrameHeader& header = getHeader();
+    const SharedFrameSlot* s = _getSlot(slot);
+    const uint64_t expected = 2 * (frame + 1);
+
+    if (slot >= header.slotCount || s->sequence.load(std::memory_order_acquire) != expected)
+        return GL_FALSE;
+    rgba.resize(static_cast<size_t>(header.width) * header.height * 4);
+    memcpy(rgba.data(), s + 1, rgba.size());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s->sequence.load(std::memory_order_relaxed) == expected;
+}
+
+const SharedFrameHeader& SharedFrameRing::getHeader(void) const
+{
+    return *reinterpret_cast<const SharedFrameHeader*>(_base);
+}
+
+const std::string& SharedFrameRing::getName(void) const
+{
+    return _name;
+}
+
+void SharedFrameRing::close(void)
+{
+    munmap(_base, _size);
+    if (_owner)
+        shm_unlink(_name.c_str());
+}
+
+SharedFrameSlot* SharedFrameRing::_getSlot(GLuint slot) const
+{
+    return reinterpret_cast<SharedFrameSlot*>(_base + 64 + slot * getHeader().slotSize);
+}
+
+GLboolean RenderServer::setupRenderServer(const std::string& socketPath)
+{
+    sockaddr_un address = {};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "ERR: Socket path " << socketPath << " is too long" << std::endl;
+        return GL_FALSE;
+    }
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    signal(SIGPIPE, SIG_IGN);  /* A client leaving mid-reply must not end the server */
+    _socketPath = socketPath;
+    _clientFD = -1;
+    _listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (_listenFD < 0 || bind(_listenFD, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(_listenFD, 4) != 0) {
+        std::cerr << "ERR: Failed to listen on " << socketPath << ": " << strerror(errno) << std::endl;
+        return GL_FALSE;
+    }
+    std::cout << "INF: Render server listening on " << socketPath << std::endl;
+    return GL_TRUE;
+}
+
+GLboolean RenderServer::readCommand(std::string& line)
+{
+    for (;;) {
+        size_t end = _buffer.find('\n');
+        if (end != std::string::npos) {
+            line = _buffer.substr(0, end);
+            _buffer.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            return GL_TRUE;
+        }
+        if (_buffer.size() > MAX_LINE_LENGTH) {
+            std::cerr << "ERR: Dropped a client sending a line longer than " << MAX_LINE_LENGTH << " bytes" << std::endl;
+            reply("error line too long");
+            _dropClient();
+        }
+
+        if (_clientFD < 0) {
+            _buffer.clear();
+            _clientFD = accept(_listenFD, NULL, NULL);
+            if (_clientFD < 0 && errno != EINTR) {
+                std::cerr << "ERR: Failed to accept a client: " << strerror(errno) << std::endl;
+                return GL_FALSE;
+            }
+            continue;
+        }
+
+        char chunk[4096];
+        ssize_t count = recv(_clientFD, chunk, sizeof(chunk), 0);
+        if (count > 0)
+            _buffer.append(chunk, static_cast<size_t>(count));
+        else if (count == 0 || errno != EINTR)  /* The client left */
+            _dropClient();
+    }
+}
+
+void RenderServer::reply(const std::string& line)
+{
+    if (_clientFD < 0)
+        return;
+    std::string message = line + "\n";
+    const char* data = message.data();
+    size_t left = message.size();
+    while (left > 0) {
+        ssize_t count = send(_clientFD, data, left, 0);
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR)
+                continue;
+            _dropClient();
+            return;
+        }
+        data += count;
+        left -= static_cast<size_t>(count);
+    }
+}
+
+uint64_t RenderServer::serve(RenderServerScene& scene, SharedFrameRing& frames, glm::vec3 eye, glm::vec3 target, GLfloat fov)
+{
+    const SharedFrameHeader& header = frames.getHeader();
+    uint64_t frameNumber = 0;
+    std::string line;
+    while (readCommand(line)) {
+        std::istringstream arguments(line);
+        std::string command;
+        arguments >> command;
+
+        if (command == "hello")
+            reply("ok " + frames.getName() + " " + std::to_string(header.width) + " " + std::to_string(header.height) + " " +
+                  std::to_string(header.slotCount));
+        else if (command == "camera") {
+            glm::vec3 newEye, newTarget;
+            GLfloat newFOV;
+            if (!(arguments >> newEye.x >> newEye.y >> newEye.z >> newTarget.x >> newTarget.y >> newTarget.z)) {
+                reply("error usage: camera EX EY EZ TX TY TZ [FOV]");
+                continue;
+            }
+            eye = newEye;
+            target = newTarget;
+            if (arguments >> newFOV)
+                fov = glm::clamp(newFOV, 1.0f, 179.0f);
+            reply("ok");
+        }
+        else if (command == "mesh") {
+            std::string path;
+            glm::vec3 pos;
+            GLfloat scale;
+            GLuint entity;
+            if (!(arguments >> path >> pos.x >> pos.y >> pos.z >> scale))
+                reply("error usage: mesh PATH X Y Z SCALE");
+            else if (!scene.addMesh(path, pos, scale, entity))  /* The reason is on stderr */
+                reply("error cannot load " + path);
+            else
+                reply("ok " + std::to_string(entity));
+        }
+        else if (command == "light") {
+            GLuint index;
+            glm::vec3 pos, intensity;
+            if (!(arguments >> index >> pos.x >> pos.y >> pos.z >> intensity.r >> intensity.g >> intensity.b) || index > scene.getPointLightCount()) {
+                reply("error usage: light I X Y Z R G B, with I at most the light count");
+                continue;
+            }
+            scene.setPointLight(index, pos, intensity);
+            reply("ok");
+        }
+        else if (command == "render") {
+            GLuint slot = static_cast<GLuint>(frameNumber % header.slotCount);
+            scene.render(eye, target, fov, frames.beginWrite(slot));
+            frames.endWrite(slot, frameNumber);
+            reply("frame " + std::to_string(slot) + " " + std::to_string(frameNumber));
+            frameNumber++;
+        }
+        else if (command == "shutdown") {
+            reply("ok");
+            break;
+        }
+        else
+            reply("error unknown command \"" + command + "\"");
+    }
+    return frameNumber;
+}
+
+void RenderServer::close(void)
+{
+    if (_clientFD >= 0)
+        ::close(_clientFD);
+    ::close(_listenFD);
+    unlink(_socketPath.c_str());
+}
+
+void RenderServer::_dropClient(void)
+{
+    if (_clientFD >= 0)
+        ::close(_clientFD);
+    _clientFD = -1;
+    _buffer.clear();
+}
+
+/* Blocking line client for benchmarkRenderServer() */
+static GLboolean sendLine(int fd, const std::string& line)
+{
+    std::string message = line + "\n";
+    return send(fd, message.data(), message.size(), 0) == static_cast<ssize_t>(message.size());
+}
+
+static GLboolean receiveLine(int fd, std::string& buffer, std::string& line)
+{
+    size_t end;
+    while ((end = buffer.find('\n')) == std::string::npos) {
+        char chunk[4096];
+        ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0)
+            return GL_FALSE;
+        buffer.append(chunk, static_cast<size_t>(count));
+    }
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    return GL_TRUE;
+}
+
+/* Orbit the camera around the scene, one "camera" and one "render" command per frame */
+void benchmarkRenderServer(const std::string& socketPath, GLuint frameCount)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "ERR: Failed to connect to " << socketPath << ": " << strerror(errno) << std::endl;
+        exit(1);
+    }
+
+    std::string buffer, line, status, shmName;
+    if (!sendLine(fd, "hello") || !receiveLine(fd, buffer, line)) {
+        std::cerr << "ERR: The render server did not answer" << std::endl;
+        exit(1);
+    }
+    std::istringstream(line) >> status >> shmName;
+    SharedFrameRing frames;
+    if (status != "ok" || !frames.openSharedFrameRing(shmName))
+        exit(1);
+    const SharedFrameHeader header = frames.getHeader();  /* Still needed after close() */
+
+    std::vector<double> latencies;
+    std::vector<unsigned char> pixels;
+    GLuint tornCount = 0;
+    uint64_t start = getTimeNs();
+    for (GLuint i = 0; i < frameCount; i++) {
+        GLfloat angle = glm::two_pi<GLfloat>() * i / frameCount;
+        std::ostringstream camera;
+        camera << "camera " << 20.0f * glm::sin(angle) << " 5 " << 20.0f * glm::cos(angle) << " 0 3 0";
+
+        uint64_t requestTime = getTimeNs();
+        if (!sendLine(fd, camera.str()) || !sendLine(fd, "render") ||
+            !receiveLine(fd, buffer, line) || !receiveLine(fd, buffer, line)) {
+            std::cerr << "ERR: The render server went away" << std::endl;
+            exit(1);
+        }
+        GLuint slot;
+        uint64_t frame;
+        std::istringstream reply(line);
+        if (!(reply >> status >> slot >> frame) || status != "frame") {
+            std::cerr << "ERR: Unexpected reply \"" << line << "\"" << std::endl;
+            exit(1);
+        }
+        tornCount += !frames.read(slot, frame, pixels);
+        latencies.push_back(1e-6 * (getTimeNs() - requestTime));
+    }
+    double seconds = 1e-9 * (getTimeNs() - start);
+    frames.close();
+    ::close(fd);
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "INF: " << frameCount << " frames of " << header.width << "x" << header.height << " in " << seconds << " s ("
+              << frameCount / seconds << " frames/s, " << frameCount * 4e-6 * header.width * header.height / seconds
+              << " MB/s through shared memory)" << std::endl;
+    if (!latencies.empty())
+        std::cout << "INF: Request latency p50 " << latencies[latencies.size() / 2] << " ms, p95 " << latencies[latencies.size() * 95 / 100]
+                  << " ms, max " << latencies.back() << " ms" << std::endl;
+    if (tornCount) {
+        std::cerr << "ERR: " << tornCount << " frames were overwritten while being read" << std::endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Start of the shared memory of a SharedFrameRing */
+struct SharedFrameHeader {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint32_t width, height;
+    uint64_t slotSize;  /* Bytes from one slot to the next */
+};
+
+/* Start of every slot, followed by width * height RGBA8 pixels */
+struct SharedFrameSlot {
+    std::atomic<uint64_t> sequence;
+};
+
+/*
+Finished frames shared with other processes through POSIX shared memory, so
+that images never go through a socket. The memory holds a SharedFrameHeader
+and slotCount slots of RGBA8 pixels, bottom row first as OpenGL reads them.
+
+A slot's sequence is odd while the server writes it and 2 * (frame + 1)
+once frame is written; read() copies the pixels and checks that the
+sequence did not change meanwhile, so a reader that fell slotCount frames
+behind gets an error rather than a torn image.
+*/
+class SharedFrameRing
+{
+public:
+    static const uint32_t MAGIC = 0x52465247;  /* "GRFR" */
+
+    GLboolean createSharedFrameRing(const std::string& name, GLuint width, GLuint height, GLuint slotCount);
+    GLboolean openSharedFrameRing(const std::string& name);
+    unsigned char* beginWrite(GLuint slot);
+    void endWrite(GLuint slot, uint64_t frame);
+    GLboolean read(GLuint slot, uint64_t frame, std::vector<unsigned char>& rgba) const;
+    const SharedFrameHeader& getHeader(void) const;
+    const std::string& getName(void) const;
+    void close(void);
+
+private:
+    std::string _name;
+    unsigned char* _base;
+    size_t _size;
+    GLboolean _owner;  /* Unlinks the memory on close() */
+
+    SharedFrameSlot* _getSlot(GLuint slot) const;
+    static GLboolean _fitsSlots(const SharedFrameHeader& header, size_t size);
+};
+
+/* The scene a RenderServer's commands edit and draw, implemented by the caller on the thread owning the context */
+class RenderServerScene
+{
+public:
+    virtual ~RenderServerScene() {}
+
+    virtual GLboolean addMesh(const std::string& path, glm::vec3 pos, GLfloat scale, GLuint& entity) = 0;  /* GL_FALSE if the OBJ does not load */
+    virtual GLuint getPointLightCount(void) const = 0;
+    virtual void setPointLight(GLuint index, glm::vec3 pos, glm::vec3 intensity) = 0;  /* index == getPointLightCount() adds one */
+    virtual void render(glm::vec3 eye, glm::vec3 target, GLfloat fov, unsigned char* rgba) = 0;  /* Into a slot of the frame ring */
+};
+
+/*
+Unix domain socket taking one text command per line from one client at a
+time. readCommand() blocks until the next line, accepting a new client
+whenever the previous one has left, and reply() answers it with one line.
+A client sending more than MAX_LINE_LENGTH bytes without a newline is
+dropped.
+
+serve() runs the command set below against a RenderServerScene until
+"shutdown". Every command line gets one reply line, starting with "error"
+when the command failed:
+    hello                           ok SHM_NAME WIDTH HEIGHT SLOTS
+    camera EX EY EZ TX TY TZ [FOV]  ok (look from the eye at the target)
+    mesh PATH X Y Z SCALE           ok ENTITY (an OBJ file in a plain white material)
+    light I X Y Z R G B             ok (move point light I and set its intensity; I = count adds one)
+    render                          frame SLOT FRAME
+    shutdown                        ok, then serve() returns
+A frame is rendered straight into the SLOT of the shared frame ring; the
+reply only says where.
+*/
+class RenderServer
+{
+public:
+    static const size_t MAX_LINE_LENGTH = 4096;
+
+    GLboolean setupRenderServer(const std::string& socketPath);
+    GLboolean readCommand(std::string& line);  /* GL_FALSE on a socket error */
+    void reply(const std::string& line);
+    uint64_t serve(RenderServerScene& scene, SharedFrameRing& frames, glm::vec3 eye, glm::vec3 target, GLfloat fov);  /* Frames served */
+    void close(void);
+
+private:
+    std::string _socketPath, _buffer;
+    int _listenFD, _clientFD;
+
+    void _dropClient(void);
+};
+
+/* Render frameCount frames through a running server and report the frame rate and the latency */
+void benchmarkRenderServer(const std::string& socketPath, GLuint frameCount);
@@ -2,19 +2,24 @@
 
 #include "glm/gtc/type_ptr.hpp"
 
+#include "device/device.h"
+#include "profiler/profiler.h"
+
 #include <fstream>
 
-void Shader::setupShader(const char* vertexPath, const char* fragmentPath)
+/* "defines" holds extra preprocessor lines (e.g. "#define FOO\n") inserted after #version */
+void Shader::setupShader(const char* vertexPath, const char* fragmentPath, const std::string& defines)
 {
-    unsigned int vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-    unsigned int fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+    PROFILE_SCOPE("Shader::setupShader");
+    unsigned int vertexShaderID = getRenderDevice().createShader(GL_VERTEX_SHADER);
+    unsigned int fragmentShaderID = getRenderDevice().createShader(GL_FRAGMENT_SHADER);
 
     const GLchar* vCode;
     std::cout << "INF: Loading vertex shader " << vertexPath << "..." << std::endl;
-    std::string temp = _readShaderCode(vertexPath);
+    std::string temp = _injectDefines(_readShaderCode(vertexPath), defines);
     vCode = temp.c_str();
-    glShaderSource(vertexShaderID, 1, &vCode, NULL);
-    glCompileShader(vertexShaderID);
+    getRenderDevice().shaderSource(vertexShaderID, 1, &vCode, NULL);
+    getRenderDevice().compileShader(vertexShaderID);
     if (!_checkShaderStatus(vertexShaderID)) {
         std::cerr << "ERR: Failed to compile vertex shader " << vertexPath << std::endl;
         exit(1);
@@ -22,93 +27,98 @@ void Shader::setupShader(const char* vertexPath, const char* fragmentPath)
 
     const GLchar* fCode;
     std::cout << "INF: Loading fragment shader " << fragmentPath << "..." << std::endl;
-    temp = _readShaderCode(fragmentPath);
+    temp = _injectDefines(_readShaderCode(fragmentPath), defines);
     fCode = temp.c_str();
-    glShaderSource(fragmentShaderID, 1, &fCode, NULL);
-    glCompileShader(fragmentShaderID);
+    getRenderDevice().shaderSource(fragmentShaderID, 1, &fCode, NULL);
+    getRenderDevice().compileShader(fragmentShaderID);
     if (!_checkShaderStatus(fragmentShaderID)) {
         std::cerr << "ERR: Failed to compile fragment shader " << fragmentPath << std::endl;
         exit(1);
     }
 
-    _ID = glCreateProgram();
+    _ID = getRenderDevice().createProgram();
 
-    glAttachShader(_ID, vertexShaderID);
-    glAttachShader(_ID, fragmentShaderID);
-    glLinkProgram(_ID);
+    getRenderDevice().attachShader(_ID, vertexShaderID);
+    getRenderDevice().attachShader(_ID, fragmentShaderID);
+    getRenderDevice().linkProgram(_ID);
 
     if (!_checkProgramStatus(_ID))
         return;
 
-    glDeleteShader(vertexShaderID);
-    glDeleteShader(fragmentShaderID);
+    getRenderDevice().deleteShader(vertexShaderID);
+    getRenderDevice().deleteShader(fragmentShaderID);
 
-    glUseProgram(0);
+    getRenderDevice().useProgram(0);
 }
 
 void Shader::use() const
 {
-	glUseProgram(_ID);
+	getRenderDevice().useProgram(_ID);
+}
+
+void Shader::setBool(const char* name, GLboolean value) const
+{
+    getRenderDevice().uniform1i(_getUniformLocation(name), (GLint)value);
 }
 
-void Shader::setBool(const std::string& name, GLboolean value) const
+void Shader::setInt(const char* name, GLint value) const
 {
-    glUniform1i(_getUniformLocation(name), (GLint)value);
+    getRenderDevice().uniform1i(_getUniformLocation(name), value);
 }
 
-void Shader::setInt(const std::string& name, GLint value) const
+void Shader::setFloat(const char* name, GLfloat value) const
 {
-    glUniform1i(_getUniformLocation(name), value);
+    getRenderDevice().uniform1f(_getUniformLocation(name), value);
 }
 
-void Shader::setFloat(const std::string& name, GLfloat value) const
+void Shader::setVec2(const char* name, glm::vec2 value) const
 {
-    glUniform1f(_getUniformLocation(name), value);
+    getRenderDevice().uniform2fv(_getUniformLocation(name), 1, glm::value_ptr(value));
 }
 
-void Shader::setVec2(const std::string& name, glm::vec2 value) const
+void Shader::setVec2(const char* name, GLfloat x, GLfloat y) const
 {
-    glUniform2fv(_getUniformLocation(name), 1, glm::value_ptr(value));
+    getRenderDevice().uniform2f(_getUniformLocation(name), x, y);
 }
 
-void Shader::setVec2(const std::string& name, GLfloat x, GLfloat y) const
+void Shader::setVec3(const char* name, glm::vec3 value) const
 {
-    glUniform2f(_getUniformLocation(name), x, y);
+    getRenderDevice().uniform3fv(_getUniformLocation(name), 1, glm::value_ptr(value));
 }
 
-void Shader::setVec3(const std::string& name, glm::vec3 value) const
+void Shader::setVec3(const char* name, GLfloat x, GLfloat y, GLfloat z) const
 {
-    glUniform3fv(_getUniformLocation(name), 1, glm::value_ptr(value));
+    getRenderDevice().uniform3f(_getUniformLocation(name), x, y, z);
 }
 
-void Shader::setVec3(const std::string& name, GLfloat x, GLfloat y, GLfloat z) const
+void Shader::setVec4(const char* name, glm::vec4 value) const
 {
-    glUniform3f(_getUniformLocation(name), x, y, z);
+    getRenderDevice().uniform4fv(_getUniformLocation(name), 1, glm::value_ptr(value));
 }
 
-void Shader::setVec4(const std::string& name, glm::vec4 value) const
+void Shader::setVec4(const char* name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const
 {
-    glUniform4fv(_getUniformLocation(name), 1, glm::value_ptr(value));
+    getRenderDevice().uniform4f(_getUniformLocation(name), x, y, z, w);
 }
 
-void Shader::setVec4(const std::string& name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const
+void Shader::setIVec3(const char* name, glm::ivec3 value) const
 {
-    glUniform4f(_getUniformLocation(name), x, y, z, w);
+    getRenderDevice().uniform3iv(_getUniformLocation(name), 1, glm::value_ptr(value));
 }
 
-void Shader::setMat2(const std::string& name, glm::mat2 value) const
+void Shader::setMat2(const char* name, glm::mat2 value) const
 {
-    glUniformMatrix2fv(_getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+    getRenderDevice().uniformMatrix2fv(_getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setMat3(const std::string& name, glm::mat3 value) const
+void Shader::setMat3(const char* name, glm::mat3 value) const
 {
-    glUniformMatrix3fv(_getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+    getRenderDevice().uniformMatrix3fv(_getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Shader::setMat4(const std::string& name, glm::mat4 value) const
+void Shader::setMat4(const char* name, glm::mat4 value) const
 {
-	glUniformMatrix4fv(_getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+	getRenderDevice().uniformMatrix4fv(_getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
 std::string Shader::_readShaderCode(const char* fileName) const
@@ -125,28 +135,40 @@ std::string Shader::_readShaderCode(const char* fileName) const
 	);
 }
 
+std::string Shader::_injectDefines(const std::string& code, const std::string& defines) const
+{
+	if (defines.empty())
+		return code;
+
+	/* #version has to stay the first directive, so insert right after its line */
+	size_t pos = code.find("#version");
+	pos = (pos == std::string::npos) ? 0 : code.find('\n', pos);
+	pos = (pos == std::string::npos) ? code.size() : pos + 1;
+	return code.substr(0, pos) + defines + code.substr(pos);
+}
+
 bool Shader::_checkShaderStatus(GLuint shaderID) const
 {
-	return _checkStatus(shaderID, glGetShaderiv, glGetShaderInfoLog, GL_COMPILE_STATUS);
+	return _checkStatus(shaderID, &RenderDevice::getShaderiv, &RenderDevice::getShaderInfoLog, GL_COMPILE_STATUS);
 }
 
 bool Shader::_checkProgramStatus(GLuint programID) const
 {
-	return _checkStatus(programID, glGetProgramiv, glGetProgramInfoLog, GL_LINK_STATUS);
+	return _checkStatus(programID, &RenderDevice::getProgramiv, &RenderDevice::getProgramInfoLog, GL_LINK_STATUS);
 }
 
-bool Shader::_checkStatus(GLuint objectID, PFNGLGETSHADERIVPROC objectPropertyGetterFunc, PFNGLGETSHADERINFOLOGPROC getInfoLogFunc, GLenum statusType) const
+bool Shader::_checkStatus(GLuint objectID, ObjectPropertyGetter objectPropertyGetterFunc, InfoLogGetter getInfoLogFunc, GLenum statusType) const
 {
 	GLint status;
-	objectPropertyGetterFunc(objectID, statusType, &status);
+	(getRenderDevice().*objectPropertyGetterFunc)(objectID, statusType, &status);
 	if (status != GL_TRUE)
 	{
 		GLint infoLogLength;
-		objectPropertyGetterFunc(objectID, GL_INFO_LOG_LENGTH, &infoLogLength);
+		(getRenderDevice().*objectPropertyGetterFunc)(objectID, GL_INFO_LOG_LENGTH, &infoLogLength);
 		GLchar* buffer = new GLchar[infoLogLength];
 
 		GLsizei bufferSize;
-		getInfoLogFunc(objectID, infoLogLength, &bufferSize, buffer);
+		(getRenderDevice().*getInfoLogFunc)(objectID, infoLogLength, &bufferSize, buffer);
 		std::cout << buffer << std::endl;
 
 		delete[] buffer;
@@ -155,7 +177,7 @@ bool Shader::_checkStatus(GLuint objectID, PFNGLGETSHADERIVPROC objectPropertyGe
 	return true;
 }
 
-GLint Shader::_getUniformLocation(const std::string& name) const
+GLint Shader::_getUniformLocation(const char* name) const
 {
-    return glGetUniformLocation(_ID, name.c_str());
+    return getRenderDevice().getUniformLocation(_ID, name);
 }
@@ -3,36 +3,62 @@
 #include "GL/glew.h"
 #include "glm/glm.hpp"
 
+#include "device/device.h"
+
+#include <cstdio>
 #include <string>
 #include <iostream>
 
 class Shader {
 public:
-	void setupShader(const char* vertexPath, const char* fragmentPath);
+	void setupShader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
     void use() const;
-    void setBool(const std::string& name, GLboolean value) const;
-    void setInt(const std::string& name, GLint value) const;
-    void setFloat(const std::string& name, GLfloat value) const;
-    void setVec2(const std::string& name, glm::vec2 value) const;
-    void setVec2(const std::string& name, GLfloat x, GLfloat y) const;
-    void setVec3(const std::string& name, glm::vec3 value) const;
-    void setVec3(const std::string& name, GLfloat x, GLfloat y, GLfloat z) const;
-    void setVec4(const std::string& name, glm::vec4 value) const;
-    void setVec4(const std::string& name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const;
-    void setMat2(const std::string& name, glm::mat2 value) const;
-    void setMat3(const std::string& name, glm::mat3 value) const;
-    void setMat4(const std::string& name, glm::mat4 value) const;
+    void setBool(const char* name, GLboolean value) const;
+    void setInt(const char* name, GLint value) const;
+    void setFloat(const char* name, GLfloat value) const;
+    void setVec2(const char* name, glm::vec2 value) const;
+    void setVec2(const char* name, GLfloat x, GLfloat y) const;
+    void setVec3(const char* name, glm::vec3 value) const;
+    void setVec3(const char* name, GLfloat x, GLfloat y, GLfloat z) const;
+    void setVec4(const char* name, glm::vec4 value) const;
+    void setVec4(const char* name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const;
+    void setIVec3(const char* name, glm::ivec3 value) const;
+    void setMat2(const char* name, glm::mat2 value) const;
+    void setMat3(const char* name, glm::mat3 value) const;
+    void setMat4(const char* name, glm::mat4 value) const;
 
 private:
+	typedef void (RenderDevice::*ObjectPropertyGetter)(GLuint, GLenum, GLint*);
+	typedef void (RenderDevice::*InfoLogGetter)(GLuint, GLsizei, GLsizei*, GLchar*);
+
 	unsigned int _ID;
 
 	std::string _readShaderCode(const char* fileName) const;
+	std::string _injectDefines(const std::string& code, const std::string& defines) const;
 	bool _checkShaderStatus(GLuint shaderID) const;
 	bool _checkProgramStatus(GLuint programID) const;
 	bool _checkStatus(
 		GLuint objectID,
-		PFNGLGETSHADERIVPROC objectPropertyGetterFunc,
-		PFNGLGETSHADERINFOLOGPROC getInfoLogFunc,
+		ObjectPropertyGetter objectPropertyGetterFunc,
+		InfoLogGetter getInfoLogFunc,
 		GLenum statusType) const;
-    GLint _getUniformLocation(const std::string& name) const;
+    GLint _getUniformLocation(const char* name) const;
+};
+
+/*
+Name of a member of a uniform array element, e.g. UniformName("dirLights", 0,
+"dir") for "dirLights[0].dir", built in a fixed buffer so that setting
+per-frame uniforms never allocates.
+*/
+class UniformName
+{
+public:
+    UniformName(const char* array, GLuint index, const char* member)
+    {
+        snprintf(_name, sizeof(_name), "%s[%u].%s", array, index, member);
+    }
+    operator const char*() const { return _name; }
+
+private:
+    char _name[64];
 };
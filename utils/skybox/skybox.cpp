@@ -1,5 +1,7 @@
 #include "skybox.h"
 
+#include "device/device.h"
+
 void Skybox::setupSkybox(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> texPaths)
 {
     _skyboxShader.setupShader(vertexPath, fragmentPath);
@@ -50,23 +52,23 @@ void Skybox::setupSkybox(const char* vertexPath, const char* fragmentPath, const
          1.0f, -1.0f,  1.0f,
     };
 
-    glGenVertexArrays(1, &_skyboxVAO);
-    glGenBuffers(1, &vboID);
-    glBindVertexArray(_skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, vboID);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+    getRenderDevice().genVertexArrays(1, &_skyboxVAO);
+    getRenderDevice().genBuffers(1, &vboID);
+    getRenderDevice().bindVertexArray(_skyboxVAO);
+    getRenderDevice().bindBuffer(GL_ARRAY_BUFFER, vboID);
+    getRenderDevice().bufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    getRenderDevice().enableVertexAttribArray(0);
+    getRenderDevice().vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
 }
 
 void Skybox::draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix) {
-    glDepthFunc(GL_LEQUAL);
+    getRenderDevice().depthFunc(GL_LEQUAL);
     _skyboxShader.use();
-    glBindVertexArray(_skyboxVAO);
+    getRenderDevice().bindVertexArray(_skyboxVAO);
     _skyboxShader.setMat4("viewMatrix", glm::mat4(glm::mat3(viewMatrix)));
     _skyboxShader.setMat4("projectionMatrix", projectionMatrix);
     _skyboxShader.setInt("skybox", 0);
     _skyboxTex.bindCubemap(0);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glDepthFunc(GL_LESS);
+    getRenderDevice().drawArrays(GL_TRIANGLES, 0, 36);
+    getRenderDevice().depthFunc(GL_LESS);
 }
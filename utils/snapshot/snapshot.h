@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+/*
+Hands immutable snapshots from a producer thread to a consumer thread
+through two slots. The producer fills one slot while the consumer reads the
+other, and waits for the consumer to take each snapshot before starting the
+next, so it runs at most one frame ahead.
+*/
+template <typename T>
+class SnapshotExchange
+{
+public:
+    /* Producer: the slot to fill, or NULL once closed */
+    T* beginWrite(void)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _taken.wait(lock, [this] { return _ready < 0 || _closed; });
+        return _closed ? NULL : &_slots[_write];
+    }
+
+    void publish(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _ready = _write;
+            _write = 1 - _write;
+        }
+        _published.notify_one();
+    }
+
+    /* Consumer: the next snapshot, valid until the following acquire(), or NULL once closed */
+    const T* acquire(void)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _published.wait(lock, [this] { return _ready >= 0 || _closed; });
+        if (_ready < 0)
+            return NULL;
+        int slot = _ready;
+        _ready = -1;
+        lock.unlock();
+        _taken.notify_one();
+        return &_slots[slot];
+    }
+
+    void close(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _published.notify_all();
+        _taken.notify_all();
+    }
+
+private:
+    T _slots[2];
+    int _write = 0;
+    int _ready = -1;  /* Published slot not yet taken by the consumer */
+    bool _closed = false;
+    std::mutex _mutex;
+    std::condition_variable _published, _taken;
+};
@@ -0,0 +1,603 @@
+#include "software.h"
+
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/* ----- Four float lanes, one per pixel of a 2x2 quad ----- */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+struct Lanes {
+    __m128 v;
+};
+
+static inline Lanes lanes(GLfloat a, GLfloat b, GLfloat c, GLfloat d) { return {_mm_setr_ps(a, b, c, d)}; }
+static inline Lanes lanes(GLfloat a) { return {_mm_set1_ps(a)}; }
+static inline Lanes loadLanes(const GLfloat* p) { return {_mm_loadu_ps(p)}; }
+static inline Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+static inline Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+static inline Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+static inline int greaterMask(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+static inline int equalMask(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmpeq_ps(a.v, b.v)); }
+static inline int lessMask(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+static inline void storeLanes(GLfloat* p, Lanes a) { _mm_storeu_ps(p, a.v); }
+#else
+struct Lanes {
+    GLfloat v[4];
+};
+
+static inline Lanes lanes(GLfloat a, GLfloat b, GLfloat c, GLfloat d) { return {{a, b, c, d}}; }
+static inline Lanes lanes(GLfloat a) { return {{a, a, a, a}}; }
+static inline Lanes loadLanes(const GLfloat* p) { return {{p[0], p[1], p[2], p[3]}}; }
+static inline Lanes operator+(Lanes a, Lanes b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+static inline Lanes operator-(Lanes a, Lanes b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+static inline Lanes operator*(Lanes a, Lanes b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+static inline int greaterMask(Lanes a, Lanes b) { return (a.v[0] > b.v[0]) | (a.v[1] > b.v[1]) << 1 | (a.v[2] > b.v[2]) << 2 | (a.v[3] > b.v[3]) << 3; }
+static inline int equalMask(Lanes a, Lanes b) { return (a.v[0] == b.v[0]) | (a.v[1] == b.v[1]) << 1 | (a.v[2] == b.v[2]) << 2 | (a.v[3] == b.v[3]) << 3; }
+static inline int lessMask(Lanes a, Lanes b) { return (a.v[0] < b.v[0]) | (a.v[1] < b.v[1]) << 1 | (a.v[2] < b.v[2]) << 2 | (a.v[3] < b.v[3]) << 3; }
+static inline void storeLanes(GLfloat* p, Lanes a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+#endif
+/* ---------------------------------------------------------- */
+
+static const GLfloat SUBPIXELS = 256.0f;
+
+static glm::vec4 fetchTexel(const unsigned char* texels, GLint width, GLint x, GLint y)
+{
+    const unsigned char* t = texels + (static_cast<size_t>(y) * width + x) * 4;
+    return glm::vec4(t[0], t[1], t[2], t[3]) * (1.0f / 255.0f);
+}
+
+/* GL_LINEAR filtering of one level, wrapping with GL_REPEAT or GL_CLAMP_TO_EDGE */
+static glm::vec4 sampleBilinear(const unsigned char* texels, GLint width, GLint height, glm::vec2 uv, GLboolean repeat)
+{
+    if (repeat)
+        uv -= glm::floor(uv);
+    GLfloat x = uv.x * width - 0.5f, y = uv.y * height - 0.5f;
+    GLfloat fx = glm::floor(x), fy = glm::floor(y);
+    GLint x0 = static_cast<GLint>(fx), y0 = static_cast<GLint>(fy);
+    GLint x1 = x0 + 1, y1 = y0 + 1;
+    if (repeat) {
+        x0 = (x0 % width + width) % width;
+        x1 = x1 % width;
+        y0 = (y0 % height + height) % height;
+        y1 = y1 % height;
+    }
+    else {
+        x0 = CLAMP(x0, 0, width - 1);
+        x1 = CLAMP(x1, 0, width - 1);
+        y0 = CLAMP(y0, 0, height - 1);
+        y1 = CLAMP(y1, 0, height - 1);
+    }
+    GLfloat tx = x - fx, ty = y - fy;
+    glm::vec4 bottom = glm::mix(fetchTexel(texels, width, x0, y0), fetchTexel(texels, width, x1, y0), tx);
+    glm::vec4 top = glm::mix(fetchTexel(texels, width, x0, y1), fetchTexel(texels, width, x1, y1), tx);
+    return glm::mix(bottom, top, ty);
+}
+
+void SoftwareRenderer::setupSoftwareRenderer(GLint width, GLint height, JobSystem* jobSystem)
+{
+    _width = width;
+    _height = height;
+    _tileColumns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    _tileRows = (height + TILE_SIZE - 1) / TILE_SIZE;
+    _jobSystem = jobSystem;
+    _hasSkybox = GL_FALSE;
+    _bins.assign(static_cast<size_t>(_tileColumns) * _tileRows, std::vector<_TriangleRef>());
+    _pixels.assign(static_cast<size_t>(width) * height * 3, 0);
+    std::cout << "INF: Software renderer draws " << width << "x" << height << " in " << _tileColumns * _tileRows << " tiles on "
+              << jobSystem->getThreadCount() << " threads"
+#if defined(__SSE2__)
+              << " (SSE2)"
+#endif
+              << std::endl;
+}
+
+GLuint SoftwareRenderer::addMesh(const Model& model)
+{
+    _meshes.push_back({model.vertices, std::vector<GLuint>(model.indices.begin(), model.indices.end())});
+    return static_cast<GLuint>(_meshes.size() - 1);
+}
+
+/* Missing maps get the same colors as Material::setupMaterial() gives them */
+GLuint SoftwareRenderer::addMaterial(const char* diffusePath, const char* specularPath, const char* normalPath, GLfloat shininess)
+{
+    _Material material;
+    material.diffuse = _loadTexture(diffusePath, glm::vec4(1.0f), GL_FALSE);
+    material.specular = _loadTexture(specularPath, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), GL_FALSE);
+    material.normal = _loadTexture(normalPath, glm::vec4(0.5f, 0.5f, 1.0f, 1.0f), GL_FALSE);
+    material.shininess = shininess;
+
+    const _Texture& normal = _textures[material.normal];
+    glm::vec3 delta = glm::abs(glm::vec3(normal.constantColor) - glm::vec3(0.5f, 0.5f, 1.0f));
+    material.flatNormal = normal.constant && glm::max(glm::max(delta.x, delta.y), delta.z) <= 1.0f / 255.0f;
+
+    _materials.push_back(material);
+    return static_cast<GLuint>(_materials.size() - 1);
+}
+
+GLuint SoftwareRenderer::getMaterialCount(void) const
+{
+    return static_cast<GLuint>(_materials.size());
+}
+
+void SoftwareRenderer::setupSkybox(const std::vector<std::string>& facePaths)
+{
+    for (GLuint i = 0; i < 6; i++)
+        _skyboxFaces[i] = _loadTexture(facePaths[i].c_str(), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), GL_TRUE);
+    _hasSkybox = GL_TRUE;
+}
+
+void SoftwareRenderer::render(const SoftwareFrame& frame)
+{
+    _frame = &frame;
+    _viewProjection = frame.projectionMatrix * frame.viewMatrix;
+    _skyboxInverse = glm::inverse(frame.projectionMatrix * glm::mat4(glm::mat3(frame.viewMatrix)));  /* As Skybox::draw() */
+
+    /* ----- Setup ----- */
+    const std::vector<SoftwareDraw>& draws = *frame.draws;
+    _vertexOffsets.resize(draws.size() + 1);
+    _chunks.clear();
+    GLuint vertexCount = 0;
+    for (GLuint i = 0; i < draws.size(); i++) {
+        const _Mesh& mesh = _meshes[draws[i].meshID];
+        _vertexOffsets[i] = vertexCount;
+        vertexCount += static_cast<GLuint>(mesh.vertices.size());
+        for (GLuint first = 0; first < mesh.indices.size(); first += 3 * SETUP_CHUNK)
+            _chunks.push_back({i, first, MIN(3 * SETUP_CHUNK, static_cast<GLuint>(mesh.indices.size()) - first)});
+    }
+    _vertexOffsets[draws.size()] = vertexCount;
+    _clipVertices.resize(vertexCount);
+    _jobSystem->parallelFor(vertexCount, 4096, [this](GLuint begin, GLuint end) { _transformVertices(begin, end); });
+
+    if (_chunkTriangles.size() < _chunks.size()) {
+        _chunkTriangles.resize(_chunks.size());
+        _chunkRows.resize(_chunks.size());
+    }
+    _jobSystem->parallelFor(static_cast<GLuint>(_chunks.size()), 1, [this](GLuint begin, GLuint end) {
+        for (GLuint i = begin; i < end; i++)
+            _setupChunk(i);
+    });
+    /* ----------------- */
+
+    _jobSystem->parallelFor(static_cast<GLuint>(_tileRows), 1, [this](GLuint begin, GLuint end) {
+        for (GLuint row = begin; row < end; row++)
+            _binRow(static_cast<GLint>(row));
+    });
+    _jobSystem->parallelFor(static_cast<GLuint>(_tileColumns * _tileRows), 1, [this](GLuint begin, GLuint end) {
+        for (GLuint tile = begin; tile < end; tile++)
+            _rasterizeTile(static_cast<GLint>(tile));
+    });
+}
+
+const std::vector<unsigned char>& SoftwareRenderer::getPixels(void) const
+{
+    return _pixels;
+}
+
+GLuint SoftwareRenderer::getTriangleCount(void) const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < _chunks.size(); i++)
+        count += _chunkTriangles[i].size();
+    return static_cast<GLuint>(count);
+}
+
+/* Load an image as Texture does: 2D textures flipped and mipmapped, cubemap faces as they are */
+GLuint SoftwareRenderer::_loadTexture(const char* path, glm::vec4 fallback, GLboolean cubeFace)
+{
+    _Texture texture;
+    texture.constant = GL_TRUE;
+    texture.constantColor = fallback;
+
+    if (path) {
+        std::cout << "INF: Loading texture " << path << "..." << std::endl;
+        GLint width, height, channels;
+        stbi_set_flip_vertically_on_load(!cubeFace);
+        unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+        if (!data) {
+            std::cerr << "ERR: Failed to load " << path << std::endl;
+            exit(1);
+        }
+
+        std::vector<unsigned char> texels(static_cast<size_t>(width) * height * 4);
+        for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+            const unsigned char* src = data + i * channels;
+            texels[i * 4 + 0] = src[0];
+            texels[i * 4 + 1] = channels >= 3 ? src[1] : 0;  /* GL_RED leaves green and blue at 0 */
+            texels[i * 4 + 2] = channels >= 3 ? src[2] : 0;
+            texels[i * 4 + 3] = channels == 4 ? src[3] : 255;
+        }
+        stbi_image_free(data);
+
+        texture.constant = std::all_of(texels.begin(), texels.end(), [&](const unsigned char& t) { return t == texels[(&t - texels.data()) % 4]; });
+        texture.constantColor = fetchTexel(texels.data(), 1, 0, 0);
+        if (!texture.constant) {
+            texture.widths.push_back(width);
+            texture.heights.push_back(height);
+            texture.levels.push_back(std::move(texels));
+        }
+
+        /* Box-filtered mipmaps, as glGenerateMipmap */
+        while (!texture.constant && !cubeFace && (width > 1 || height > 1)) {
+            GLint levelWidth = MAX(width / 2, 1), levelHeight = MAX(height / 2, 1);
+            const std::vector<unsigned char>& source = texture.levels.back();
+            std::vector<unsigned char> level(static_cast<size_t>(levelWidth) * levelHeight * 4);
+            for (GLint y = 0; y < levelHeight; y++) {
+                for (GLint x = 0; x < levelWidth; x++) {
+                    GLint x0 = MIN(2 * x, width - 1), x1 = MIN(2 * x + 1, width - 1);
+                    GLint y0 = MIN(2 * y, height - 1), y1 = MIN(2 * y + 1, height - 1);
+                    for (GLint c = 0; c < 4; c++) {
+                        GLint sum = source[(static_cast<size_t>(y0) * width + x0) * 4 + c] + source[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                                    source[(static_cast<size_t>(y1) * width + x0) * 4 + c] + source[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                        level[(static_cast<size_t>(y) * levelWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+            width = levelWidth;
+            height = levelHeight;
+            texture.widths.push_back(width);
+            texture.heights.push_back(height);
+            texture.levels.push_back(std::move(level));
+        }
+    }
+
+    _textures.push_back(std::move(texture));
+    return static_cast<GLuint>(_textures.size() - 1);
+}
+
+/* Vertex stage of texture.vs for the clip vertices [begin, end) of all draws */
+void SoftwareRenderer::_transformVertices(GLuint begin, GLuint end)
+{
+    const std::vector<SoftwareDraw>& draws = *_frame->draws;
+    GLuint draw = static_cast<GLuint>(std::upper_bound(_vertexOffsets.begin(), _vertexOffsets.end() - 1, begin) - _vertexOffsets.begin() - 1);
+
+    while (begin < end) {
+        while (_vertexOffsets[draw + 1] <= begin)  /* Skip draws without vertices */
+            draw++;
+        const glm::mat4& modelMatrix = draws[draw].modelMatrix;
+        const glm::mat3 m(modelMatrix);
+        glm::mat3 normalMatrix(glm::cross(m[1], m[2]), glm::cross(m[2], m[0]), glm::cross(m[0], m[1]));  /* As texture.vs */
+        normalMatrix *= glm::dot(m[0], normalMatrix[0]) < 0.0f ? -1.0f : 1.0f;
+        const std::vector<Vertex>& vertices = _meshes[draws[draw].meshID].vertices;
+
+        GLuint drawEnd = MIN(end, _vertexOffsets[draw + 1]);
+        for (GLuint i = begin; i < drawEnd; i++) {
+            const Vertex& vertex = vertices[i - _vertexOffsets[draw]];
+            _ClipVertex& out = _clipVertices[i];
+            glm::vec4 worldPos = modelMatrix * glm::vec4(vertex.pos, 1.0f);
+            out.clipPos = _viewProjection * worldPos;
+            out.worldPos = glm::vec3(worldPos);
+            out.normal = normalMatrix * vertex.normal;
+            out.uv = vertex.uv;
+        }
+        begin = drawEnd;
+    }
+}
+
+/* Clip the triangles of a chunk against the near plane and set up the visible ones */
+void SoftwareRenderer::_setupChunk(GLuint chunk)
+{
+    const _Chunk& range = _chunks[chunk];
+    const std::vector<GLuint>& indices = _meshes[(*_frame->draws)[range.draw].meshID].indices;
+    const _ClipVertex* vertices = &_clipVertices[_vertexOffsets[range.draw]];
+    std::vector<_Triangle>& triangles = _chunkTriangles[chunk];
+    triangles.clear();
+
+    for (GLuint i = range.firstIndex; i < range.firstIndex + range.indexCount; i += 3) {
+        const _ClipVertex* corners[3] = {&vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]]};
+
+        /* Drop triangles entirely outside one of the clip planes */
+        int outside = ~0;
+        for (int v = 0; v < 3; v++) {
+            const glm::vec4& p = corners[v]->clipPos;
+            outside &= (p.x < -p.w) | (p.x > p.w) << 1 | (p.y < -p.w) << 2 | (p.y > p.w) << 3 | (p.z < -p.w) << 4 | (p.z > p.w) << 5;
+        }
+        if (outside)
+            continue;
+
+        GLboolean crossesNear = GL_FALSE;
+        for (int v = 0; v < 3; v++)
+            crossesNear = crossesNear || corners[v]->clipPos.z < -corners[v]->clipPos.w;
+        if (!crossesNear) {
+            _addTriangle(triangles, range.draw, *corners[0], *corners[1], *corners[2]);
+            continue;
+        }
+
+        /* Sutherland-Hodgman against z = -w, then a fan */
+        _ClipVertex polygon[4];
+        int count = 0;
+        for (int v = 0; v < 3; v++) {
+            const _ClipVertex& a = *corners[v];
+            const _ClipVertex& b = *corners[(v + 1) % 3];
+            GLfloat da = a.clipPos.z + a.clipPos.w, db = b.clipPos.z + b.clipPos.w;
+            if (da >= 0.0f)
+                polygon[count++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                GLfloat t = da / (da - db);
+                _ClipVertex& p = polygon[count++];
+                p.clipPos = glm::mix(a.clipPos, b.clipPos, t);
+                p.worldPos = glm::mix(a.worldPos, b.worldPos, t);
+                p.normal = glm::mix(a.normal, b.normal, t);
+                p.uv = glm::mix(a.uv, b.uv, t);
+            }
+        }
+        for (int v = 2; v < count; v++)
+            _addTriangle(triangles, range.draw, polygon[0], polygon[v - 1], polygon[v]);
+    }
+    _sortChunkByRow(chunk);
+}
+
+/* Counting sort of the triangles of a chunk by the tile rows they overlap, which keeps them in order within a row */
+void SoftwareRenderer::_sortChunkByRow(GLuint chunk)
+{
+    const std::vector<_Triangle>& triangles = _chunkTriangles[chunk];
+    std::vector<GLuint>& rowStarts = _chunkRows[chunk].rowStarts;
+    std::vector<GLuint>& sorted = _chunkRows[chunk].triangles;
+
+    rowStarts.assign(_tileRows + 1, 0);
+    for (const _Triangle& t : triangles)
+        for (GLint row = t.minY / TILE_SIZE; row <= t.maxY / TILE_SIZE; row++)
+            rowStarts[row + 1]++;
+    for (GLint row = 0; row < _tileRows; row++)
+        rowStarts[row + 1] += rowStarts[row];
+
+    /* Fill with rowStarts[r] as the cursor of row r, which leaves it at the start of row r + 1 */
+    sorted.resize(rowStarts[_tileRows]);
+    for (GLuint i = 0; i < triangles.size(); i++)
+        for (GLint row = triangles[i].minY / TILE_SIZE; row <= triangles[i].maxY / TILE_SIZE; row++)
+            sorted[rowStarts[row]++] = i;
+    for (GLint row = _tileRows; row > 0; row--)
+        rowStarts[row] = rowStarts[row - 1];
+    rowStarts[0] = 0;
+}
+
+/* Project a clipped triangle and set up its edge functions; back faces and empty triangles are dropped */
+void SoftwareRenderer::_addTriangle(std::vector<_Triangle>& triangles, GLuint draw, const _ClipVertex& a, const _ClipVertex& b,
+                                    const _ClipVertex& c) const
+{
+    const _ClipVertex* corners[3] = {&a, &b, &c};
+    _Triangle t;
+    for (int v = 0; v < 3; v++) {
+        const glm::vec4& clip = corners[v]->clipPos;
+        GLfloat invW = 1.0f / clip.w;
+        glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * _width, (clip.y * invW * 0.5f + 0.5f) * _height);
+        t.screen[v] = glm::round(screen * SUBPIXELS) / SUBPIXELS;
+        t.depth[v] = clip.z * invW * 0.5f + 0.5f;
+        t.invW[v] = invW;
+        t.posOverW[v] = corners[v]->worldPos * invW;
+        t.normalOverW[v] = corners[v]->normal * invW;
+        t.uvOverW[v] = corners[v]->uv * invW;
+    }
+
+    /* Counter-clockwise front faces, with y up as in OpenGL */
+    GLfloat area = (t.screen[1].x - t.screen[0].x) * (t.screen[2].y - t.screen[0].y) - (t.screen[2].x - t.screen[0].x) * (t.screen[1].y - t.screen[0].y);
+    if (!(area > 0.0f))
+        return;
+    t.invArea = 1.0f / area;
+
+    /* Pixels whose center is inside the bounds */
+    glm::vec2 low = glm::min(glm::min(t.screen[0], t.screen[1]), t.screen[2]);
+    glm::vec2 high = glm::max(glm::max(t.screen[0], t.screen[1]), t.screen[2]);
+    t.minX = MAX(static_cast<GLint>(glm::ceil(low.x - 0.5f)), 0);
+    t.minY = MAX(static_cast<GLint>(glm::ceil(low.y - 0.5f)), 0);
+    t.maxX = MIN(static_cast<GLint>(glm::floor(high.x - 0.5f)), _width - 1);
+    t.maxY = MIN(static_cast<GLint>(glm::floor(high.y - 0.5f)), _height - 1);
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return;
+
+    for (int e = 0; e < 3; e++) {
+        glm::vec2 from = t.screen[(e + 1) % 3], to = t.screen[(e + 2) % 3];
+        glm::vec2 direction = to - from;
+        t.topLeft[e] = direction.y < 0.0f || (direction.y == 0.0f && direction.x < 0.0f);
+        GLboolean swap = to.x < from.x || (to.x == from.x && to.y < from.y);
+        t.edgeOrigin[e] = swap ? to : from;
+        t.edgeDelta[e] = swap ? from - to : to - from;
+        t.edgeSign[e] = swap ? -1.0f : 1.0f;
+    }
+    t.draw = draw;
+    triangles.push_back(t);
+}
+
+/* List the triangles overlapping each tile of a row, in submission order: the chunks' lists for the row, chunk after chunk */
+void SoftwareRenderer::_binRow(GLint row)
+{
+    for (GLint column = 0; column < _tileColumns; column++)
+        _bins[row * _tileColumns + column].clear();
+
+    for (GLuint chunk = 0; chunk < _chunks.size(); chunk++) {
+        const std::vector<_Triangle>& triangles = _chunkTriangles[chunk];
+        const _ChunkRows& rows = _chunkRows[chunk];
+        for (GLuint k = rows.rowStarts[row]; k < rows.rowStarts[row + 1]; k++) {
+            const GLuint i = rows.triangles[k];
+            const _Triangle& t = triangles[i];
+            for (GLint column = t.minX / TILE_SIZE; column <= t.maxX / TILE_SIZE; column++)
+                _bins[row * _tileColumns + column].push_back({chunk, i});
+        }
+    }
+}
+
+void SoftwareRenderer::_rasterizeTile(GLint tile)
+{
+    const GLint tileX = (tile % _tileColumns) * TILE_SIZE, tileY = (tile / _tileColumns) * TILE_SIZE;
+    const GLint tileRight = MIN(tileX + TILE_SIZE, _width) - 1, tileTop = MIN(tileY + TILE_SIZE, _height) - 1;
+    const GLint quadColumns = TILE_SIZE / 2;
+
+    /* Depth of the quad (x, y) is at depth[((y / 2) * quadColumns + x / 2) * 4], one lane per pixel */
+    GLfloat depth[TILE_SIZE * TILE_SIZE];
+    std::fill(depth, depth + TILE_SIZE * TILE_SIZE, 1.0f);
+
+    for (const _TriangleRef& ref : _bins[tile]) {
+        const _Triangle& t = _chunkTriangles[ref.chunk][ref.triangle];
+        const SoftwareDraw& draw = (*_frame->draws)[t.draw];
+        const GLint x0 = MAX(t.minX, tileX) & ~1, x1 = MIN(t.maxX, tileRight);
+        const GLint y0 = MAX(t.minY, tileY) & ~1, y1 = MIN(t.maxY, tileTop);
+
+        for (GLint y = y0; y <= y1; y += 2) {
+            const Lanes py = lanes(y + 0.5f, y + 0.5f, y + 1.5f, y + 1.5f);
+            const int rowMask = y + 1 <= tileTop ? 0xF : 0x3;
+            for (GLint x = x0; x <= x1; x += 2) {
+                const Lanes px = lanes(x + 0.5f, x + 1.5f, x + 0.5f, x + 1.5f);
+                int mask = rowMask & (x + 1 <= tileRight ? 0xF : 0x5);
+
+                Lanes edges[3];
+                for (int e = 0; e < 3 && mask; e++) {
+                    edges[e] = lanes(t.edgeSign[e]) * (lanes(t.edgeDelta[e].x) * (py - lanes(t.edgeOrigin[e].y)) -
+                                                       lanes(t.edgeDelta[e].y) * (px - lanes(t.edgeOrigin[e].x)));
+                    mask &= greaterMask(edges[e], lanes(0.0f)) | (t.topLeft[e] ? equalMask(edges[e], lanes(0.0f)) : 0);
+                }
+                if (!mask)
+                    continue;
+
+                const Lanes l0 = edges[0] * lanes(t.invArea), l1 = edges[1] * lanes(t.invArea), l2 = edges[2] * lanes(t.invArea);
+                const Lanes z = l0 * lanes(t.depth[0]) + l1 * lanes(t.depth[1]) + l2 * lanes(t.depth[2]);
+                GLfloat* quadDepth = &depth[(((y - tileY) / 2) * quadColumns + (x - tileX) / 2) * 4];
+                mask &= lessMask(z, loadLanes(quadDepth)) & ~lessMask(z, lanes(0.0f));
+                if (!mask)
+                    continue;
+
+                /* Perspective-correct attributes of all four lanes, for the derivatives */
+                GLfloat lambda[3][4], zs[4];
+                storeLanes(lambda[0], l0);
+                storeLanes(lambda[1], l1);
+                storeLanes(lambda[2], l2);
+                storeLanes(zs, z);
+                glm::vec3 pos[4], normal[4];
+                glm::vec2 uv[4];
+                for (int lane = 0; lane < 4; lane++) {
+                    GLfloat w = 1.0f / (lambda[0][lane] * t.invW[0] + lambda[1][lane] * t.invW[1] + lambda[2][lane] * t.invW[2]);
+                    pos[lane] = (lambda[0][lane] * t.posOverW[0] + lambda[1][lane] * t.posOverW[1] + lambda[2][lane] * t.posOverW[2]) * w;
+                    normal[lane] = (lambda[0][lane] * t.normalOverW[0] + lambda[1][lane] * t.normalOverW[1] + lambda[2][lane] * t.normalOverW[2]) * w;
+                    uv[lane] = (lambda[0][lane] * t.uvOverW[0] + lambda[1][lane] * t.uvOverW[1] + lambda[2][lane] * t.uvOverW[2]) * w;
+                }
+                const glm::vec3 dPos[2] = {pos[1] - pos[0], pos[2] - pos[0]};
+                const glm::vec2 dUV[2] = {uv[1] - uv[0], uv[2] - uv[0]};
+
+                for (int lane = 0; lane < 4; lane++) {
+                    if (!(mask & (1 << lane)))
+                        continue;
+                    quadDepth[lane] = zs[lane];
+                    glm::vec3 color = glm::clamp(_shade(draw, pos[lane], normal[lane], uv[lane], dPos, dUV), 0.0f, 1.0f);
+                    unsigned char* pixel = &_pixels[(static_cast<size_t>(y + lane / 2) * _width + x + lane % 2) * 3];
+                    for (int c = 0; c < 3; c++)
+                        pixel[c] = static_cast<unsigned char>(color[c] * 255.0f + 0.5f);
+                }
+            }
+        }
+    }
+
+    /* The skybox is drawn with GL_LEQUAL at the far plane, so it fills what is left */
+    for (GLint y = tileY; y <= tileTop; y++) {
+        for (GLint x = tileX; x <= tileRight; x++) {
+            if (depth[(((y - tileY) / 2) * quadColumns + (x - tileX) / 2) * 4 + (y & 1) * 2 + (x & 1)] < 1.0f)
+                continue;
+            glm::vec3 color(0.2f);  /* The clear color */
+            if (_hasSkybox) {
+                glm::vec4 p = _skyboxInverse * glm::vec4((x + 0.5f) / _width * 2.0f - 1.0f, (y + 0.5f) / _height * 2.0f - 1.0f, 1.0f, 1.0f);
+                color = glm::clamp(_sampleSkybox(glm::vec3(p) / p.w), 0.0f, 1.0f);
+            }
+            unsigned char* pixel = &_pixels[(static_cast<size_t>(y) * _width + x) * 3];
+            for (int c = 0; c < 3; c++)
+                pixel[c] = static_cast<unsigned char>(color[c] * 255.0f + 0.5f);
+        }
+    }
+}
+
+/* texture.fs with Blinn-Phong, for the point and directional lights of the frame */
+glm::vec3 SoftwareRenderer::_shade(const SoftwareDraw& draw, const glm::vec3& pos, const glm::vec3& normalWorld, const glm::vec2& uv,
+                                   const glm::vec3 dPos[2], const glm::vec2 dUV[2]) const
+{
+    const _Material& material = _materials[draw.materialID];
+    const glm::vec3 viewDir = glm::normalize(_frame->cameraPos - pos);
+
+    glm::vec3 normal = glm::normalize(normalWorld);
+    if (!material.flatNormal) {
+        glm::vec3 tangentNormal = glm::vec3(_sample(material.normal, uv, dUV)) * 2.0f - 1.0f;
+        glm::vec3 tangent = dPos[0] * dUV[1].t - dPos[1] * dUV[0].t;
+        if (glm::dot(tangent, tangent) > 0.0f) {
+            tangent = glm::normalize(tangent);
+            glm::vec3 bitangent = -glm::normalize(glm::cross(normal, tangent));
+            normal = glm::normalize(glm::mat3(tangent, bitangent, normal) * tangentNormal);
+        }
+    }
+    const glm::vec3 diffuseColor = glm::vec3(_sample(material.diffuse, uv, dUV));
+    const glm::vec3 specularColor = glm::vec3(_sample(material.specular, uv, dUV));
+
+    glm::vec3 result = draw.emissionK + _frame->ambientK * diffuseColor;
+    for (const PointLight& light : *_frame->pointLights) {
+        glm::vec3 lightDir = glm::normalize(light.pos - pos);
+        GLfloat diff = glm::max(glm::dot(lightDir, normal), 0.0f);
+        GLfloat spec = glm::pow(glm::max(glm::dot(normal, glm::normalize(lightDir + viewDir)), 0.0f), material.shininess);
+        GLfloat dist = glm::length(light.pos - pos);
+        GLfloat attenuation = glm::min(1.0f / (light.attenuation.a + light.attenuation.b * dist + light.attenuation.c * dist * dist), 1.0f);
+        result += attenuation * light.light.intensity * (light.light.diffuseK * diffuseColor * diff + light.light.specularK * specularColor * spec);
+    }
+    for (const SpotLight& light : *_frame->spotLights) {
+        glm::vec3 lightDir = glm::normalize(light.pos - pos);
+        GLfloat diff = glm::max(glm::dot(lightDir, normal), 0.0f);
+        GLfloat spec = glm::pow(glm::max(glm::dot(normal, glm::normalize(lightDir + viewDir)), 0.0f), material.shininess);
+        GLfloat dist = glm::length(light.pos - pos);
+        GLfloat attenuation = glm::min(1.0f / (light.attenuation.a + light.attenuation.b * dist + light.attenuation.c * dist * dist), 1.0f);
+        GLfloat theta = glm::dot(lightDir, glm::normalize(-light.dir));
+        GLfloat cone = glm::clamp((theta - light.outerCutOff) / (light.cutOff - light.outerCutOff), 0.0f, 1.0f);
+        result += attenuation * cone * light.light.intensity * (light.light.diffuseK * diffuseColor * diff + light.light.specularK * specularColor * spec);
+    }
+    for (const DirLight& light : *_frame->dirLights) {
+        glm::vec3 lightDir = glm::normalize(-light.dir);
+        GLfloat diff = glm::max(glm::dot(lightDir, normal), 0.0f);
+        GLfloat spec = glm::pow(glm::max(glm::dot(normal, glm::normalize(lightDir + viewDir)), 0.0f), material.shininess);
+        result += light.light.intensity * (light.light.diffuseK * diffuseColor * diff + light.light.specularK * specularColor * spec);
+    }
+    return result;
+}
+
+/* GL_LINEAR_MIPMAP_LINEAR with GL_REPEAT, the level of detail taken from the quad's derivatives */
+glm::vec4 SoftwareRenderer::_sample(GLuint texture, glm::vec2 uv, const glm::vec2 dUV[2]) const
+{
+    const _Texture& t = _textures[texture];
+    if (t.constant)
+        return t.constantColor;
+
+    const glm::vec2 size(t.widths[0], t.heights[0]);
+    GLfloat rho = glm::max(glm::length(dUV[0] * size), glm::length(dUV[1] * size));
+    GLfloat lod = CLAMP(rho > 0.0f ? std::log2(rho) : 0.0f, 0.0f, static_cast<GLfloat>(t.levels.size() - 1));
+    GLuint level = static_cast<GLuint>(lod);
+    glm::vec4 color = sampleBilinear(t.levels[level].data(), t.widths[level], t.heights[level], uv, GL_TRUE);
+    if (level + 1 < t.levels.size() && lod > level)
+        color = glm::mix(color, sampleBilinear(t.levels[level + 1].data(), t.widths[level + 1], t.heights[level + 1], uv, GL_TRUE), lod - level);
+    return color;
+}
+
+/* Cube map face selection of the OpenGL specification, then GL_LINEAR with GL_CLAMP_TO_EDGE */
+glm::vec3 SoftwareRenderer::_sampleSkybox(glm::vec3 dir) const
+{
+    glm::vec3 a = glm::abs(dir);
+    GLuint face;
+    GLfloat sc, tc, ma;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = dir.x > 0.0f ? 0 : 1;
+        sc = dir.x > 0.0f ? -dir.z : dir.z;
+        tc = -dir.y;
+        ma = a.x;
+    }
+    else if (a.y >= a.z) {
+        face = dir.y > 0.0f ? 2 : 3;
+        sc = dir.x;
+        tc = dir.y > 0.0f ? dir.z : -dir.z;
+        ma = a.y;
+    }
+    else {
+        face = dir.z > 0.0f ? 4 : 5;
+        sc = dir.z > 0.0f ? dir.x : -dir.x;
+        tc = -dir.y;
+        ma = a.z;
+    }
+
+    const _Texture& t = _textures[_skyboxFaces[face]];
+    if (t.constant)
+        return glm::vec3(t.constantColor);
+    glm::vec2 st(0.5f * (sc / ma + 1.0f), 0.5f * (tc / ma + 1.0f));
+    return glm::vec3(sampleBilinear(t.levels[0].data(), t.widths[0], t.heights[0], st, GL_FALSE));
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "job/job.h"
+#include "light/light.h"
+#include "misc/misc.h"
+
+#include <string>
+#include <vector>
+
+/* An object drawn by the software renderer */
+struct SoftwareDraw {
+    GLuint meshID, materialID;
+    glm::mat4 modelMatrix;
+    glm::vec3 emissionK;
+};
+
+/* Everything a software frame is drawn from */
+struct SoftwareFrame {
+    glm::mat4 viewMatrix, projectionMatrix;
+    glm::vec3 cameraPos;
+    glm::vec3 ambientK;
+    const std::vector<SoftwareDraw>* draws;
+    const std::vector<PointLight>* pointLights;
+    const std::vector<SpotLight>* spotLights;
+    const std::vector<DirLight>* dirLights;
+};
+
+/*
+CPU rasterizer drawing the meshes, materials and lights the way texture.vs
+and texture.fs do (Blinn-Phong, normal mapping, trilinear filtering), then
+the skybox behind them, without any OpenGL context.
+
+A frame runs in three parallel stages on a JobSystem, whose work stealing
+balances the tiles:
+  1. Setup, per vertex range and per chunk of triangles: transform the
+     vertices, clip against the near plane, cull back faces, snap to 1/256
+     pixel and sort the chunk's triangles by the rows of TILE_SIZE x
+     TILE_SIZE tiles they overlap.
+  2. Binning, per row of tiles: merge the chunks' lists for the row, in
+     chunk order, into the list of every tile, in submission order.
+  3. Rasterization, per tile: test 2x2 pixel quads against the three edge
+     functions and the tile's own depth buffer four lanes at a time (SSE2
+     when available), then shade the covered pixels and fill the rest with
+     the skybox.
+An edge function is always evaluated from the same endpoint of an edge, so
+triangles sharing it get exactly opposite values and, with the top-left
+rule, never both or neither cover a pixel on it. There is no multisampling.
+
+The image is RGB with the bottom row first, as glReadPixels returns it.
+*/
+class SoftwareRenderer
+{
+public:
+    static const GLint TILE_SIZE = 64;
+    static const GLuint SETUP_CHUNK = 4096;  /* Triangles set up per job */
+
+    void setupSoftwareRenderer(GLint width, GLint height, JobSystem* jobSystem);
+    GLuint addMesh(const Model& model);
+    GLuint addMaterial(const char* diffusePath, const char* specularPath, const char* normalPath, GLfloat shininess);
+    GLuint getMaterialCount(void) const;
+    void setupSkybox(const std::vector<std::string>& facePaths);  /* +X, -X, +Y, -Y, +Z, -Z as Skybox */
+    void render(const SoftwareFrame& frame);
+    const std::vector<unsigned char>& getPixels(void) const;
+    GLuint getTriangleCount(void) const;  /* Rasterized in the last frame */
+
+private:
+    /* RGBA8 mipmaps, row 0 at t = 0; a uniform image keeps a single texel */
+    struct _Texture {
+        std::vector<std::vector<unsigned char>> levels;
+        std::vector<GLint> widths, heights;
+        glm::vec4 constantColor;
+        GLboolean constant;
+    };
+    struct _Material {
+        GLuint diffuse, specular, normal;
+        GLfloat shininess;
+        GLboolean flatNormal;
+    };
+    struct _Mesh {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+    };
+    struct _ClipVertex {
+        glm::vec4 clipPos;
+        glm::vec3 worldPos, normal;
+        glm::vec2 uv;
+    };
+    /* Screen-space triangle, attributes divided by w for perspective-correct interpolation */
+    struct _Triangle {
+        glm::vec2 screen[3];
+        glm::vec3 depth, invW;
+        glm::vec3 posOverW[3], normalOverW[3];
+        glm::vec2 uvOverW[3];
+        glm::vec2 edgeOrigin[3], edgeDelta[3];  /* Edge i is opposite vertex i, from its canonical endpoint */
+        GLfloat edgeSign[3];
+        GLboolean topLeft[3];
+        GLfloat invArea;
+        GLint minX, minY, maxX, maxY;  /* Covered pixels, clamped to the image */
+        GLuint draw;
+    };
+    struct _Chunk {
+        GLuint draw, firstIndex, indexCount;
+    };
+    struct _TriangleRef {
+        GLuint chunk, triangle;
+    };
+    /* Triangles of a chunk by tile row: row r has triangles[rowStarts[r]] to triangles[rowStarts[r + 1] - 1], in order */
+    struct _ChunkRows {
+        std::vector<GLuint> rowStarts, triangles;
+    };
+
+    GLint _width, _height, _tileColumns, _tileRows;
+    JobSystem* _jobSystem;
+    std::vector<_Mesh> _meshes;
+    std::vector<_Texture> _textures;
+    std::vector<_Material> _materials;
+    GLuint _skyboxFaces[6];
+    GLboolean _hasSkybox;
+
+    const SoftwareFrame* _frame;
+    glm::mat4 _viewProjection, _skyboxInverse;
+    std::vector<GLuint> _vertexOffsets;  /* First clip vertex of every draw, then the total */
+    std::vector<_ClipVertex> _clipVertices;
+    std::vector<_Chunk> _chunks;
+    std::vector<std::vector<_Triangle>> _chunkTriangles;
+    std::vector<_ChunkRows> _chunkRows;
+    std::vector<std::vector<_TriangleRef>> _bins;  /* Per tile, in submission order */
+    std::vector<unsigned char> _pixels;
+
+    GLuint _loadTexture(const char* path, glm::vec4 fallback, GLboolean cubeFace);
+    void _transformVertices(GLuint begin, GLuint end);
+    void _setupChunk(GLuint chunk);
+    void _addTriangle(std::vector<_Triangle>& triangles, GLuint draw, const _ClipVertex& a, const _ClipVertex& b, const _ClipVertex& c) const;
+    void _sortChunkByRow(GLuint chunk);
+    void _binRow(GLint row);
+    void _rasterizeTile(GLint tile);
+    glm::vec3 _shade(const SoftwareDraw& draw, const glm::vec3& pos, const glm::vec3& normal, const glm::vec2& uv, const glm::vec3 dPos[2],
+                     const glm::vec2 dUV[2]) const;
+    glm::vec4 _sample(GLuint texture, glm::vec2 uv, const glm::vec2 dUV[2]) const;
+    glm::vec3 _sampleSkybox(glm::vec3 dir) const;
+};
@@ -4,10 +4,16 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image/stb_image.h"
 
+#include "device/device.h"
+#include "misc/misc.h"
+#include "profiler/profiler.h"
+
 #include <iostream>
+#include <cstring>
 
 void Texture::setupTexture(const char* texturePath)
 {
+    PROFILE_SCOPE("Texture::setupTexture");
 	std::cout << "INF: Loading texture " << texturePath << "..." << std::endl;
 	stbi_set_flip_vertically_on_load(true);  /* Tell stb_image.h to flip loaded texture's on the y-axis */
 	unsigned char* data = stbi_load(texturePath, &_width, &_height, &_bpp, 0);  /* Load the texture data into "data" */
@@ -18,20 +24,32 @@ void Texture::setupTexture(const char* texturePath)
 		case 4: format = GL_RGBA; break;
 	}
 
-	glGenTextures(1, &_ID);
-	glBindTexture(GL_TEXTURE_2D, _ID);
+	/* A single-color image samples the same everywhere, so keep only one texel of it */
+	if (data && _isUniformImage(data)) {
+		glm::vec4 color(0.0f, 0.0f, 0.0f, 1.0f);
+		for (int i = 0; i < _bpp; i++)
+			color[_bpp == 1 ? 0 : i] = data[i] / 255.0f;
+		stbi_image_free(data);
+		std::cout << "INF: Texture " << texturePath << " has a constant color" << std::endl;
+		setupTextureColor(color);
+		return;
+	}
+	_isConstant = false;
+
+	getRenderDevice().genTextures(1, &_ID);
+	getRenderDevice().bindTexture(GL_TEXTURE_2D, _ID);
 
 	/* Set texture wrapping parameters */
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	/* Set texture filtering parameters */
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	
 	if (data) {
-		glTexImage2D(GL_TEXTURE_2D, 0, format, _width, _height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		getRenderDevice().texImage2D(GL_TEXTURE_2D, 0, format, _width, _height, 0, format, GL_UNSIGNED_BYTE, data);
+		getRenderDevice().generateMipmap(GL_TEXTURE_2D);
 		stbi_image_free(data);
 	}
 	else {
@@ -40,7 +58,32 @@ void Texture::setupTexture(const char* texturePath)
 	}
 
 	// std::cout << "Load " << texturePath << " successfully!" << std::endl;
-	glBindTexture(GL_TEXTURE_2D, 0);
+	getRenderDevice().bindTexture(GL_TEXTURE_2D, 0);
+}
+
+/* Create a 1x1 texture of the given color (used for constant and missing maps) */
+void Texture::setupTextureColor(glm::vec4 color)
+{
+	const unsigned char texel[] = {
+		static_cast<unsigned char>(glm::round(CLAMP(color.r, 0.0f, 1.0f) * 255.0f)),
+		static_cast<unsigned char>(glm::round(CLAMP(color.g, 0.0f, 1.0f) * 255.0f)),
+		static_cast<unsigned char>(glm::round(CLAMP(color.b, 0.0f, 1.0f) * 255.0f)),
+		static_cast<unsigned char>(glm::round(CLAMP(color.a, 0.0f, 1.0f) * 255.0f)),
+	};
+
+	_width = _height = 1;
+	_bpp = 4;
+	_isConstant = true;
+	_constantColor = color;
+
+	getRenderDevice().genTextures(1, &_ID);
+	getRenderDevice().bindTexture(GL_TEXTURE_2D, _ID);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	getRenderDevice().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	getRenderDevice().texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+	getRenderDevice().bindTexture(GL_TEXTURE_2D, 0);
 }
 
 /*
@@ -55,15 +98,17 @@ Order:
 */
 void Texture::setupTextureCubemap(const std::vector<std::string>& texPaths)
 {
-    glGenTextures(1, &_ID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, _ID);
+    PROFILE_SCOPE("Texture::setupTextureCubemap");
+    _isConstant = false;
+    getRenderDevice().genTextures(1, &_ID);
+	getRenderDevice().bindTexture(GL_TEXTURE_CUBE_MAP, _ID);
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    getRenderDevice().texParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     // glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    getRenderDevice().texParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    getRenderDevice().texParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    getRenderDevice().texParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    getRenderDevice().texParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
 	stbi_set_flip_vertically_on_load(false);  /* Tell stb_image.h to flip loaded texture's on the y-axis */
     for (unsigned int i = 0; i < texPaths.size(); i++) {
@@ -77,8 +122,8 @@ void Texture::setupTextureCubemap(const std::vector<std::string>& texPaths)
 	    }
 
         if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, _width, _height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
+            getRenderDevice().texImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, _width, _height, 0, format, GL_UNSIGNED_BYTE, data);
+            getRenderDevice().generateMipmap(GL_TEXTURE_2D);
             stbi_image_free(data);
         }
         else {
@@ -88,27 +133,48 @@ void Texture::setupTextureCubemap(const std::vector<std::string>& texPaths)
     }
 
 	// std::cout << "Load Cubemap successfully!" << std::endl;
-	glBindTexture(GL_TEXTURE_2D, 0);
+	getRenderDevice().bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Texture::bind(unsigned int slot) const
 {
-	glActiveTexture(GL_TEXTURE0 + slot);
-	glBindTexture(GL_TEXTURE_2D, _ID);
+	getRenderDevice().activeTexture(GL_TEXTURE0 + slot);
+	getRenderDevice().bindTexture(GL_TEXTURE_2D, _ID);
 }
 
 void Texture::bindCubemap(unsigned int slot) const
 {
-	glActiveTexture(GL_TEXTURE0 + slot);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, _ID);
+	getRenderDevice().activeTexture(GL_TEXTURE0 + slot);
+	getRenderDevice().bindTexture(GL_TEXTURE_CUBE_MAP, _ID);
 }
 
 void Texture::unbind(void) const
 {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	getRenderDevice().bindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Texture::unbindCubemap(void) const
 {
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	getRenderDevice().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+/* Whether every texel of the texture has the same color */
+bool Texture::isConstant(void) const
+{
+	return _isConstant;
+}
+
+/* Color of a constant texture (RGBA in [0, 1]) */
+glm::vec4 Texture::getConstantColor(void) const
+{
+	return _constantColor;
+}
+
+bool Texture::_isUniformImage(const unsigned char* data) const
+{
+	const size_t texelCount = static_cast<size_t>(_width) * static_cast<size_t>(_height);
+	for (size_t i = 1; i < texelCount; i++)
+		if (std::memcmp(data, data + i * _bpp, _bpp) != 0)
+			return false;
+	return true;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "glm/glm.hpp"
+
 #include <string>
 #include <vector>
 
@@ -7,13 +9,20 @@ class Texture
 {
 public:
 	void setupTexture(const char* texturePath);
+	void setupTextureColor(glm::vec4 color);
     void setupTextureCubemap(const std::vector<std::string>& texPaths);
 	void bind(unsigned int slot) const;
 	void bindCubemap(unsigned int slot) const;
 	void unbind(void) const;
 	void unbindCubemap(void) const;
+	bool isConstant(void) const;
+	glm::vec4 getConstantColor(void) const;
 
 private:
 	unsigned int _ID;
 	int _width, _height, _bpp;
+	bool _isConstant;
+	glm::vec4 _constantColor;
+
+	bool _isUniformImage(const unsigned char* data) const;
 };
@@ -0,0 +1,169 @@
+#include "transform.h"
+
+#include "misc/misc.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+GLuint TransformHierarchy::createNode(GLuint parent, const glm::mat4& localMatrix)
+{
+    GLuint parentIndex = (parent == NO_PARENT) ? NO_PARENT : _handleToIndex[parent];
+    GLuint depth = (parent == NO_PARENT) ? 0 : _depth[parentIndex] + 1;
+    if (!_depth.empty() && depth < _depth.back())
+        _needsSort = true;
+
+    GLuint handle = static_cast<GLuint>(_handleToIndex.size());
+    _handleToIndex.push_back(static_cast<GLuint>(_parent.size()));
+    _indexToHandle.push_back(handle);
+    _parent.push_back(parentIndex);
+    _depth.push_back(depth);
+    _local.push_back(localMatrix);
+    _world.push_back(localMatrix);
+    _dirty.push_back(0);
+    _markDirty(_parent.size() - 1);
+    _levelsValid = false;
+    return handle;
+}
+
+void TransformHierarchy::setLocalMatrix(GLuint node, const glm::mat4& localMatrix)
+{
+    size_t index = _handleToIndex[node];
+    _local[index] = localMatrix;
+    _markDirty(index);
+}
+
+/* Valid after update() */
+const glm::mat4& TransformHierarchy::getWorldMatrix(GLuint node) const
+{
+    return _world[_handleToIndex[node]];
+}
+
+GLuint TransformHierarchy::update(JobSystem* jobs)
+{
+    if (_needsSort)
+        _sortByDepth();
+    if (_firstDirty >= _parent.size())
+        return 0;
+    if (!_levelsValid)
+        _findLevels();
+
+    std::atomic<GLuint> updated(0);
+    for (size_t level = 0; level + 1 < _levelStarts.size(); level++) {
+        size_t begin = MAX(static_cast<size_t>(_levelStarts[level]), _firstDirty), end = _levelStarts[level + 1];
+        if (begin >= end)
+            continue;
+        if (jobs)
+            jobs->parallelFor(static_cast<GLuint>(end - begin), 1024, [this, begin, &updated](GLuint first, GLuint last) {
+                updated += _updateRange(begin + first, begin + last);
+            });
+        else
+            updated += _updateRange(begin, end);
+    }
+
+    std::fill(_dirty.begin() + _firstDirty, _dirty.end(), 0);
+    _firstDirty = _dirty.size();
+    return updated;
+}
+
+GLuint TransformHierarchy::getNodeCount(void) const
+{
+    return static_cast<GLuint>(_parent.size());
+}
+
+/* Recompute the dirty nodes among [begin, end), which must not cross a depth level */
+GLuint TransformHierarchy::_updateRange(size_t begin, size_t end)
+{
+    GLuint updated = 0;
+    for (size_t i = begin; i < end; i++) {
+        GLuint parent = _parent[i];
+        if (parent != NO_PARENT && _dirty[parent])
+            _dirty[i] = 1;  /* Inherit from the parent, which is on a finished level */
+        if (!_dirty[i])
+            continue;
+        if (parent == NO_PARENT)
+            _world[i] = _local[i];
+        else
+            multiplyMatrices(_world[parent], _local[i], _world[i]);
+        updated++;
+    }
+    return updated;
+}
+
+void TransformHierarchy::_markDirty(size_t index)
+{
+    _dirty[index] = 1;
+    _firstDirty = MIN(_firstDirty, index);
+}
+
+/* Counting sort of the nodes by depth, stable so that siblings keep their order */
+void TransformHierarchy::_sortByDepth(void)
+{
+    const size_t count = _parent.size();
+    GLuint maxDepth = 0;
+    for (GLuint depth : _depth)
+        maxDepth = MAX(maxDepth, depth);
+
+    std::vector<GLuint> offsets(maxDepth + 2, 0);
+    for (GLuint depth : _depth)
+        offsets[depth + 1]++;
+    for (GLuint depth = 1; depth <= maxDepth + 1; depth++)
+        offsets[depth] += offsets[depth - 1];
+
+    std::vector<GLuint> newIndex(count);
+    for (size_t i = 0; i < count; i++)
+        newIndex[i] = offsets[_depth[i]]++;
+
+    std::vector<GLuint> parent(count), depth(count), indexToHandle(count);
+    std::vector<glm::mat4> local(count), world(count);
+    std::vector<unsigned char> dirty(count);
+    for (size_t i = 0; i < count; i++) {
+        GLuint j = newIndex[i];
+        parent[j] = (_parent[i] == NO_PARENT) ? NO_PARENT : newIndex[_parent[i]];
+        depth[j] = _depth[i];
+        local[j] = _local[i];
+        world[j] = _world[i];
+        dirty[j] = 1;  /* Cheaper than tracking where the dirty nodes went */
+        indexToHandle[j] = _indexToHandle[i];
+        _handleToIndex[_indexToHandle[i]] = j;
+    }
+
+    _parent.swap(parent);
+    _depth.swap(depth);
+    _local.swap(local);
+    _world.swap(world);
+    _dirty.swap(dirty);
+    _indexToHandle.swap(indexToHandle);
+    _firstDirty = 0;
+    _needsSort = false;
+    _levelsValid = false;
+}
+
+void TransformHierarchy::_findLevels(void)
+{
+    _levelStarts.clear();
+    for (size_t i = 0; i < _depth.size(); i++)
+        if (i == 0 || _depth[i] != _depth[i - 1])
+            _levelStarts.push_back(static_cast<GLuint>(i));
+    _levelStarts.push_back(static_cast<GLuint>(_depth.size()));
+    _levelsValid = true;
+}
+
+/* result = a * b for column-major matrices; result must not alias a or b */
+void multiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+#if defined(__SSE2__)
+    __m128 a0 = _mm_loadu_ps(&a[0][0]), a1 = _mm_loadu_ps(&a[1][0]), a2 = _mm_loadu_ps(&a[2][0]), a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; column++) {
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+        _mm_storeu_ps(&result[column][0], r);
+    }
+#else
+    result = a * b;
+#endif
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+#include "job/job.h"
+
+#include <vector>
+
+/*
+Parent/child transforms in SoA arrays. Nodes are kept sorted by depth
+(roots first), so every parent precedes its children and all local-to-world
+matrices are updated in one linear pass. Only the nodes whose local matrix
+changed, and their subtrees, are recomputed: the pass starts at the first
+dirty node and is skipped altogether when nothing changed.
+
+Nodes of one depth depend only on shallower ones, so with a JobSystem each
+depth level is split across the threads.
+
+Nodes are referred to by the handle createNode() returns, which stays valid
+when the arrays are re-sorted.
+*/
+class TransformHierarchy
+{
+public:
+    static const GLuint NO_PARENT = ~0u;
+
+    GLuint createNode(GLuint parent, const glm::mat4& localMatrix);
+    void setLocalMatrix(GLuint node, const glm::mat4& localMatrix);
+    const glm::mat4& getWorldMatrix(GLuint node) const;
+    GLuint update(JobSystem* jobs = NULL);  /* Returns the number of world matrices recomputed */
+    GLuint getNodeCount(void) const;
+
+private:
+    std::vector<GLuint> _parent;  /* Index of the parent, or NO_PARENT */
+    std::vector<GLuint> _depth;
+    std::vector<glm::mat4> _local, _world;
+    std::vector<unsigned char> _dirty;
+    std::vector<GLuint> _handleToIndex, _indexToHandle;
+    std::vector<GLuint> _levelStarts;  /* First index of every depth, plus the node count */
+    size_t _firstDirty = 0;
+    bool _needsSort = false;
+    bool _levelsValid = false;
+
+    void _markDirty(size_t index);
+    void _sortByDepth(void);
+    void _findLevels(void);
+    GLuint _updateRange(size_t begin, size_t end);
+};
+
+void multiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& result);